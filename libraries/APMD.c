@@ -28,287 +28,105 @@
 #define PMD1_PHASE_COMPLIMENT               (bool) true
 #define PMD2_PHASE_COMPLIMENT               (bool) true
 
+/*  True = EMG input (external over-current comparator) shuts the unit down from APMD_Init() | False = EMG disabled  */
+#define PMD0_EMG_PROTECT                    (bool) true
+#define PMD1_EMG_PROTECT                    (bool) false
+#define PMD2_EMG_PROTECT                    (bool) false
+
+#define APMD_EMG_COUNT_DEFAULT              (uint8_t) 0x02      // EMG noise filter, 2 * 16/fsys (200 ns at 160 MHz)
+
+
+/*===================================================================*
+      Pin-mux descriptor for each A-PMD channel
+*===================================================================*/
+static const APMD_PinMux APMD_PinMux_Table[APMD_CHANNELS] = {
+    /* A-PMD0: PB0 - PB5 (Function 4), EMG0 PB6, clock Port B, PMD0 and Ramp */
+    { TSB_PMD0, &TSB_PB->CR, &TSB_PB->FR4, 0, 0, { 0, 2, 4 }, { 1, 3, 5 }, &TSB_PB->IE, 6, APMD_CLK_BIT(1), APMD_CLK_BIT(9), APMD_CLK_BIT(1) },
+    /* A-PMD1: PE0 - PE4 (Function 6), PE5 (Function 4), EMG1 PE6, clock Port E and PMD1 */
+    { TSB_PMD1, &TSB_PE->CR, &TSB_PE->FR6, &TSB_PE->FR4, APMD_PIN_BIT(5), { 0, 2, 4 }, { 1, 3, 5 }, &TSB_PE->IE, 6, APMD_CLK_BIT(4), APMD_CLK_BIT(10), 0 },
+    /* A-PMD2: PU0 - PU5 (Function 6), EMG2 PU6, clock Port U and PMD2 */
+    { TSB_PMD2, &TSB_PU->CR, &TSB_PU->FR6, 0, 0, { 0, 2, 4 }, { 1, 3, 5 }, &TSB_PU->IE, 6, APMD_CLK_BIT(16), APMD_CLK_BIT(11), 0 },
+};
+
+static const uint8_t APMD_Phase_Val[APMD_CHANNELS] = { PMD0_PHASE_Val, PMD1_PHASE_Val, PMD2_PHASE_Val };
+static const bool APMD_Phase_Comp[APMD_CHANNELS] = { PMD0_PHASE_COMPLIMENT, PMD1_PHASE_COMPLIMENT, PMD2_PHASE_COMPLIMENT };
+static const bool APMD_EMG_Protect[APMD_CHANNELS] = { PMD0_EMG_PROTECT, PMD1_EMG_PROTECT, PMD2_EMG_PROTECT };
+
 
 /*===================================================================*
       Initialize the PMDx Based on configuration
 *===================================================================*/
 void APMD_Init(void){
-    switch(PMD0_PHASE_Val){
-        case 0x01:
-            APMD_Config(TSB_PMD0, 1, PMD0_PHASE_COMPLIMENT);
-            break;
-        case 0x02:
-            APMD_Config(TSB_PMD0, 2, PMD0_PHASE_COMPLIMENT);
-            break;
-        case 0x03:
-            APMD_Config(TSB_PMD0, 3, PMD0_PHASE_COMPLIMENT);
-            break;
-        default:
-            break;
+    APMD_Units_Init();
+    for(uint8_t i = 0; i < APMD_CHANNELS; i++){
+        if(APMD_Phase_Val[i] != 0){
+            APMD_Config(APMD_PinMux_Table[i].pmd, APMD_Phase_Val[i], APMD_Phase_Comp[i]);
+        }
     }
+}
 
-    switch(PMD1_PHASE_Val){
-        case 0x01:
-            APMD_Config(TSB_PMD1, 1, PMD1_PHASE_COMPLIMENT);
-            break;
-        case 0x02:
-            APMD_Config(TSB_PMD1, 2, PMD1_PHASE_COMPLIMENT);
-            break;
-        case 0x03:
-            APMD_Config(TSB_PMD1, 3, PMD1_PHASE_COMPLIMENT);
-            break;
-        default:
-            break;
+const APMD_PinMux * APMD_Get_PinMux(TSB_PMD_TypeDef * PMDx){
+    for(uint8_t i = 0; i < APMD_CHANNELS; i++){
+        if(APMD_PinMux_Table[i].pmd == PMDx){
+            return &APMD_PinMux_Table[i];
+        }
     }
+    return 0;
+}
 
-    switch(PMD2_PHASE_Val){
-        case 0x01:
-            APMD_Config(TSB_PMD2, 1, PMD2_PHASE_COMPLIMENT);
-            break;
-        case 0x02:
-            APMD_Config(TSB_PMD2, 2, PMD2_PHASE_COMPLIMENT);
-            break;
-        case 0x03:
-            APMD_Config(TSB_PMD2, 3, PMD2_PHASE_COMPLIMENT);
-            break;
-        default:
-            break;
+/*===================================================================
+    Route the first 'phase' U/V/W pins (and X/Y/Z when comp is set)
+    to the PMD: one read-modify-write on CR and one on each FRn. Unused
+    complement pins of the active phases are returned to the port
+ ===================================================================*/
+void APMD_PinMux_Apply(const APMD_PinMux * mux, uint8_t phase, bool comp){
+    uint32_t upper = 0;
+    uint32_t lower = 0;
+    uint32_t alt = (mux->port_fr_alt != 0) ? mux->fr_alt_pins : 0;
+
+    for(uint8_t i = 0; i < phase && i < APMD_PHASES_MAX; i++){
+        upper |= (0x01UL << mux->upper_pin[i]);
+        lower |= (0x01UL << mux->lower_pin[i]);
+    }
+    if(comp){
+        upper |= lower;
+        lower = 0;
+    }
+    *mux->port_cr = (*mux->port_cr & ~lower) | upper;
+    *mux->port_fr = (*mux->port_fr & ~(lower & ~alt)) | (upper & ~alt);
+    if(alt != 0){
+        *mux->port_fr_alt = (*mux->port_fr_alt & ~(lower & alt)) | (upper & alt);
     }
 }
 
 void APMD_Config(TSB_PMD_TypeDef * PMDx, uint8_t phase, bool comp){
-    switch((intptr_t)PMDx){
-        /* Configure A-PMD0 */
-        case (intptr_t)TSB_PMD0 : 
-            TSB_CG_FSYSMENA_IPMENA01 = 1;   // Clock Enable Port B
-            TSB_CG_FSYSMENB_IPMENB09 = 1;   // Clock Enable PMD0
-            TSB_CG_FSYSENA_IPENA01 = 1;     // Clock Enable Ramp
-            PORTMD_UPPMD_LPHIGH(PMDx);      // Set the PWM to have a PMD output on Upper-Phase
-
-            if (phase == 1){
-                /* Set the Clock supply and stop register A for Phase U */
-                TSB_PB_CR_PB0C = 1;             // Enables PB0 as output
-                TSB_PB_FR4_PB0F4 = 1;           // Enables the function output on PB0
-
-                if (comp){
-                    /* U Phase and X Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PB_CR_PB1C = 1;             // Enables PB1 as output
-                    TSB_PB_FR4_PB1F4 = 1;           // Enables the function output on PB1
-                }
-                else {
-                    TSB_PB_CR_PB1C = 0;             // Disable PB1 as output
-                    TSB_PB_FR4_PB1F4 = 0;           // Disable the function output on PB1
-                }
-            }
-
-            if (phase == 2){
-                /* Set the Clock supply and stop register A for Phase U, V */
-                TSB_PB_CR_PB0C = 1;             // Enables PB0 as output
-                TSB_PB_FR4_PB0F4 = 1;           // Enables the function output on PB0
-                TSB_PB_CR_PB2C = 1;             // Enables PB2 as output
-                TSB_PB_FR4_PB2F4 = 1;           // Enables the function output on PB2
-
-                if (comp){
-                    /* U, V Phase and X, Y Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PB_CR_PB1C = 1;             // Enables PB1 as output
-                    TSB_PB_FR4_PB1F4 = 1;           // Enables the function output on PB1
-                    TSB_PB_CR_PB3C = 1;             // Enables PB3 as output
-                    TSB_PB_FR4_PB3F4 = 1;           // Enables the function output on PB3
-                }
-                else {
-                    TSB_PB_CR_PB1C = 0;             // Disable PB1 as output
-                    TSB_PB_FR4_PB1F4 = 0;           // Disable the function output on PB1
-                    TSB_PB_CR_PB3C = 0;             // Disable PB3 as output
-                    TSB_PB_FR4_PB3F4 = 0;           // Disable the function output on PB3
-                }
-            }
-
-            if (phase == 3){
-                /* Set the Clock supply and stop register A for Phase U, V, W */
-                TSB_PB_CR_PB0C = 1;             // Enables PB0 as output
-                TSB_PB_FR4_PB0F4 = 1;           // Enables the function output on PB0
-                TSB_PB_CR_PB2C = 1;             // Enables PB2 as output
-                TSB_PB_FR4_PB2F4 = 1;           // Enables the function output on PB2
-                TSB_PB_CR_PB4C = 1;             // Enables PB4 as output
-                TSB_PB_FR4_PB4F4 = 1;           // Enables the function output on PB4
-
-                if (comp){
-                    /* U, V, W Phase and X, Y, Z Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PB_CR_PB1C = 1;             // Enables PB1 as output
-                    TSB_PB_FR4_PB1F4 = 1;           // Enables the function output on PB1
-                    TSB_PB_CR_PB3C = 1;             // Enables PB3 as output
-                    TSB_PB_FR4_PB3F4 = 1;           // Enables the function output on PB3
-                    TSB_PB_CR_PB5C = 1;             // Enables PB5 as output
-                    TSB_PB_FR4_PB5F4 = 1;           // Enables the function output on PB5
-                }
-                else {
-                    TSB_PB_CR_PB1C = 0;             // Disable PB1 as output
-                    TSB_PB_FR4_PB1F4 = 0;           // Disable the function output on PB1
-                    TSB_PB_CR_PB3C = 0;             // Disable PB3 as output
-                    TSB_PB_FR4_PB3F4 = 0;           // Disable the function output on PB3
-                    TSB_PB_CR_PB5C = 0;             // Disable PB5 as output
-                    TSB_PB_FR4_PB5F4 = 0;           // Disable the function output on PB5
-                }
-            }
-            break;
+    const APMD_PinMux * mux = APMD_Get_PinMux(PMDx);
 
-        /* Configure A-PMD1 */
-        case (intptr_t)TSB_PMD1 : 
-            TSB_CG_FSYSMENA_IPMENA04 = 1;   // Clock Enable Port E
-            TSB_CG_FSYSMENB_IPMENB10 = 1;   // Clock Enable PMD1
-            PORTMD_UPPMD_LPHIGH(PMDx);      // Set the PWM to have a PMD output on Upper-Phase
-
-            if (phase == 1){
-                /* Set the Clock supply and stop register A for Phase U */
-                TSB_PE_CR_PE0C = 1;             // Enables PE0 as output
-                TSB_PE_FR6_PE0F6 = 1;           // Enables the function output on PE0
-
-                if (comp){
-                    /* U Phase and X Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PE_CR_PE1C = 1;             // Enables PE1 as output
-                    TSB_PE_FR6_PE1F6 = 1;           // Enables the function output on PE1
-                }
-                else {
-                    TSB_PE_CR_PE1C = 0;             // Disable PE1 as output
-                    TSB_PE_FR6_PE1F6 = 0;           // Disable the function output on PE1
-                }
-            }
-
-            if (phase == 2){
-                /* Set the Clock supply and stop register A for Phase U, V */
-                TSB_PE_CR_PE0C = 1;             // Enables PE0 as output
-                TSB_PE_FR6_PE0F6 = 1;           // Enables the function output on PE0
-                TSB_PE_CR_PE2C = 1;             // Enables PE2 as output
-                TSB_PE_FR6_PE2F6 = 1;           // Enables the function output on PE2
-
-                if (comp){
-                    /* U, V Phase and X, W Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PE_CR_PE1C = 1;             // Enables PE1 as output
-                    TSB_PE_FR6_PE1F6 = 1;           // Enables the function output on PE1
-                    TSB_PE_CR_PE3C = 1;             // Enables PE3 as output
-                    TSB_PE_FR6_PE3F6 = 1;           // Enables the function output on PE3
-                }
-                else {
-                    TSB_PE_CR_PE1C = 0;             // Disable PE1 as output
-                    TSB_PE_FR6_PE1F6 = 0;           // Disable the function output on PE1
-                    TSB_PE_CR_PE3C = 0;             // Disable PE3 as output
-                    TSB_PE_FR6_PE3F6 = 0;           // Disable the function output on PE3
-                }
-            }
-
-            if (phase == 3){
-                /* Set the Clock supply and stop register A for Phase U, V, W */
-                TSB_PE_CR_PE0C = 1;             // Enables PE0 as output
-                TSB_PE_FR6_PE0F6 = 1;           // Enables the function output on PE0
-                TSB_PE_CR_PE2C = 1;             // Enables PE2 as output
-                TSB_PE_FR6_PE2F6 = 1;           // Enables the function output on PE2
-                TSB_PE_CR_PE4C = 1;             // Enables PE4 as output
-                TSB_PE_FR6_PE4F6 = 1;           // Enables the function output on PE4
-
-                if (comp){
-                    /* U, V, W Phase and X, Y, Z Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PE_CR_PE1C = 1;             // Enables PE1 as output
-                    TSB_PE_FR6_PE1F6 = 1;           // Enables the function output on PE1
-                    TSB_PE_CR_PE3C = 1;             // Enables PE3 as output
-                    TSB_PE_FR6_PE3F6 = 1;           // Enables the function output on PE3
-                    TSB_PE_CR_PE5C = 1;             // Enables PE5 as output
-                    TSB_PE_FR4_PE5F4 = 1;           // Enables the function output on PE5
-                }
-                else {
-                    TSB_PE_CR_PE1C = 0;             // Disable PE1 as output
-                    TSB_PE_FR6_PE1F6 = 0;           // Disable the function output on PE1
-                    TSB_PE_CR_PE3C = 0;             // Disable PE3 as output
-                    TSB_PE_FR6_PE3F6 = 0;           // Disable the function output on PE3
-                    TSB_PE_CR_PE5C = 0;             // Disable PE5 as output
-                    TSB_PE_FR4_PE5F4 = 0;           // Disable the function output on PE5
-                }
-            }
-            break;
+    if(mux == 0){
+        return;
+    }
+    TSB_CG->FSYSMENA |= mux->fsysmena;              // Clock Enable Port
+    TSB_CG->FSYSMENB |= mux->fsysmenb;              // Clock Enable PMDx
+    TSB_CG->FSYSENA |= mux->fsysena;                // Clock Enable Ramp (PMD0 only)
 
-        /* Configure A-PMD2 */
-        default :
-            TSB_CG_FSYSMENA_IPMENA16 = 1;   // Clock Enable Port U
-            TSB_CG_FSYSMENB_IPMENB11 = 1;   // Clock Enable PMD2
-            PORTMD_UPPMD_LPHIGH(PMDx);      // Set the PWM to have a PMD output on Upper-Phase
-            
-            if (phase == 1){
-                /* Set the Clock supply and stop register A for Phase U */
-                TSB_PU_CR_PU0C = 1;             // Enables PU0 as output
-                TSB_PU_FR6_PU0F6 = 1;           // Enables the function output on PU0
-
-                if (comp){
-                    /* U Phase and X Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PU_CR_PU1C = 1;             // Enables PU1 as output
-                    TSB_PU_FR6_PU1F6 = 1;           // Enables the function output on PU1
-                }
-                else {
-                    TSB_PU_CR_PU1C = 0;             // Disable PU1 as output
-                    TSB_PU_FR6_PU1F6 = 0;           // Disable the function output on PU1
-                }
-            }
-
-            if (phase == 2){
-                /* Set the Clock supply and stop register A for Phase U, V */
-                TSB_PU_CR_PU0C = 1;             // Enables PU0 as output
-                TSB_PU_FR6_PU0F6 = 1;           // Enables the function output on PU0
-                TSB_PU_CR_PU2C = 1;             // Enables PU2 as output
-                TSB_PU_FR6_PU2F6 = 1;           // Enables the function output on PU2
-
-                if (comp){
-                    /* U, V Phase and X, W Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PU_CR_PU1C = 1;             // Enables PU1 as output
-                    TSB_PU_FR6_PU1F6 = 1;           // Enables the function output on PU1
-                    TSB_PU_CR_PU3C = 1;             // Enables PU3 as output
-                    TSB_PU_FR6_PU3F6 = 1;           // Enables the function output on PU3
-                }
-                else {
-                    TSB_PU_CR_PU1C = 0;             // Disable PU1 as output
-                    TSB_PU_FR6_PU1F6 = 0;           // Disable the function output on PU1
-                    TSB_PU_CR_PU3C = 0;             // Disable PU3 as output
-                    TSB_PU_FR6_PU3F6 = 0;           // Disable the function output on PU3
-                }
-            }
-
-            if (phase == 3){
-                /* Set the Clock supply and stop register A for Phase U, V, W */
-                TSB_PU_CR_PU0C = 1;             // Enables PU0 as output
-                TSB_PU_FR6_PU0F6 = 1;           // Enables the function output on PU0
-                TSB_PU_CR_PU2C = 1;             // Enables PU2 as output
-                TSB_PU_FR6_PU2F6 = 1;           // Enables the function output on PU2
-                TSB_PU_CR_PU4C = 1;             // Enables PU4 as output
-                TSB_PU_FR6_PU4F6 = 1;           // Enables the function output on PU4
-
-                if (comp){
-                    /* U, V, W Phase and X, Y, Z Phase (Compliment) Control Register */
-                    PORTMD_UPPMD_LPPMD(PMDx);       // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
-                    TSB_PU_CR_PU1C = 1;             // Enables PU1 as output
-                    TSB_PU_FR6_PU1F6 = 1;           // Enables the function output on PU1
-                    TSB_PU_CR_PU3C = 1;             // Enables PU3 as output
-                    TSB_PU_FR6_PU3F6 = 1;           // Enables the function output on PU3
-                    TSB_PU_CR_PU5C = 1;             // Enables PU5 as output
-                    TSB_PU_FR6_PU5F6 = 1;           // Enables the function output on PU5
-                }
-                else {
-                    TSB_PU_CR_PU1C = 0;             // Disable PU1 as output
-                    TSB_PU_FR6_PU1F6 = 0;           // Disable the function output on PU1
-                    TSB_PU_CR_PU3C = 0;             // Disable PU3 as output
-                    TSB_PU_FR6_PU3F6 = 0;           // Disable the function output on PU3
-                    TSB_PU_CR_PU5C = 0;             // Disable PU5 as output
-                    TSB_PU_FR6_PU5F6 = 0;           // Disable the function output on PU5
-                }
-            }
-            break;
+    if(comp && phase != 0){
+        PORTMD_UPPMD_LPPMD(PMDx);                   // Set the PWM to have a PMD output on Upper-Phase and Lower-Phase
+    }
+    else {
+        PORTMD_UPPMD_LPHIGH(PMDx);                  // Set the PWM to have a PMD output on Upper-Phase
+    }
+    APMD_PinMux_Apply(mux, phase, comp);
+
+    if(APMD_EMG_Protect[mux - APMD_PinMux_Table]){
+        *mux->port_cr &= ~(0x01UL << mux->emg_pin);     // EMG input pin
+        *mux->port_ie |= (0x01UL << mux->emg_pin);
+        *mux->port_fr |= (0x01UL << mux->emg_pin);
+        APMD_EMG_Enable(PMDx, APMD_EMG_COUNT_DEFAULT);  // Armed before the PWM is ever enabled
+    }
+    else {
+        EMG_Disable(PMDx);
+        EMGCR_EMGISEL_DISABLE(PMDx);                // Disable the EMG Input Port
     }
-    EMG_Disable(PMDx);
-    EMGCR_EMGISEL_DISABLE(PMDx);                    // Disable the EMG Input Port
     //MDEN_PWMEN_ENABLE(PMDx);                        // Enable the PWM function
 }
 
@@ -321,36 +139,187 @@ void EMG_Disable(TSB_PMD_TypeDef * PMDx){
     EMGCR_EMGEN_DISABLE(PMDx);
 }
 
+/*===================================================================
+    EMG protection from the EMG input port: every output of the unit
+    goes off in hardware once the input has been active for the noise
+    filter time (count * 16/fsys), the CPU only sees INTEMGx after.
+    EMGEN is cleared with the 0x5A/0xA5 key before the mode and the
+    filter change, the new settings land in one EMGCR write
+ ===================================================================*/
+void APMD_EMG_Enable(TSB_PMD_TypeDef * PMDx, uint8_t count){
+    APMD_Stage stage;
+
+    APMD_Stage_Begin(&stage, PMDx);
+    EMGCR_EMGEN_DISABLE(&stage);
+    APMD_Stage_Commit(&stage);                      // Key sequence if it was enabled
+
+    APMD_Stage_Begin(&stage, PMDx);
+    EMGCR_EMGISEL_ENABLED(&stage);                  // EMG Input Port
+    EMGCR_EMGIPOL_LOW(&stage);                      // Open drain comparator output, active low
+    EMGCR_EMGMD_UPZ_LPZ(&stage);                    // Upper and lower of every phase off
+    EMGCR_EMGCNT(&stage, (uint32_t)((count > APMD_FILTER_MAX) ? APMD_FILTER_MAX : count));
+    EMGCR_EMGEN_ENABLE(&stage);
+    APMD_Stage_Commit(&stage);
+}
+
+/*===================================================================
+    OVV protection from the ADC monitor outputs only (adin =
+    OVVCR_ADIN0EN_MASK and/or OVVCR_ADIN1EN_MASK, the OVV port is not
+    used): all outputs off within one conversion of the monitored
+    result, held until APMD_Protect_Release()
+ ===================================================================*/
+void APMD_OVV_Enable(TSB_PMD_TypeDef * PMDx, uint32_t adin, uint8_t count){
+    OVVCR_OVVEN_DISABLE(PMDx);                      // Settings change with the protection off
+    OVVCR_OVVISEL_DISABLE(PMDx);                    // Disable the OVV Input Port
+    OVVCR_ADIN0EN_DISABLE(PMDx);
+    OVVCR_ADIN1EN_DISABLE(PMDx);
+    if(adin & OVVCR_ADIN0EN_MASK){
+        OVVCR_ADIN0EN_ENABLE(PMDx);                 // ADC monitor 0 output
+    }
+    if(adin & OVVCR_ADIN1EN_MASK){
+        OVVCR_ADIN1EN_ENABLE(PMDx);                 // ADC monitor 1 output
+    }
+    OVVCR_OVVMD_ALLOFF(PMDx);                       // Upper and lower of every phase off
+    OVVCR_OVVRSMD_PROTECT(PMDx);                    // Held until OVVRS, not released with the input
+    OVVCR_OVVCNT(PMDx, (uint32_t)((count > APMD_FILTER_MAX) ? APMD_FILTER_MAX : count));
+    OVVCR_OVVEN_ENABLE(PMDx);
+}
+
+void APMD_OVV_Disable(TSB_PMD_TypeDef * PMDx){
+    OVVCR_OVVEN_DISABLE(PMDx);
+}
+
+/*===================================================================
+    Release the EMG / OVV protection state. Refused (false) while an
+    input is still active. Every phase is first put on fixed output,
+    both switches off, so the unit never resumes the pattern it had
+    at the trip; the state clears at the next carrier period (poll
+    getEMGSTA_reg() / getOVVSTA_reg()), then the caller restores MDOUT
+ ===================================================================*/
+bool APMD_Protect_Release(TSB_PMD_TypeDef * PMDx){
+    if((PMDx->EMGSTA & EMGSTA_EMGI_MASK) || (PMDx->OVVSTA & OVVSTA_OVVI_MASK)){
+        return false;
+    }
+    PMDx->MDOUT = 0x00UL;                           // xOC = 00, xPWM = 0: all outputs off
+    if(PMDx->EMGSTA & EMGSTA_EMGST_MASK){
+        EMGCR_EMGRS_PROTECTION(PMDx);
+    }
+    if(PMDx->OVVSTA & OVVSTA_OVVST_MASK){
+        OVVCR_OVVRS_PROTECTION(PMDx);
+    }
+    return true;
+}
+
+/*===================================================================
+    Staged configuration: load the PORTMD, MDCR, MDPOT, MDOUT and
+    EMGCR images, edit them in RAM with the register macros and
+    commit each changed register with a single write
+ ===================================================================*/
+void APMD_Stage_Begin(APMD_Stage * stage, TSB_PMD_TypeDef * PMDx){
+    stage->PMDx = PMDx;
+    stage->PORTMD = stage->loaded[0] = PMDx->PORTMD;
+    stage->MDCR = stage->loaded[1] = PMDx->MDCR;
+    stage->MDPOT = stage->loaded[2] = PMDx->MDPOT;
+    stage->MDOUT = stage->loaded[3] = PMDx->MDOUT;
+    stage->EMGCR = stage->loaded[4] = PMDx->EMGCR;
+}
+
+/* Only the registers being changed are checked, a commit never fails on state it does not touch */
+uint8_t APMD_Stage_Validate(const APMD_Stage * stage){
+    uint8_t err = APMD_STAGE_OK;
+    bool both_pmd = ((stage->PORTMD & PORTMD_PORTMD) == 0x03UL);
+    bool out_changed = (stage->MDOUT != stage->loaded[3]) || (stage->PORTMD != stage->loaded[0]);
+
+
+    /* A phase on fixed output (xPWM = 0) with xOC = High/High closes both switches of the leg */
+    for(uint8_t i = 0; i < APMD_PHASES_MAX; i++){
+        bool fixed = ((stage->MDOUT & (MDOUT_UPWM_MASK << i)) == 0);
+        if(out_changed && both_pmd && fixed && ((stage->MDOUT >> (2 * i)) & MDOUT_UOC_MASK) == 0x03UL){
+            err |= APMD_STAGE_ERR_SHOOT_THROUGH;
+        }
+    }
+
+    if((stage->EMGCR != stage->loaded[4]) && (stage->EMGCR & EMGCR_EMGEN_MASK) && (stage->EMGCR & EMGCR_EMGISEL_MASK)){
+        err |= APMD_STAGE_ERR_EMG_INPUT;
+    }
+
+    /* Inverting POLH/POLL under a running carrier glitches both gates at once */
+    if(both_pmd && (stage->PMDx->MDEN & 0x01UL) &&
+       ((stage->MDPOT ^ stage->loaded[2]) & (MDPOT_POLH_MASK | MDPOT_POLL_MASK))){
+        err |= APMD_STAGE_ERR_POL_RUNNING;
+    }
+    return err;
+}
+
+/* Returns the APMD_Stage_Validate() result, nothing is written unless it is APMD_STAGE_OK */
+uint8_t APMD_Stage_Commit(const APMD_Stage * stage){
+    TSB_PMD_TypeDef * PMDx = stage->PMDx;
+    uint8_t err = APMD_Stage_Validate(stage);
+    bool portmd_first = ((stage->PORTMD & ~stage->loaded[0] & PORTMD_PORTMD) == 0);  // Fewer PMD driven outputs
+
+    if(err != APMD_STAGE_OK){
+        return err;
+    }
+    if(stage->EMGCR != stage->loaded[4]){
+        if((stage->loaded[4] & EMGCR_EMGEN_MASK) && !(stage->EMGCR & EMGCR_EMGEN_MASK)){
+            EMGREL_EMGREL(PMDx, 0x5A);              // Key sequence before EMGEN can be cleared
+            EMGREL_EMGREL(PMDx, 0xA5);
+        }
+        PMDx->EMGCR = stage->EMGCR;
+    }
+    if(portmd_first && stage->PORTMD != stage->loaded[0]){
+        PMDx->PORTMD = stage->PORTMD;               // Outputs go to their fixed level before the PMD changes
+    }
+    if(stage->MDPOT != stage->loaded[2]){
+        PMDx->MDPOT = stage->MDPOT;
+    }
+    if(stage->MDCR != stage->loaded[1]){
+        PMDx->MDCR = stage->MDCR;
+    }
+    if(stage->MDOUT != stage->loaded[3]){
+        PMDx->MDOUT = stage->MDOUT;
+    }
+    if(!portmd_first && stage->PORTMD != stage->loaded[0]){
+        PMDx->PORTMD = stage->PORTMD;               // PMD outputs released once the rest is in place
+    }
+    return APMD_STAGE_OK;
+}
+
 /*===================================================================
     Set PWM Form (Sawtooth, Triangle, Reversed Sawtooth, etc)
  ===================================================================*/
 void setPWM_Form(TSB_PMD_TypeDef * PMDx){
+    APMD_Stage stage;
+
     MDEN_PWMEN_DISABLE(PMDx);       // Disable PWM to change its configuration
+    APMD_Stage_Begin(&stage, PMDx);
 
-    MDCR_DTYMD_INDEP(PMDx);         // Duty Mode independent for each phase
-    MDCR_DSYNCS_CENTER(PMDx);       // Update timing of the execution buffer at each phase PWM center
+    MDCR_DTYMD_INDEP(&stage);       // Duty Mode independent for each phase
+    MDCR_DSYNCS_CENTER(&stage);     // Update timing of the execution buffer at each phase PWM center
+    MBUFCR_BUFCTR_UPHASE_END(PMDx); // CMPx latched together into the intermediate buffer at the U-phase carrier end
 
     /* Wave Form Shape ( Sawtooth, Triangle, Reversed Sawtooth, Reversed Triangle) */
-    MDCR_UPWMMD_TRIANGLE(PMDx);     // U-phase PWM Carrier is a Triangle Wave
-    MDCR_VPWMMD_TRIANGLE(PMDx);     // V-phase PWM Carrier is a Triangle Wave
-    MDCR_WPWMMD_TRIANGLE(PMDx);     // V-phase PWM Carrier is a Triangle Wave
+    MDCR_UPWMMD_TRIANGLE(&stage);   // U-phase PWM Carrier is a Triangle Wave
+    MDCR_VPWMMD_TRIANGLE(&stage);   // V-phase PWM Carrier is a Triangle Wave
+    MDCR_WPWMMD_TRIANGLE(&stage);   // W-phase PWM Carrier is a Triangle Wave
 
     /* Output the U,V,W Phases to a PWM Signal */
-    MDOUT_UPWM_PWM(PMDx);           // Set U-Phase output to a PWM
-    MDOUT_VPWM_PWM(PMDx);          // Set V-Phase output to a PWM
-    MDOUT_WPWM_PWM(PMDx);           // Set W-Phase output to a PWM
+    MDOUT_UPWM_PWM(&stage);         // Set U-Phase output to a PWM
+    MDOUT_VPWM_PWM(&stage);         // Set V-Phase output to a PWM
+    MDOUT_WPWM_PWM(&stage);         // Set W-Phase output to a PWM
 
     /* Dead Time Correction */
-    MDCR_DTCREN_ENABLE(PMDx);       // Enables Dead Time Correction
+    MDCR_DTCREN_ENABLE(&stage);     // Enables Dead Time Correction
 
     /* Output Polarity for Upper and Lower Phase */
-    MDPOT_POLH_HIGH(PMDx);          // Upper-Phase High Active
-    MDPOT_POLL_HIGH(PMDx);          // Lower-Phase High Active
+    MDPOT_POLH_HIGH(&stage);        // Upper-Phase High Active
+    MDPOT_POLL_HIGH(&stage);        // Lower-Phase High Active
 
     /* Update Timing of the Execution Buffer */
-    MDPOT_PSYNCS_END(PMDx);         // Each Phase PWM Center
-    MDPOT_SYNCS_GENERAL(PMDx);      // General purpose timer interrupt
+    MDPOT_PSYNCS_END(&stage);       // Each Phase PWM Center
+    MDPOT_SYNCS_GENERAL(&stage);    // General purpose timer interrupt
 
+    APMD_Stage_Commit(&stage);      // One write per register
     //MDEN_PWMEN_ENABLE(PMDx);        // Enable the PWM function
 }
 
@@ -374,12 +343,251 @@ void setPWM_Frequency(TSB_PMD_TypeDef * PMDx, uint32_t value){
     Set PWM Duty Ratio (0x8000 = 100% | 0x4000 = 50% | 0x0000 = 0%)
  ===================================================================*/
 void setPWM_DutyRatio(TSB_PMD_TypeDef * PMDx, uint8_t phase, uint32_t value){
-    if (phase == 'U')
-        PWMCR_CMPU(PMDx, value);     // Set the Duty Ratio to its %
-    if (phase == 'V')
-        PWMCR_CMPV(PMDx, value);     // Set the Duty Ratio to its %
-    if (phase == 'W')
-        PWMCR_CMPW(PMDx, value);     // Set the Duty Ratio to its %
+    switch(phase){
+        case 'U':
+            PWMCR_CMPU(PMDx, value);     // Set the Duty Ratio to its %
+            break;
+        case 'V':
+            PWMCR_CMPV(PMDx, value);     // Set the Duty Ratio to its %
+            break;
+        case 'W':
+            PWMCR_CMPW(PMDx, value);     // Set the Duty Ratio to its %
+            break;
+        default:
+            break;
+    }
+}
+
+/*===================================================================
+    Set the U, V, W Duty Ratio together (0x8000 = 100%). The three
+    writes land in CMPU/V/W back to back; the intermediate buffer
+    (MBUFCR) latches them at one carrier point and the execution
+    buffer (MDCR_DSYNCS) applies them at the next PWM center, so a
+    call made between two latch points is never split across edges
+ ===================================================================*/
+void setPWM_DutyAll(TSB_PMD_TypeDef * PMDx, uint32_t u, uint32_t v, uint32_t w){
+    PMDx->CMPU = u;
+    PMDx->CMPV = v;
+    PMDx->CMPW = w;
+}
+
+/*===================================================================
+    Engineering units (Hz, ns, Q15). The scale factors are 32 bit fraction
+    fixed point computed once from SystemCoreClock, each conversion is one
+    64 bit multiply and shift rounded to the nearest LSB:
+        RATE = Hz * 2^24 / fsys         DTR = ns * fsys / 4e9
+ ===================================================================*/
+static uint64_t APMD_Rate_K = 0;                    // 2^56 / fsys (33 bits below 16.7 MHz)
+static uint32_t APMD_DTR_K = 0;                     // fsys * 2^32 / 4e9
+
+/* Call again after a SystemCoreClock change */
+void APMD_Units_Init(void){
+    uint64_t fsys = (uint64_t)SystemCoreClock;
+
+    APMD_Rate_K = ((1ULL << 56) + fsys / 2) / fsys;
+    APMD_DTR_K = (uint32_t)(((fsys << 32) + 2000000000ULL) / 4000000000ULL);
+}
+
+uint32_t APMD_Hz_To_RATE(uint32_t hz){
+    uint64_t rate;
+
+    if(APMD_Rate_K == 0){
+        APMD_Units_Init();
+    }
+    if(hz > SystemCoreClock){
+        hz = SystemCoreClock;                       // Above fsys the RATE clamps anyway, keeps the product in 64 bits
+    }
+    rate = ((uint64_t)hz * APMD_Rate_K + (1ULL << 31)) >> 32;
+    if(rate == 0){
+        return 1;                                   // Slowest carrier, a zero RATE stops the counter
+    }
+    return (rate > APMD_RATE_MAX) ? APMD_RATE_MAX : (uint32_t)rate;
+}
+
+uint32_t APMD_ns_To_DTR(uint32_t ns){
+    uint64_t dtr;
+
+    if(APMD_DTR_K == 0){
+        APMD_Units_Init();
+    }
+    dtr = ((uint64_t)ns * APMD_DTR_K + (1ULL << 31)) >> 32;
+    return (dtr > APMD_DTR_MAX) ? APMD_DTR_MAX : (uint32_t)dtr;
+}
+
+/* Q15 maps 1:1 onto the compare scale (0x8000 = 100%), negative duty clamps to 0% */
+uint32_t APMD_Q15_To_Duty(int32_t q15){
+    if(q15 < 0){
+        return 0;
+    }
+    return (q15 > APMD_DUTY_MAX) ? (uint32_t)APMD_DUTY_MAX : (uint32_t)q15;
+}
+
+void setPWM_Frequency_Hz(TSB_PMD_TypeDef * PMDx, uint32_t hz){
+    setPWM_Frequency(PMDx, APMD_Hz_To_RATE(hz));
+}
+
+/* Same as setPWM_DeadTime(), the PWM is left stopped */
+void setPWM_DeadTime_ns(TSB_PMD_TypeDef * PMDx, uint32_t ns){
+    setPWM_DeadTime(PMDx, APMD_ns_To_DTR(ns));
+}
+
+void setPWM_DutyRatio_Q15(TSB_PMD_TypeDef * PMDx, uint8_t phase, int32_t q15){
+    setPWM_DutyRatio(PMDx, phase, APMD_Q15_To_Duty(q15));
+}
+
+/*===================================================================
+    Interleaved operation: 'legs' fast legs on U, V, W of one unit,
+    started together and spread evenly over the carrier period
+    (2 legs -> 180 deg, 3 legs -> 120 deg). Legs are shed from W
+    down at light load; a shed leg holds both switches off
+ ===================================================================*/
+void APMD_Interleave_Init(APMD_Interleave * il, TSB_PMD_TypeDef * PMDx, uint8_t legs){
+    il->PMDx = PMDx;
+    il->legs = (legs == 0) ? 1 : ((legs > APMD_PHASES_MAX) ? APMD_PHASES_MAX : legs);
+    il->active = 0;
+    il->add_level = (uint16_t)(APMD_LOAD_LEG * 8 / 10);    // 80% of a leg
+    il->shed_level = (uint16_t)(APMD_LOAD_LEG * 6 / 10);   // 60% of a leg
+
+    APMD_Config(PMDx, il->legs, true);
+    setPWM_Form(PMDx);
+    APMD_Interleave_Set_Active(il, il->legs);
+}
+
+/* PMD1 and PMD2 carriers follow the PMD0 start, so units enabled together switch in step */
+void APMD_Interleave_Sync(TSB_PMD_TypeDef * PMDx, bool enable){
+    if(PMDx == TSB_PMD0){
+        return;                                     // PMD0 is the synchronisation source
+    }
+    if(enable){
+        SYNCCR_PWMSMD_ENABLE(PMDx);
+    }
+    else {
+        SYNCCR_PWMSMD_DISABLE(PMDx);
+    }
+}
+
+/* Returns the number of legs left switching */
+uint8_t APMD_Interleave_Set_Active(APMD_Interleave * il, uint8_t active){
+    APMD_Stage stage;
+    uint32_t step;
+
+    active = (active == 0) ? 1 : ((active > il->legs) ? il->legs : active);
+    if(active == il->active){
+        return active;
+    }
+
+    /* Spread the switching legs evenly, V and W are referenced to the U carrier */
+    step = APMD_PHASE_PERIOD / active;
+    VPWMPH_CMPV(il->PMDx, (active > 1) ? step : 0);
+    WPWMPH_CMPW(il->PMDx, (active > 2) ? 2 * step : 0);
+
+    APMD_Stage_Begin(&stage, il->PMDx);
+    MDOUT_UPWM_PWM(&stage);                         // Switching legs: both outputs enabled (APMD_LEG_PWM)
+    MDOUT_UOC_HIGH_HIGH(&stage);
+    MDOUT_VPWM_PWM(&stage);
+    MDOUT_VOC_HIGH_HIGH(&stage);
+    MDOUT_WPWM_PWM(&stage);
+    MDOUT_WOC_HIGH_HIGH(&stage);
+    if(active < 3){
+        MDOUT_WPWM_HL(&stage);                      // W held with both switches off
+        MDOUT_WOC_LOW_LOW(&stage);
+    }
+    if(active < 2){
+        MDOUT_VPWM_HL(&stage);                      // V held with both switches off
+        MDOUT_VOC_LOW_LOW(&stage);
+    }
+    if(APMD_Stage_Commit(&stage) == APMD_STAGE_OK){
+        il->active = active;
+    }
+    return il->active;
+}
+
+/* Phase shedding with hysteresis, load in APMD_LOAD_LEG units (e.g. line current amplitude
+   over the per-leg rating). Call from the slow loop, at most one leg changes per call */
+uint8_t APMD_Interleave_Update(APMD_Interleave * il, uint32_t load){
+    uint8_t n = il->active;
+
+    if(n < il->legs && load > (uint32_t)il->add_level * n){
+        n++;
+    }
+    else if(n > 1 && load < (uint32_t)il->shed_level * (n - 1)){
+        n--;
+    }
+    return APMD_Interleave_Set_Active(il, n);
+}
+
+/* Same duty on every switching leg, shed legs ignore their compare value */
+void APMD_Interleave_Duty(const APMD_Interleave * il, uint32_t value){
+    setPWM_DutyAll(il->PMDx, value, value, value);
+}
+
+/*===================================================================
+    Leg roles through the MDOUT output control, one read-modify-write
+    so it can run from the carrier interrupt. The new outputs reach
+    the pins at the MDPOT PSYNCS update timing
+ ===================================================================*/
+
+/* UPWM | UOC of the U phase for each APMD_Leg (V, W shifted). With UPWM set, UOC enables
+   the upper / lower PWM outputs, without it UOC is the fixed level. No entry holds both on */
+static const uint32_t APMD_Leg_Out[APMD_LEG_ROLES] = {
+    MDOUT_UPWM_MASK | 0x03UL,                   // APMD_LEG_PWM   - Complementary PWM
+    0x00UL,                                     // APMD_LEG_OFF   - Upper and lower off
+    0x02UL,                                     // APMD_LEG_UPPER - Upper on, lower off
+    0x01UL,                                     // APMD_LEG_LOWER - Lower on, upper off
+    MDOUT_UPWM_MASK | 0x02UL,                   // APMD_LEG_PWM_UPPER - Upper output only
+    MDOUT_UPWM_MASK | 0x01UL,                   // APMD_LEG_PWM_LOWER - Lower output only
+};
+
+void APMD_Leg_Set(TSB_PMD_TypeDef * PMDx, uint8_t phase, APMD_Leg leg){
+    uint32_t i = (uint32_t)(phase - 'U');           // 'U', 'V', 'W' -> 0, 1, 2
+    uint32_t mask, out;
+
+    if(i >= APMD_PHASES_MAX || leg >= APMD_LEG_ROLES){
+        return;
+    }
+    mask = (MDOUT_UOC_MASK << (2 * i)) | (MDOUT_UPWM_MASK << i);
+    out = ((APMD_Leg_Out[leg] & MDOUT_UOC_MASK) << (2 * i)) | ((APMD_Leg_Out[leg] & MDOUT_UPWM_MASK) << i);
+    PMDx->MDOUT = (PMDx->MDOUT & ~mask) | out;
+}
+
+/*===================================================================
+    Set the ADC Trigger outputs (TRG0 = Carrier Peak | TRG1 = TRGCMP1)
+ ===================================================================*/
+void APMD_ADC_Trigger_Config(TSB_PMD_TypeDef * PMDx){
+    TRGMD_EMGTGE_DISABLE(PMDx);                 // No trigger output while EMG protection is active
+    TRGMD_TRGOUT_FIXED(PMDx);                   // TRG0..3 wired to the ADC PMD trigger inputs
+
+    TRGCR_CARSEL_BASE_CARRIER(PMDx);            // Compare against the basic (U-phase) carrier
+    TRGCR_TRG0MD_CENTER_PWM(PMDx);              // TRG0 at the PWM center (Triangle carrier peak)
+    TRGCR_TRG0BE_SYNC(PMDx);                    // TRG0 buffered, updated at TSYNCS timing
+    TRGCR_TRG1MD_FIRSTHALF_TRIANGULAR(PMDx);    // TRG1 at TRGCMP1 match on the up-count
+    TRGCR_TRG1BE_SYNC(PMDx);                    // TRG1 buffered, updated at TSYNCS timing
+    TRGCR_TRG2MD_DISABLE(PMDx);
+    TRGCR_TRG3MD_DISABLE(PMDx);
+
+    TRGSYNCR_TSYNCS_CENTER(PMDx);               // Trigger compare buffers updated at the PWM center
+}
+
+/*===================================================================
+    Set ADC Trigger Compare (Same scale as the Duty Ratio, 0x0000 - 0x8000)
+ ===================================================================*/
+void setPWM_TriggerPoint(TSB_PMD_TypeDef * PMDx, uint8_t trg, uint32_t value){
+    switch(trg){
+        case 0:
+            TRGCMP0_TRGCMP0(PMDx, value);
+            break;
+        case 1:
+            TRGCMP1_TRGCMP1(PMDx, value);
+            break;
+        case 2:
+            TRGCMP2_TRGCMP2(PMDx, value);
+            break;
+        case 3:
+            TRGCMP3_TRGCMP3(PMDx, value);
+            break;
+        default:
+            break;
+    }
 }
 
 /*===================================================================
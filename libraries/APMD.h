@@ -79,6 +79,12 @@ extern "C" {
 #define OVVCR_OVVCNT_MASK                           (uint32_t)(0x1FUL << 8)
 #define OVVCR_OVVRSMD_MASK                          (uint32_t)(0x01UL << 15)
 
+/* PMD EMG / OVV Status Mask */
+#define EMGSTA_EMGST_MASK                           (uint32_t)(0x01UL)          // Protection state (outputs held)
+#define EMGSTA_EMGI_MASK                            (uint32_t)(0x01UL << 1)     // Input active, after the noise filter
+#define OVVSTA_OVVST_MASK                           (uint32_t)(0x01UL)
+#define OVVSTA_OVVI_MASK                            (uint32_t)(0x01UL << 1)
+
 /* PMD Trigger Control Mask */
 #define TRGCR_TRG0MD_MASK                           (uint32_t)(0x07UL)
 #define TRGCR_TRG0BE_MASK                           (uint32_t)(0x01UL << 3)
@@ -477,18 +483,124 @@ extern "C" {
 #define DBGOUTCR_INIFF_OUT_ZERO(obj)                ((obj)->DBGOUTCR = (uint32_t)(((obj)->DBGOUTCR & ~DBGOUTCR_INIFF_MASK) | (0x00U << 31)))
 #define DBGOUTCR_INIFF_OUT_ONE(obj)                 ((obj)->DBGOUTCR = (uint32_t)(((obj)->DBGOUTCR & ~DBGOUTCR_INIFF_MASK) | (0x01U << 31)))
 
+/*===================================================================*
+      Engineering unit front-end limits
+ *===================================================================*/
+#define APMD_RATE_MAX                               (uint32_t)(0x00FFFFFFUL)    // RATE is a 24 bit carrier increment
+#define APMD_DTR_MAX                                (uint32_t)(0x000003FFUL)    // DTR[9:0], 4/fsys per count
+#define APMD_DUTY_MAX                               (int32_t)(0x8000)           // 100% duty, Q15 1.0
+#define APMD_FILTER_MAX                             (uint8_t)(0x1F)             // EMGCNT / OVVCNT, 16/fsys per count
+
+/*===================================================================*
+                  Typedef Structures
+*===================================================================*/
+#define APMD_CHANNELS                               3           // A-PMD0, A-PMD1, A-PMD2
+#define APMD_PHASES_MAX                             3           // U, V, W
+#define APMD_CLK_BIT(n)                             (uint32_t)(0x01UL << (n))
+#define APMD_PIN_BIT(n)                             (uint32_t)(0x01UL << (n))
+
+/* Port, pins and clock gates of one A-PMD channel (a remap is a table edit in APMD.c) */
+typedef struct
+{
+    TSB_PMD_TypeDef * pmd;
+    volatile uint32_t * port_cr;                    // Port Output Control Register
+    volatile uint32_t * port_fr;                    // Port Function Register that selects the PMD outputs
+    volatile uint32_t * port_fr_alt;                // Function Register of the pins in fr_alt_pins (0 = none)
+    uint32_t fr_alt_pins;                           // Pins whose PMD output is on port_fr_alt instead
+    uint8_t upper_pin[APMD_PHASES_MAX];             // U, V, W pin number
+    uint8_t lower_pin[APMD_PHASES_MAX];             // X, Y, Z pin number (compliment)
+    volatile uint32_t * port_ie;                    // Port Input Enable Register (EMG input)
+    uint8_t emg_pin;                                // EMG input pin number, same function register
+    uint32_t fsysmena;                              // CGFSYSMENA bits (port clock)
+    uint32_t fsysmenb;                              // CGFSYSMENB bits (PMD clock)
+    uint32_t fsysena;                               // CGFSYSENA bits
+} APMD_PinMux;
+
+/* Staged configuration: the members carry the register names so every PORTMD_, MDCR_, MDPOT_,
+   MDOUT_ and EMGCR_ macro works on it unchanged, then APMD_Stage_Commit() writes each register once */
+typedef struct
+{
+    TSB_PMD_TypeDef * PMDx;
+    uint32_t PORTMD;
+    uint32_t MDCR;
+    uint32_t MDPOT;
+    uint32_t MDOUT;
+    uint32_t EMGCR;
+    uint32_t loaded[5];                             // Register values read by APMD_Stage_Begin()
+} APMD_Stage;
+
+/* APMD_Stage_Validate() result bits (0 = valid) */
+#define APMD_STAGE_OK                               (uint8_t)(0x00)
+#define APMD_STAGE_ERR_SHOOT_THROUGH                (uint8_t)(0x01)     // Fixed output turns on upper and lower of a leg
+#define APMD_STAGE_ERR_EMG_INPUT                    (uint8_t)(0x02)     // EMG protection enabled with its input port disabled
+#define APMD_STAGE_ERR_POL_RUNNING                  (uint8_t)(0x04)     // Polarity change while both outputs are driven by the running PMD
+
+/* Interleaved fast legs on the U, V, W outputs of one unit, carriers shifted by VPWMPH/WPWMPH */
+#define APMD_PHASE_PERIOD                           (uint32_t)(0x8000UL)    // One carrier period (360 deg) in VPWMPH/WPWMPH, same scale as CMPx
+#define APMD_LOAD_LEG                               (uint32_t)(0x8000UL)    // Shedding load scale: one leg at its rated current
+
+typedef struct
+{
+    TSB_PMD_TypeDef * PMDx;                         // Unit carrying the interleaved legs
+    uint8_t legs;                                   // Populated legs (1 - 3)
+    uint8_t active;                                 // Legs currently switching, always the first 'active' of U, V, W
+    uint16_t add_level;                             // Add a leg when load per active leg rises above (APMD_LOAD_LEG scale)
+    uint16_t shed_level;                            // Shed a leg when load per remaining leg falls below
+} APMD_Interleave;
+
+/* Role of one leg (phase) while the unit runs, see APMD_Leg_Set() */
+typedef enum
+{
+    APMD_LEG_PWM = 0,                               // Upper and lower switch complementary at the compare value
+    APMD_LEG_OFF,                                   // Both switches off (body diodes only)
+    APMD_LEG_UPPER,                                 // Upper switch held on
+    APMD_LEG_LOWER,                                 // Lower switch held on
+    APMD_LEG_PWM_UPPER,                             // Upper switch alone at the compare value, lower off (diode)
+    APMD_LEG_PWM_LOWER,                             // Lower switch alone at the complement, upper off (diode)
+    APMD_LEG_ROLES
+} APMD_Leg;
+
 /*===================================================================*
                   Functions declaration for A-PMD
 *===================================================================*/
 
 void APMD_Init(void);
 void APMD_Config(TSB_PMD_TypeDef * PMDx, uint8_t phase, bool comp);
+const APMD_PinMux * APMD_Get_PinMux(TSB_PMD_TypeDef * PMDx);
+void APMD_PinMux_Apply(const APMD_PinMux * mux, uint8_t phase, bool comp);
 void EMG_Disable(TSB_PMD_TypeDef * PMDx);
+void APMD_EMG_Enable(TSB_PMD_TypeDef * PMDx, uint8_t count);
+void APMD_OVV_Enable(TSB_PMD_TypeDef * PMDx, uint32_t adin, uint8_t count);
+void APMD_OVV_Disable(TSB_PMD_TypeDef * PMDx);
+bool APMD_Protect_Release(TSB_PMD_TypeDef * PMDx);
+
+void APMD_Stage_Begin(APMD_Stage * stage, TSB_PMD_TypeDef * PMDx);
+uint8_t APMD_Stage_Validate(const APMD_Stage * stage);
+uint8_t APMD_Stage_Commit(const APMD_Stage * stage);
 
 void setPWM_Form(TSB_PMD_TypeDef * PMDx);
 void setPWM_DeadTime(TSB_PMD_TypeDef * PMDx, uint32_t value);
 void setPWM_Frequency(TSB_PMD_TypeDef * PMDx, uint32_t value);
 void setPWM_DutyRatio(TSB_PMD_TypeDef * PMDx, uint8_t phase, uint32_t value);
+void setPWM_DutyAll(TSB_PMD_TypeDef * PMDx, uint32_t u, uint32_t v, uint32_t w);
+
+void APMD_Units_Init(void);
+uint32_t APMD_Hz_To_RATE(uint32_t hz);
+uint32_t APMD_ns_To_DTR(uint32_t ns);
+uint32_t APMD_Q15_To_Duty(int32_t q15);
+void setPWM_Frequency_Hz(TSB_PMD_TypeDef * PMDx, uint32_t hz);
+void setPWM_DeadTime_ns(TSB_PMD_TypeDef * PMDx, uint32_t ns);
+void setPWM_DutyRatio_Q15(TSB_PMD_TypeDef * PMDx, uint8_t phase, int32_t q15);
+
+void APMD_Interleave_Init(APMD_Interleave * il, TSB_PMD_TypeDef * PMDx, uint8_t legs);
+void APMD_Interleave_Sync(TSB_PMD_TypeDef * PMDx, bool enable);
+uint8_t APMD_Interleave_Set_Active(APMD_Interleave * il, uint8_t active);
+uint8_t APMD_Interleave_Update(APMD_Interleave * il, uint32_t load);
+void APMD_Interleave_Duty(const APMD_Interleave * il, uint32_t value);
+void APMD_Leg_Set(TSB_PMD_TypeDef * PMDx, uint8_t phase, APMD_Leg leg);
+
+void APMD_ADC_Trigger_Config(TSB_PMD_TypeDef * PMDx);
+void setPWM_TriggerPoint(TSB_PMD_TypeDef * PMDx, uint8_t trg, uint32_t value);
 
 uint32_t getMDEN_reg(TSB_PMD_TypeDef * PMDx);
 uint32_t getPORTMD_reg(TSB_PMD_TypeDef * PMDx);
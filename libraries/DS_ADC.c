@@ -12,24 +12,77 @@
 
 #include "TMPM4KyA.h"
 #include "DS_ADC.h"
+#include "DS_DMA.h"
 #include "sys_timer.h"
 //#include "DS_APMD.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 
+/*  Type of reading per unit: Single_Conversion, Continuous_Conversion, General_Purpose or PMD_Trigger  */
+#define ADC_A_CONVERSION_MODE               PMD_Trigger         // Currents and voltages on the PWM carrier
+#define ADC_B_CONVERSION_MODE               Continuous_Conversion
+#define ADC_C_CONVERSION_MODE               General_Purpose
+
+#define ADC_EXAZ_DEFAULT                    0x01UL              // SCLK period x 2n (SCLK = 40MHz)
+#define ADC_MOD1_DEFAULT                    0x306122UL          // Conversion time 0.96 us (SCLK = 40 MHz)
+//#define ADC_MOD1_DEFAULT                  0x308012UL          // Conversion time 0.91 us (SCLK = 30 MHz)
+//#define ADC_MOD1_DEFAULT                  0x104011UL          // Conversion time 1.09 us (SCLK = 20 MHz)
+
+/*  PMD Trigger programs for ADA (TRG0 -> PSEL0 -> PSET0 | TRG1 -> PSEL1 -> PSET1)  */
+#define ADC_PMD_PROG_PEAK                   (uint8_t) 0x00      // Started by PMD0 TRG0 (Carrier Peak), ends in INTADAPDA
+#define ADC_PMD_PROG_CMP                    (uint8_t) 0x01      // Started by PMD0 TRG1 (TRGCMP1), ends in INTADAPDB
+
+
 /*===================================================================*
                 Analog to Digital Conversion Initialization
 *===================================================================*/
 
-ADxConversionType ADxType;
-
-void ADC_Init(TSB_AD_TypeDef * ADx){
-    ADxType.typex = Single_Conversion;      // Sets the type of reading for the ADC
+ADC_Handle ADC_Handle_A = {
+    TSB_ADA, ADC_A_CONVERSION_MODE, 11,
+    /* AINA05 - PM2, AINA06 - PM1, AINA07 - PM0, AINA08 - PL7, AINA09 - PL6, AINA13 - PL5,
+       AINA14 - PL3, AINA15 - PL1, AINA16 - PL0, AINA17 - PL2, AINA18 - PL4 */
+    { 0x05, 0x06, 0x07, 0x08, 0x09, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12 },
+    0, 0, ADC_EXAZ_DEFAULT, ADC_MOD1_DEFAULT, 0, ADC_GAIN_UNITY, DMA_CH_ADA_CNT
+};
+
+ADC_Handle ADC_Handle_B = {
+    TSB_ADB, ADC_B_CONVERSION_MODE, 5,
+    /* AINB00 - PK0, AINB01 - PK1, AINB02 - PK2, AINB03 - PK3, AINB04 - PK4 */
+    { 0x00, 0x01, 0x02, 0x03, 0x04 },
+    0, 0, ADC_EXAZ_DEFAULT, ADC_MOD1_DEFAULT, 0, ADC_GAIN_UNITY, ADC_NO_DMA
+};
+
+ADC_Handle ADC_Handle_C = {
+    TSB_ADC, ADC_C_CONVERSION_MODE, 6,
+    /* AINC00 - PJ0, AINC01 - PJ1, AINC02 - PJ2, AINC03 - PJ3, AINC04 - PJ4, AINC05 - PJ5 */
+    { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 },
+    0, 0, ADC_EXAZ_DEFAULT, ADC_MOD1_DEFAULT, 0, ADC_GAIN_UNITY, ADC_NO_DMA
+};
+
+/* Latest PMD triggered samples, written only by INTADAPDA/INTADAPDB */
+volatile uint16_t ADC_PMD_Sample[ADC_PMD_SLOTS];
+volatile uint32_t ADC_PMD_Count = 0;
+static void (*ADC_PMD_Callback)(void) = 0;
+static bool ADC_PMD_Running = false;                // ADA acquisition belongs to the PMD trigger programs
+static ADC_Decimator * ADC_PMD_Decim = 0;           // Decimators on PMD slots, fed from INTADAPDB
+static uint8_t ADC_PMD_Decim_Count = 0;
+
+static TSB_AD_TypeDef * const ADC_Unit_Table[ADC_UNITS] = { TSB_ADA, TSB_ADB, TSB_ADC };
+
+static int8_t ADC_Unit(TSB_AD_TypeDef * ADx){
+    for(uint8_t i = 0; i < ADC_UNITS; i++){
+        if(ADC_Unit_Table[i] == ADx){
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
 
-    ADC_CG_Config(ADx);
-    ADC_Config(ADx);
-    ADC_Conversion_Setting(ADx);
+void ADC_Init(ADC_Handle * adc){
+    ADC_CG_Config(adc->ADx);
+    ADC_Config(adc);
+    ADC_Conversion_Setting(adc);
 }
 
 void ADC_CG_Config(TSB_AD_TypeDef * ADx){
@@ -90,23 +143,23 @@ void ADC_CG_Config(TSB_AD_TypeDef * ADx){
             /* Configure PORT M ADA07(PM0), ADA06(PM1), ADA05(PM2) */
             TSB_CG_FSYSMENA_IPMENA11 = 1;       // Clock enable of PORT M
             /* PM0 */
-            TSB_PL_CR_PM0C = 0;                 // Sets Pin PM0 as input
-            TSB_PL_OD_PM0OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PM0IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PM0UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PM0DN = 0;               // Disable pull-down
+            TSB_PM_CR_PM0C = 0;                 // Sets Pin PM0 as input
+            TSB_PM_OD_PM0OD = 0;                // Sets Open-Drain OFF
+            TSB_PM_IE_PM0IE = 0;                // Sets Input as disable
+            TSB_PM_PUP_PM0UP = 0;               // Disable pull-up
+            TSB_PM_PDN_PM0DN = 0;               // Disable pull-down
             /* PM1 */
-            TSB_PL_CR_PM1C = 0;                 // Sets Pin PM1 as input
-            TSB_PL_OD_PM1OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PM1IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PM1UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PM1DN = 0;               // Disable pull-down
+            TSB_PM_CR_PM1C = 0;                 // Sets Pin PM1 as input
+            TSB_PM_OD_PM1OD = 0;                // Sets Open-Drain OFF
+            TSB_PM_IE_PM1IE = 0;                // Sets Input as disable
+            TSB_PM_PUP_PM1UP = 0;               // Disable pull-up
+            TSB_PM_PDN_PM1DN = 0;               // Disable pull-down
             /* PM2 */
-            TSB_PL_CR_PM2C = 0;                 // Sets Pin PM2 as input
-            TSB_PL_OD_PM2OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PM2IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PM2UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PM2DN = 0;               // Disable pull-down
+            TSB_PM_CR_PM2C = 0;                 // Sets Pin PM2 as input
+            TSB_PM_OD_PM2OD = 0;                // Sets Open-Drain OFF
+            TSB_PM_IE_PM2IE = 0;                // Sets Input as disable
+            TSB_PM_PUP_PM2UP = 0;               // Disable pull-up
+            TSB_PM_PDN_PM2DN = 0;               // Disable pull-down
 
             TSB_CG_FSYSMENB_IPMENB02 = 1;       // Clock enable of ADC Unit A
             TSB_CG_SPCLKEN_ADCKEN0 = 1;         // Clock enable for ADC Unit A
@@ -116,38 +169,38 @@ void ADC_CG_Config(TSB_AD_TypeDef * ADx){
             /* Configure PORT K ADB00(PK0), ADB01(PK1), ADB02(PK2), ADB03(PK3), ADB04(PK4) */
             TSB_CG_FSYSMENA_IPMENA09 = 1;       // Clock enable of PORT K
             /* PK0 */
-            TSB_PL_CR_PK0C = 0;                 // Sets Pin PK0 as input
-            TSB_PL_OD_PK0OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PK0IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PK0UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PK0DN = 0;               // Disable pull-down
+            TSB_PK_CR_PK0C = 0;                 // Sets Pin PK0 as input
+            TSB_PK_OD_PK0OD = 0;                // Sets Open-Drain OFF
+            TSB_PK_IE_PK0IE = 0;                // Sets Input as disable
+            TSB_PK_PUP_PK0UP = 0;               // Disable pull-up
+            TSB_PK_PDN_PK0DN = 0;               // Disable pull-down
             /* PK1 */
-            TSB_PL_CR_PK1C = 0;                 // Sets Pin PK1 as input
-            TSB_PL_OD_PK1OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PK1IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PK1UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PK1DN = 0;               // Disable pull-down
+            TSB_PK_CR_PK1C = 0;                 // Sets Pin PK1 as input
+            TSB_PK_OD_PK1OD = 0;                // Sets Open-Drain OFF
+            TSB_PK_IE_PK1IE = 0;                // Sets Input as disable
+            TSB_PK_PUP_PK1UP = 0;               // Disable pull-up
+            TSB_PK_PDN_PK1DN = 0;               // Disable pull-down
             /* PK2 */
-            TSB_PL_CR_PK2C = 0;                 // Sets Pin PK2 as input
-            TSB_PL_OD_PK2OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PK2IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PK2UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PK2DN = 0;               // Disable pull-down
+            TSB_PK_CR_PK2C = 0;                 // Sets Pin PK2 as input
+            TSB_PK_OD_PK2OD = 0;                // Sets Open-Drain OFF
+            TSB_PK_IE_PK2IE = 0;                // Sets Input as disable
+            TSB_PK_PUP_PK2UP = 0;               // Disable pull-up
+            TSB_PK_PDN_PK2DN = 0;               // Disable pull-down
             /* PK3 */
-            TSB_PL_CR_PK3C = 0;                 // Sets Pin PK3 as input
-            TSB_PL_OD_PK3OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PK3IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PK3UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PK3DN = 0;               // Disable pull-down
+            TSB_PK_CR_PK3C = 0;                 // Sets Pin PK3 as input
+            TSB_PK_OD_PK3OD = 0;                // Sets Open-Drain OFF
+            TSB_PK_IE_PK3IE = 0;                // Sets Input as disable
+            TSB_PK_PUP_PK3UP = 0;               // Disable pull-up
+            TSB_PK_PDN_PK3DN = 0;               // Disable pull-down
             /* PK4 */
-            TSB_PL_CR_PPK4C = 0;                 // Sets Pin PK4 as input
-            TSB_PL_OD_PPK4OD = 0;                // Sets Open-Drain OFF
-            TSB_PL_IE_PPK4IE = 0;                // Sets Input as disable
-            TSB_PL_PUP_PPK4UP = 0;               // Disable pull-up
-            TSB_PL_PDN_PPK4DN = 0;               // Disable pull-down
-
-            TSB_CG_FSYSMENB_IPMENB02 = 1;       // Clock enable of ADC Unit A
-            TSB_CG_SPCLKEN_ADCKEN0 = 1;         // Clock enable for ADC Unit A
+            TSB_PK_CR_PK4C = 0;                 // Sets Pin PK4 as input
+            TSB_PK_OD_PK4OD = 0;                // Sets Open-Drain OFF
+            TSB_PK_IE_PK4IE = 0;                // Sets Input as disable
+            TSB_PK_PUP_PK4UP = 0;               // Disable pull-up
+            TSB_PK_PDN_PK4DN = 0;               // Disable pull-down
+
+            TSB_CG_FSYSMENB_IPMENB03 = 1;       // Clock enable of ADC Unit B
+            TSB_CG_SPCLKEN_ADCKEN1 = 1;         // Clock enable for ADC Unit B
             break;
 
         case (intptr_t)TSB_ADC : 
@@ -199,140 +252,491 @@ void ADC_CG_Config(TSB_AD_TypeDef * ADx){
     }
 }
 
-void ADC_Config(TSB_AD_TypeDef * ADx){
+void ADC_Config(ADC_Handle * adc){
+    TSB_AD_TypeDef * ADx = adc->ADx;
+
     MOD0_DACON_ON(ADx);                 // DAC On
     wait(3);                            // Wait 3 us
     MOD0_RCUT_OFF(ADx);                 // Normal Operation
-    CLK_EXAZ0_SCLKx2N(ADx);             // SCLK period x 2n (SCLK = 40MHz)
-    MOD1_MOD1(ADx, 0x306122);           // Conversion time 0.96 us (SCLK = 40 MHz)
-    //MOD1_MOD1(ADx, 0x308012);         // Conversion time 0.91 us (SCLK = 30 MHz)
-    //MOD1_MOD1(ADx, 0x104011);         // Conversion time 1.09 us (SCLK = 20 MHz)
+    CLK_EXAZ0(ADx, adc->exaz);          // Sampling time of this unit
+    MOD1_MOD1(ADx, adc->mod1);          // Conversion timing for its SCLK
 }
 
-void ADC_Conversion_Setting(TSB_AD_TypeDef * ADx){
-    switch (ADxType.typex){
-        case Single_Conversion:
-            TSETx_TRGS0_SINGLE_CONV(ADx->TSET0);
-            TSETx_TRGS0_SINGLE_CONV(ADx->TSET1);
-            TSETx_TRGS0_SINGLE_CONV(ADx->TSET2);
-            break;
-        case Continuous_Conversion:
-            TSETx_TRGS0_CONTINUOUS(ADx->TSET0);
-            TSETx_TRGS0_CONTINUOUS(ADx->TSET1);
-            TSETx_TRGS0_CONTINUOUS(ADx->TSET2);
-            break;
+void ADC_Conversion_Setting(ADC_Handle * adc){
+    TSB_AD_TypeDef * ADx = adc->ADx;
+    volatile uint32_t * tset = &ADx->TSET0;     // TSET0..TSET23 are contiguous
+    uint8_t n;
+
+    CR0_ADEN_DISABLE(ADx);
+    CR1_TRGEN_DISABLE(ADx);
+    for(n = 0; n < ADC_RESULT_REGS; n++){
+        tset[n] = 0;                            // No conversion, the unused TSETn stay off
+    }
+    for(n = 0; n < adc->channels && n < ADC_RESULT_REGS; n++){
+        TSETx_AINST0(tset[n], adc->ain[n]);
+        switch (adc->mode){
+            case Single_Conversion:
+                TSETx_TRGS0_SINGLE_CONV(tset[n]);
+                break;
+            case Continuous_Conversion:
+                TSETx_TRGS0_CONTINUOUS(tset[n]);
+                break;
+            case General_Purpose:
+                TSETx_TRGS0_GENERAL(tset[n]);
+                break;
+            default:
+                break;                          // PMD_Trigger: PSETx programs only
+        }
+        TSETx_ENINT0_DISABLE(tset[n]);          // Disable the interrupt control for the ADC
+    }
+    switch (adc->mode){
         case General_Purpose:
-            TSETx_TRGS0_GENERAL(ADx->TSET0);
-            TSETx_TRGS0_GENERAL(ADx->TSET1);
-            TSETx_TRGS0_GENERAL(ADx->TSET2);
+            if(adc->trigger != 0){
+                *adc->trigger = adc->trigger_cr;
+            }
+            CR1_TRGEN_ENABLE(ADx);
+            CR0_ADEN_ENABLE(ADx);               // Wait for the general purpose trigger
             break;
         case PMD_Trigger:
-            break;
-        default:
-            TSETx_TRGS0_NO_CONV(ADx->TSET0);
-            TSETx_TRGS0_NO_CONV(ADx->TSET1);
-            TSETx_TRGS0_NO_CONV(ADx->TSET2);
-            break;
-    }
-    switch((intptr_t)ADx){
-        case (intptr_t)TSB_ADA :
-            /* Store the value of AINA05 to register TSET0 */
-            TSETx_AINST0(ADx->TSET0, 0x05);     // AINA05 - PM2
-            /* Store the value of AINA06 to register TSET1 */
-            TSETx_AINST0(ADx->TSET1, 0x06);     // AINA06 - PM1
-            /* Store the value of AINA07 to register TSET2 */
-            TSETx_AINST0(ADx->TSET2, 0x07);     // AINA07 - PM0
-            /* Store the value of AINA08 to register TSET3 */
-            TSETx_AINST0(ADx->TSET3, 0x08);     // AINA08 - PL7
-            /* Store the value of AINA09 to register TSET4 */
-            TSETx_AINST0(ADx->TSET4, 0x09);     // AINA09 - PL6
-            /* Store the value of AINA13 to register TSET5 */
-            TSETx_AINST0(ADx->TSET5, 0x0D);     // AINA13 - PL5
-            /* Store the value of AINA14 to register TSET6 */
-            TSETx_AINST0(ADx->TSET6, 0x0E);     // AINA14 - PL3
-            /* Store the value of AINA15 to register TSET7 */
-            TSETx_AINST0(ADx->TSET7, 0x0F);     // AINA15 - PL1
-            /* Store the value of AINA16 to register TSET8 */
-            TSETx_AINST0(ADx->TSET8, 0x10);     // AINA16 - PL0
-            /* Store the value of AINA17 to register TSET9 */
-            TSETx_AINST0(ADx->TSET9, 0x11);     // AINA17 - PL2
-            /* Store the value of AINA18 to register TSET10 */
-            TSETx_AINST0(ADx->TSET10, 0x12);     // AINA18 - PL4
-
-            /* Disable the interrupt control for the ADC */
-            TSETx_ENINT0_DISABLE(ADx->TSET0);
-            TSETx_ENINT0_DISABLE(ADx->TSET1);
-            TSETx_ENINT0_DISABLE(ADx->TSET2);
-            TSETx_ENINT0_DISABLE(ADx->TSET3);
-            TSETx_ENINT0_DISABLE(ADx->TSET4);
-            TSETx_ENINT0_DISABLE(ADx->TSET5);
-            TSETx_ENINT0_DISABLE(ADx->TSET6);
-            TSETx_ENINT0_DISABLE(ADx->TSET7);
-            TSETx_ENINT0_DISABLE(ADx->TSET8);
-            TSETx_ENINT0_DISABLE(ADx->TSET9);
-            TSETx_ENINT0_DISABLE(ADx->TSET10);
-            break;
-        case (intptr_t)TSB_ADB :
-            /* Store the value of AINC00 to register TSET0 */
-            TSETx_AINST0(ADx->TSET0, 0x00);     // AINB00 - PK0
-            /* Store the value of AINC01 to register TSET1 */
-            TSETx_AINST0(ADx->TSET1, 0x01);     // AINB01 - PK1
-            /* Store the value of AINC02 to register TSET2 */
-            TSETx_AINST0(ADx->TSET2, 0x02);     // AINB02 - PK2
-            /* Store the value of AINC03 to register TSET3 */
-            TSETx_AINST0(ADx->TSET3, 0x03);     // AINB03 - PK3
-            /* Store the value of AINC04 to register TSET4 */
-            TSETx_AINST0(ADx->TSET4, 0x04);     // AINB04 - PK4
-
-            /* Disable the interrupt control for the ADC */
-            TSETx_ENINT0_DISABLE(ADx->TSET0);
-            TSETx_ENINT0_DISABLE(ADx->TSET1);
-            TSETx_ENINT0_DISABLE(ADx->TSET2);
-            TSETx_ENINT0_DISABLE(ADx->TSET3);
-            TSETx_ENINT0_DISABLE(ADx->TSET4);
-            break;
-        case (intptr_t)TSB_ADC :
-            /* Store the value of AINC00 to register TSET0 */
-            TSETx_AINST0(ADx->TSET0, 0x00);     // AINC00 - PJ0
-            /* Store the value of AINC01 to register TSET1 */
-            TSETx_AINST0(ADx->TSET1, 0x01);     // AINC01 - PJ1
-            /* Store the value of AINC02 to register TSET2 */
-            TSETx_AINST0(ADx->TSET2, 0x02);     // AINC02 - PJ2
-            /* Store the value of AINC03 to register TSET3 */
-            TSETx_AINST0(ADx->TSET3, 0x03);     // AINC03 - PJ3
-            /* Store the value of AINC04 to register TSET4 */
-            TSETx_AINST0(ADx->TSET4, 0x04);     // AINC04 - PJ4
-            /* Store the value of AINC05 to register TSET5 */
-            TSETx_AINST0(ADx->TSET5, 0x05);     // AINC05 - PJ5
-
-            /* Disable the interrupt control for the ADC */
-            TSETx_ENINT0_DISABLE(ADx->TSET0);
-            TSETx_ENINT0_DISABLE(ADx->TSET1);
-            TSETx_ENINT0_DISABLE(ADx->TSET2);
-            TSETx_ENINT0_DISABLE(ADx->TSET3);
-            TSETx_ENINT0_DISABLE(ADx->TSET4);
-            TSETx_ENINT0_DISABLE(ADx->TSET5);
+            ADC_PMD_Trigger_Setting(ADx);
             break;
         default:
             break;
     }
 }
 
-void ADC_Conversion_Start(TSB_AD_TypeDef * ADx){
-    CR0_ADEN_ENABLE(ADx);
-    switch (ADxType.typex){
+void ADC_Conversion_Start(ADC_Handle * adc){
+    TSB_AD_TypeDef * ADx = adc->ADx;
+
+    switch (adc->mode){
         case Single_Conversion:
+            CR0_ADEN_ENABLE(ADx);
             CR0_SGL_START(ADx);
             break;
         case Continuous_Conversion:
-            while((getADC_ST(ADx) & 0x08) >> 4){}
-            CR0_CNT_ENABLE(ADx);
+            if((getADC_ST(ADx) & ST_CNTF_MASK) == 0){
+                CR0_ADEN_ENABLE(ADx);
+                CR0_CNT_ENABLE(ADx);    // Runs on its own after the first start
+            }
             break;
         default:
+            /* General_Purpose / PMD_Trigger: started by the trigger inputs, nothing to start here */
             break;
     }
 }
 
+/*===================================================================*
+            Continuous Scan (DMA into ping-pong sample frames)
+*===================================================================*/
+
+static volatile uint32_t ADC_Scan_Frame[ADC_UNITS][2][ADC_RESULT_REGS];
+static ADC_Frame_Callback ADC_Scan_Callback[ADC_UNITS];
+static uint8_t ADC_Scan_Channels[ADC_UNITS];
+static uint8_t ADC_Scan_DMA[ADC_UNITS] = { ADC_NO_DMA, ADC_NO_DMA, ADC_NO_DMA };
+static volatile uint32_t ADC_Scan_Count[ADC_UNITS];
+
+/* One frame landed, the other half is filling while the callback reads this one */
+static void ADC_Scan_Done(uint8_t ch, bool alternate){
+    for(uint8_t unit = 0; unit < ADC_UNITS; unit++){
+        if(ADC_Scan_DMA[unit] == ch){
+            ADC_Scan_Count[unit]++;
+            if(ADC_Scan_Callback[unit] != 0){
+                ADC_Scan_Callback[unit](ADC_Scan_Frame[unit][alternate ? 1 : 0], ADC_Scan_Channels[unit]);
+            }
+            return;
+        }
+    }
+}
+
+/*===================================================================
+    Convert TSET0..TSET(channels - 1) back to back in continuous mode,
+    the end of every pass requests the DMA, which moves the whole pass
+    in one arbitration into the next frame. One INTDMAATC per frame,
+    no polling. The unit stays in Continuous_Conversion until
+    ADC_Scan_Stop(). False if the unit has no DMA request
+ ===================================================================*/
+bool ADC_Scan_Start(ADC_Handle * adc, ADC_Frame_Callback callback){
+    int8_t unit = ADC_Unit(adc->ADx);
+
+    if(unit < 0 || adc->dma == ADC_NO_DMA || adc->channels == 0 || adc->channels > ADC_RESULT_REGS){
+        return false;
+    }
+    CR0_CNT_DISABLE(adc->ADx);
+    CR1_CNTDMEN_DISABLE(adc->ADx);
+    ADC_Scan_Callback[unit] = callback;
+    ADC_Scan_Channels[unit] = adc->channels;
+    ADC_Scan_DMA[unit] = adc->dma;
+    ADC_Scan_Count[unit] = 0;
+
+    adc->mode = Continuous_Conversion;
+    ADC_Conversion_Setting(adc);
+
+    DMA_Init();
+    DMA_PingPong_Start(adc->dma, &adc->ADx->REG0, ADC_Scan_Frame[unit][0], ADC_Scan_Frame[unit][1], adc->channels,
+                       DMACTRL_SRC_SIZE(DMA_WORD) | DMACTRL_SRC_INC(DMA_WORD) |
+                       DMACTRL_DST_SIZE(DMA_WORD) | DMACTRL_DST_INC(DMA_WORD) |
+                       DMACTRL_R_POWER(5), ADC_Scan_Done);        // 32 transfers per arbitration, a pass in one go
+    CR1_CNTDMEN_ENABLE(adc->ADx);
+    ADC_Conversion_Start(adc);
+    return true;
+}
+
+void ADC_Scan_Stop(ADC_Handle * adc){
+    int8_t unit = ADC_Unit(adc->ADx);
+
+    if(unit < 0 || ADC_Scan_DMA[unit] == ADC_NO_DMA){
+        return;
+    }
+    CR0_CNT_DISABLE(adc->ADx);
+    CR1_CNTDMEN_DISABLE(adc->ADx);
+    DMA_Stop(ADC_Scan_DMA[unit]);
+    ADC_Scan_DMA[unit] = ADC_NO_DMA;
+}
+
+uint32_t ADC_Scan_Frames(ADC_Handle * adc){
+    int8_t unit = ADC_Unit(adc->ADx);
+
+    return (unit >= 0) ? ADC_Scan_Count[unit] : 0;
+}
+
+/*===================================================================*
+                Oversampling and Decimation (CIC / boxcar)
+*===================================================================*/
+
+static ADC_Decimator * ADC_Decim_List[ADC_UNITS];
+static uint8_t ADC_Decim_Count[ADC_UNITS];
+
+bool ADC_Decim_Init(ADC_Decimator * dec, uint8_t reg, uint8_t rate_log2, uint8_t order, uint8_t extra_bits){
+    if(reg >= ADC_RESULT_REGS || order == 0 || order > ADC_DECIM_ORDER_MAX || extra_bits > ADC_DECIM_EXTRA_MAX ||
+       (uint32_t)order * rate_log2 > ADC_DECIM_GROWTH_MAX || extra_bits > (uint32_t)order * rate_log2){
+        return false;
+    }
+    dec->reg = reg;
+    dec->rate_log2 = rate_log2;
+    dec->order = order;
+    dec->extra_bits = extra_bits;
+    for(uint8_t i = 0; i < ADC_DECIM_ORDER_MAX; i++){
+        dec->integ[i] = 0;
+        dec->comb[i] = 0;
+    }
+    dec->phase = 0;
+    dec->out = 0;
+    dec->count = 0;
+    return true;
+}
+
+/* One 12 bit input sample, true when it completed an output. The words wrap, the combs undo it */
+bool ADC_Decim_Push(ADC_Decimator * dec, uint16_t code){
+    uint32_t value;
+    uint32_t last;
+    uint8_t i;
+
+    dec->integ[0] += code;
+    for(i = 1; i < dec->order; i++){
+        dec->integ[i] += dec->integ[i - 1];
+    }
+    if(++dec->phase < (1U << dec->rate_log2)){
+        return false;
+    }
+    dec->phase = 0;
+    value = dec->integ[dec->order - 1];
+    for(i = 0; i < dec->order; i++){
+        last = dec->comb[i];
+        dec->comb[i] = value;
+        value -= last;
+    }
+    dec->out = value >> ((uint32_t)dec->order * dec->rate_log2 - dec->extra_bits);
+    dec->count++;
+    return true;
+}
+
+/* Every decimator takes its channel out of one scan frame */
+void ADC_Decim_Frame(ADC_Decimator * dec, uint8_t n, const volatile uint32_t * frame){
+    for(uint8_t i = 0; i < n; i++){
+        ADC_Decim_Push(&dec[i], ADC_FRAME_CODE(frame[dec[i].reg]));
+    }
+}
+
+static void ADC_Oversample_Frame(uint8_t unit, const volatile uint32_t * frame, uint8_t channels){
+    ADC_Decimator * dec = ADC_Decim_List[unit];
+
+    for(uint8_t i = 0; i < ADC_Decim_Count[unit]; i++){
+        if(dec[i].reg < channels){
+            ADC_Decim_Push(&dec[i], ADC_FRAME_CODE(frame[dec[i].reg]));
+        }
+    }
+}
+
+static void ADC_Oversample_A(const volatile uint32_t * frame, uint8_t channels){ ADC_Oversample_Frame(0, frame, channels); }
+static void ADC_Oversample_B(const volatile uint32_t * frame, uint8_t channels){ ADC_Oversample_Frame(1, frame, channels); }
+static void ADC_Oversample_C(const volatile uint32_t * frame, uint8_t channels){ ADC_Oversample_Frame(2, frame, channels); }
+
+static const ADC_Frame_Callback ADC_Oversample_Table[ADC_UNITS] = { ADC_Oversample_A, ADC_Oversample_B, ADC_Oversample_C };
+
+/*===================================================================
+    Hardware timed oversampling: the unit scans continuously (DMA
+    frames, ADC_Scan_Start()) and each decimator (set up by
+    ADC_Decim_Init()) filters its own channel at its own ratio, read
+    dec[i].out whenever needed. The scan pass rate is the input rate.
+    Refused for a unit without a DMA channel and for ADA once its PMD
+    trigger programs run (ADC_Oversample_PMD() then)
+ ===================================================================*/
+bool ADC_Oversample_Start(ADC_Handle * adc, ADC_Decimator * dec, uint8_t n){
+    int8_t unit = ADC_Unit(adc->ADx);
+
+    if(unit < 0 || n > ADC_DECIM_MAX || (adc->ADx == TSB_ADA && ADC_PMD_Running)){
+        return false;
+    }
+    ADC_Decim_List[unit] = dec;
+    ADC_Decim_Count[unit] = n;
+    return ADC_Scan_Start(adc, ADC_Oversample_Table[unit]);
+}
+
+/*===================================================================
+    PMD triggered oversampling: dec[i].reg is a PMD slot (0 ..
+    ADC_PMD_SLOTS - 1), every decimator takes one sample of its slot
+    per carrier period at the end of Program 1, when all the slots of
+    the period are in (e.g. the bus voltage at 16 bit over 2^12
+    periods). n = 0 stops them
+ ===================================================================*/
+bool ADC_Oversample_PMD(ADC_Decimator * dec, uint8_t n){
+    uint32_t primask = __get_PRIMASK();
+
+    if(n > ADC_DECIM_MAX || (n > 0 && dec == 0)){
+        return false;
+    }
+    for(uint8_t i = 0; i < n; i++){
+        if(dec[i].reg >= ADC_PMD_SLOTS){
+            return false;
+        }
+    }
+    __disable_irq();                                // INTADAPDB never sees half a list
+    ADC_PMD_Decim = dec;
+    ADC_PMD_Decim_Count = n;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+/*===================================================================*
+        PMD Trigger Acquisition (Samples aligned to the PWM carrier)
+*===================================================================*/
+void ADC_PMD_Trigger_Setting(TSB_AD_TypeDef * ADx){
+    if(ADx != TSB_ADA){
+        return;
+    }
+    ADC_PMD_Running = true;
+    CR0_ADEN_DISABLE(ADx);                  // Stop the unit while the programs are changed
+
+    /* Program 0: AINA05 (Current) and AINA06 at the Carrier Peak */
+    ADx->PSET0 = 0;
+    PSETx_AINSP00(ADx->PSET0, 0x05);        // AINA05 - PM2
+    PSETx_UVWIS00_U(ADx->PSET0);
+    PSETx_ENSP00_ENABLE(ADx->PSET0);
+    PSETx_AINSP01(ADx->PSET0, 0x06);        // AINA06 - PM1
+    PSETx_UVWIS01_U(ADx->PSET0);
+    PSETx_ENSP01_ENABLE(ADx->PSET0);
+
+    /* Program 1: AINA07 (Bus Voltage) and AINA08 (Line Voltage) at TRGCMP1 */
+    ADx->PSET1 = 0;
+    PSETx_AINSP00(ADx->PSET1, 0x07);        // AINA07 - PM0
+    PSETx_UVWIS00_U(ADx->PSET1);
+    PSETx_ENSP00_ENABLE(ADx->PSET1);
+    PSETx_AINSP01(ADx->PSET1, 0x08);        // AINA08 - PL7
+    PSETx_UVWIS01_U(ADx->PSET1);
+    PSETx_ENSP01_ENABLE(ADx->PSET1);
+
+    /* Result storage: Program 0 -> REG0..REG3 | Program 1 -> REG4..REG7 */
+    PREGS_REGSEL0(ADx, 0x00);
+    PREGS_REGSEL1(ADx, 0x01);
+
+    /* PMD0 TRG0 starts Program 0, PMD0 TRG1 starts Program 1 */
+    PSELx_PMDS(ADx->PSEL0, ADC_PMD_PROG_PEAK);
+    PSELx_PENS_ENABLE(ADx->PSEL0);
+    PSELx_PMDS(ADx->PSEL1, ADC_PMD_PROG_CMP);
+    PSELx_PENS_ENABLE(ADx->PSEL1);
+
+    /* End of Program 0 -> INTADAPDA | End of Program 1 -> INTADAPDB */
+    PINTSx_INTSEL_INTADA(ADx->PINTS0);
+    PINTSx_INTSEL_INTADB(ADx->PINTS1);
+
+    NVIC_ClearPendingIRQ(INTADAPDA_IRQn);
+    NVIC_ClearPendingIRQ(INTADAPDB_IRQn);
+    NVIC_EnableIRQ(INTADAPDA_IRQn);
+    NVIC_EnableIRQ(INTADAPDB_IRQn);
+
+    CR0_ADEN_ENABLE(ADx);                   // Wait for the PMD triggers
+}
+
+void ADC_PMD_Set_Callback(void (*callback)(void)){
+    ADC_PMD_Callback = callback;
+}
+
+uint32_t ADC_PMD_Read(uint8_t slot){
+    if(slot >= ADC_PMD_SLOTS){
+        return 0;
+    }
+    return ADC_PMD_Sample[slot];
+}
+
+/* Slot of result register reg (0..23), ADC_PMD_SLOTS when no sample point lands there */
+static uint8_t ADC_PMD_Slot(uint8_t reg){
+    if(reg >= 8 || (reg & 0x03) >= ADC_PMD_POINTS){
+        return ADC_PMD_SLOTS;
+    }
+    return (uint8_t)((reg >> 2) * ADC_PMD_POINTS + (reg & 0x03));
+}
+
+/* End of Program 0 (Carrier Peak) */
+void INTADAPDA_IRQHandler(void){
+    ADC_PMD_Sample[0] = (uint16_t)((TSB_ADA->REG0 & ADC_ADR0_MASK) >> 4);
+    ADC_PMD_Sample[1] = (uint16_t)((TSB_ADA->REG1 & ADC_ADR0_MASK) >> 4);
+    ADC_PMD_Count++;
+    if(ADC_PMD_Callback){
+        ADC_PMD_Callback();
+    }
+}
+
+/* End of Program 1 (TRGCMP1) */
+void INTADAPDB_IRQHandler(void){
+    ADC_PMD_Sample[2] = (uint16_t)((TSB_ADA->REG4 & ADC_ADR0_MASK) >> 4);
+    ADC_PMD_Sample[3] = (uint16_t)((TSB_ADA->REG5 & ADC_ADR0_MASK) >> 4);
+    for(uint8_t i = 0; i < ADC_PMD_Decim_Count; i++){
+        ADC_Decim_Push(&ADC_PMD_Decim[i], ADC_PMD_Sample[ADC_PMD_Decim[i].reg]);
+    }
+}
+
+/*===================================================================*
+                    Monitor Function (CMP0 / CMP1)
+*===================================================================*/
+
+static const IRQn_Type ADC_Monitor_IRQ[ADC_UNITS][ADC_MONITORS] = {
+    { INTADACP0_IRQn, INTADACP1_IRQn },
+    { INTADBCP0_IRQn, INTADBCP1_IRQn },
+    { INTADCCP0_IRQn, INTADCCP1_IRQn },
+};
+
+static ADC_Monitor ADC_Mon[ADC_UNITS][ADC_MONITORS];
+static volatile bool ADC_Mon_Active[ADC_UNITS][ADC_MONITORS];      // Past the level, watching the return
+
+/* One monitor with its enable off, the detection count restarts */
+static void ADC_Monitor_Write(TSB_AD_TypeDef * ADx, uint8_t cmp, uint32_t dir, uint16_t level){
+    const ADC_Monitor * mon = &ADC_Mon[ADC_Unit(ADx)][cmp];
+
+    if(cmp == 0){
+        CMPEN_CMP0EN_DISABLE(ADx);
+        CMPCR0_REGS0(ADx, mon->reg);
+        CMPCR0_ADBIG0(ADx, dir);
+        if(mon->accumulated){ CMPCR0_CMPCND0_ACCUMULATED(ADx); } else { CMPCR0_CMPCND0_CONTINUOUS(ADx); }
+        CMPCR0_CMPCNT0(ADx, (uint32_t)mon->count);
+        CMP0_AD0CMP0(ADx, (uint32_t)level << 4);
+        CMPEN_CMP0EN_ENABLE(ADx);
+    }
+    else {
+        CMPEN_CMP1EN_DISABLE(ADx);
+        CMPCR1_REGS1(ADx, mon->reg);
+        CMPCR1_ADBIG1(ADx, dir);
+        if(mon->accumulated){ CMPCR1_CMPCND1_ACCUMULATED(ADx); } else { CMPCR1_CMPCND1_CONTINUOUS(ADx); }
+        CMPCR1_CMPCNT1(ADx, (uint32_t)mon->count);
+        CMP1_AD0CMP1(ADx, (uint32_t)level << 4);
+        CMPEN_CMP1EN_ENABLE(ADx);
+    }
+}
+
+/*===================================================================
+    Arm monitor cmp (0 / 1) of a unit. The comparison runs on every
+    conversion stored in mon->reg, the output (and INTADxCPn) comes
+    within that conversion. Returns false on a bad unit or setting
+ ===================================================================*/
+bool ADC_Monitor_Arm(TSB_AD_TypeDef * ADx, uint8_t cmp, const ADC_Monitor * mon){
+    int8_t unit = ADC_Unit(ADx);
+
+    if(unit < 0 || cmp >= ADC_MONITORS || mon->reg >= ADC_RESULT_REGS ||
+       mon->count > ADC_CMP_COUNT_MAX || mon->level > ADC_CODE_MAX){
+        return false;
+    }
+    NVIC_DisableIRQ(ADC_Monitor_IRQ[unit][cmp]);
+    ADC_Mon[unit][cmp] = *mon;
+    ADC_Mon_Active[unit][cmp] = false;
+    ADC_Monitor_Write(ADx, cmp, mon->dir, mon->level);
+    if(mon->callback != 0){
+        NVIC_ClearPendingIRQ(ADC_Monitor_IRQ[unit][cmp]);
+        NVIC_EnableIRQ(ADC_Monitor_IRQ[unit][cmp]);
+    }
+    return true;
+}
+
+void ADC_Monitor_Disarm(TSB_AD_TypeDef * ADx, uint8_t cmp){
+    int8_t unit = ADC_Unit(ADx);
+
+    if(unit < 0 || cmp >= ADC_MONITORS){
+        return;
+    }
+    NVIC_DisableIRQ(ADC_Monitor_IRQ[unit][cmp]);
+    if(cmp == 0){
+        CMPEN_CMP0EN_DISABLE(ADx);
+    }
+    else {
+        CMPEN_CMP1EN_DISABLE(ADx);
+    }
+    ADC_Mon_Active[unit][cmp] = false;
+}
+
+/* New level from the next conversion, a monitor past its level keeps watching the return until it clears */
+void ADC_Monitor_Set_Level(TSB_AD_TypeDef * ADx, uint8_t cmp, uint16_t level){
+    int8_t unit = ADC_Unit(ADx);
+
+    if(unit < 0 || cmp >= ADC_MONITORS || level > ADC_CODE_MAX){
+        return;
+    }
+    ADC_Mon[unit][cmp].level = level;
+    if(!ADC_Mon_Active[unit][cmp]){
+        if(cmp == 0){
+            CMP0_AD0CMP0(ADx, (uint32_t)level << 4);
+        }
+        else {
+            CMP1_AD0CMP1(ADx, (uint32_t)level << 4);
+        }
+    }
+}
+
+bool ADC_Monitor_Active(TSB_AD_TypeDef * ADx, uint8_t cmp){
+    int8_t unit = ADC_Unit(ADx);
+
+    return (unit >= 0 && cmp < ADC_MONITORS) ? ADC_Mon_Active[unit][cmp] : false;
+}
+
+/* Detection: one shot, or swap to the return watch (opposite direction, level -/+ hyst) and back */
+static void ADC_Monitor_IRQ_Handler(uint8_t unit, uint8_t cmp){
+    TSB_AD_TypeDef * ADx = ADC_Unit_Table[unit];
+    const ADC_Monitor * mon = &ADC_Mon[unit][cmp];
+    bool active = !ADC_Mon_Active[unit][cmp];
+    int32_t level;
+
+    if(mon->hyst == 0){
+        NVIC_DisableIRQ(ADC_Monitor_IRQ[unit][cmp]);
+        active = true;
+    }
+    else if(active){
+        level = (mon->dir == ADC_CMP_ABOVE) ? (int32_t)mon->level - mon->hyst : (int32_t)mon->level + mon->hyst;
+        level = (level < 0) ? 0 : ((level > ADC_CODE_MAX) ? ADC_CODE_MAX : level);
+        ADC_Monitor_Write(ADx, cmp, (mon->dir == ADC_CMP_ABOVE) ? ADC_CMP_BELOW : ADC_CMP_ABOVE, (uint16_t)level);
+    }
+    else {
+        ADC_Monitor_Write(ADx, cmp, mon->dir, mon->level);
+    }
+    ADC_Mon_Active[unit][cmp] = active;
+    if(mon->callback != 0){
+        mon->callback(active);
+    }
+}
+
+void INTADACP0_IRQHandler(void){ ADC_Monitor_IRQ_Handler(0, 0); }
+void INTADACP1_IRQHandler(void){ ADC_Monitor_IRQ_Handler(0, 1); }
+void INTADBCP0_IRQHandler(void){ ADC_Monitor_IRQ_Handler(1, 0); }
+void INTADBCP1_IRQHandler(void){ ADC_Monitor_IRQ_Handler(1, 1); }
+void INTADCCP0_IRQHandler(void){ ADC_Monitor_IRQ_Handler(2, 0); }
+void INTADCCP1_IRQHandler(void){ ADC_Monitor_IRQ_Handler(2, 1); }
+
 uint32_t getADC_CR0(TSB_AD_TypeDef * ADx){
     return (ADx->CR0);
 }
@@ -405,62 +809,75 @@ uint32_t getADC_TSET0(TSB_AD_TypeDef * ADx){
     return(ADx->TSET0);
 }
 
-/* Changed from the original */
+/* num = 1 for REG0 ... 24 for REG23 */
 uint32_t getADC_REGx(TSB_AD_TypeDef * ADx, uint8_t num){
-    switch (num){
-        case 1:
-            return (ADx->REG0);
-            break;
-        case 2:
-            return (ADx->REG1);
-            break;
-        case 3:
-            return (ADx->REG2);
-            break;
-        case 4:
-            return (ADx->REG3);
-            break;
-        case 5:
-            return (ADx->REG4);
-            break;
-        case 6:
-            return (ADx->REG5);
-            break;
-        case 7:
-            return (ADx->REG6);
-            break;
-        case 8:
-            return (ADx->REG7);
-            break;
-        case 9:
-            return (ADx->REG8);
-            break;
-        case 10:
-            return (ADx->REG9);
-            break;
-        case 11:
-            return (ADx->REG10);
-            break;
-        default :
-            return 0;
-            break;
+    if(num == 0 || num > ADC_RESULT_REGS){
+        return 0;
+    }
+    return ADC_REG(ADx, num - 1);
+}
+
+/* 12 bit result of REGn (0..23), indexed straight into the register array */
+uint32_t ADC_Result(TSB_AD_TypeDef * ADx, uint8_t reg){
+    if(reg >= ADC_RESULT_REGS){
+        return 0;
+    }
+    return (ADC_REG(ADx, reg) & ADC_ADR0_MASK) >> 4;
+}
+
+/*===================================================================
+    REG0..REG(n - 1) into snap: codes plus the valid and overrun flags
+    as bit masks, one read per register (the read clears ADRFn, so a
+    register shows valid once per conversion)
+ ===================================================================*/
+void ADC_Snapshot_Read(TSB_AD_TypeDef * ADx, ADC_Snapshot * snap, uint8_t n){
+    const volatile uint32_t * reg = &ADx->REG0;
+    uint32_t valid = 0;
+    uint32_t overrun = 0;
+    uint32_t word;
+
+    if(n > ADC_RESULT_REGS){
+        n = ADC_RESULT_REGS;
+    }
+    for(uint8_t i = 0; i < n; i++){
+        word = reg[i];
+        snap->code[i] = (uint16_t)((word & ADC_ADR0_MASK) >> 4);
+        valid |= (word & ADC_ADRF_MASK) << i;
+        overrun |= ((word & ADC_ADOVRF_MASK) >> 1) << i;
     }
+    snap->valid = valid;
+    snap->overrun = overrun;
 }
 
-uint32_t ADC_Read(TSB_AD_TypeDef * ADx, uint8_t num){
-    ADC_Conversion_Start(ADx);
+/* Calibration of one 12 bit code: (code + offset) * gain, clamped to the converter range */
+static uint32_t ADC_Calibrate(const ADC_Handle * adc, uint32_t code){
+    int32_t value = (((int32_t)code + adc->offset) * (int32_t)adc->gain) >> 12;
+
+    return (uint32_t)((value < 0) ? 0 : ((value > ADC_CODE_MAX) ? ADC_CODE_MAX : value));
+}
 
-    while((getADC_REGx(ADx, num) & 0x01) != 0x01){}
-    while((getADC_ST(ADx) & 0x04)){}
-    return ((getADC_REGx(ADx, num) & ADC_ADR0_MASK) >> 4);
+/* num = 1 for REG0 (getADC_REGx numbering) */
+uint32_t ADC_Read(ADC_Handle * adc, uint8_t num){
+    TSB_AD_TypeDef * ADx = adc->ADx;
+
+    if(adc->mode == PMD_Trigger){
+        return ADC_Calibrate(adc, ADC_PMD_Read(ADC_PMD_Slot(num - 1)));    // Latest sample from the PMD trigger interrupts
+    }
+    ADC_Conversion_Start(adc);
+
+    while((getADC_REGx(ADx, num) & ADC_ADRF_MASK) == 0){}
+    if(adc->mode == Single_Conversion){
+        while((getADC_ST(ADx) & ST_SNGF_MASK)){}
+    }
+    return ADC_Calibrate(adc, (getADC_REGx(ADx, num) & ADC_ADR0_MASK) >> 4);
 }
 
-uint32_t ADC_Read_Samples(TSB_AD_TypeDef * ADx, uint8_t num, uint16_t samples){
+uint32_t ADC_Read_Samples(ADC_Handle * adc, uint8_t num, uint16_t samples){
     int i = 0;
     uint32_t read_bits = 0;
     uint32_t sample_average = 0;
     for(i=0; i < samples; i++){
-        read_bits = ADC_Read(ADx, num);
+        read_bits = ADC_Read(adc, num);
         sample_average = sample_average + read_bits;
     }
     return (sample_average/samples); 
@@ -24,6 +24,11 @@ extern "C" {
                         Masks for Registers
 *===================================================================*/
 #define ADC_ADR0_MASK                           (uint32_t)(0xFFF0UL) 
+#define ADC_ADRF_MASK                           (uint32_t)(0x01UL)          // REGn holds a new result
+#define ADC_ADOVRF_MASK                         (uint32_t)(0x01UL << 1)     // REGn overwritten before it was read
+
+/* Result register n (0..23), REG0..REG23 are contiguous */
+#define ADC_REG(obj, n)                         ((&(obj)->REG0)[(n)])
 
 /* Control Register 0 Mask */
 #define CR0_CNT_MASK                            (uint32_t)(0x01UL) 
@@ -66,12 +71,16 @@ extern "C" {
 #define CMPCR1_REGS1_MASK                       (uint32_t)(0x1FUL)
 #define CMPCR1_ADBIG1_MASK                      (uint32_t)(0x01UL << 5)
 #define CMPCR1_CMPCND1_MASK                     (uint32_t)(0x01UL << 6)
-#define CMPCR1_CMPCNT1_MASK                     (uint32_t)(0x01UL << 8)
+#define CMPCR1_CMPCNT1_MASK                     (uint32_t)(0x07UL << 8)
 
 /* Conversion Result Comparison Register 0 Mask */
 #define CMP0_AD0CMP0_MASK                       (uint32_t)(0xFFFUL << 4)
 #define CMP1_AD0CMP1_MASK                       (uint32_t)(0xFFFUL << 4)
 
+/* ADBIGn: monitor output while the result is above / below CMPn */
+#define ADC_CMP_ABOVE                           (uint32_t)(0x00UL)
+#define ADC_CMP_BELOW                           (uint32_t)(0x01UL)
+
 /* PMD Trigger Program Nummber Selection Register 0 Mask */
 #define PSEL0_PMDS0_MASK                        (uint32_t)(0x07UL)
 #define PSEL0_PENS0_MASK                        (uint32_t)(0x01UL << 7)
@@ -158,6 +167,8 @@ extern "C" {
 #define CLK_EXAZ0_SCLKx2N(obj)                  ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ0_MASK) | (0x01UL << 3)))
 #define CLK_EXAZ0_SCLKx4N(obj)                  ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ0_MASK) | (0x03UL << 3)))
 
+#define CLK_EXAZ0(obj, param)                   ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ0_MASK) | ((uint32_t)(param) << 3)))
+
 #define CLK_EXAZ1_SCLKxN(obj)                   ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ1_MASK) | (0x00UL << 8)))
 #define CLK_EXAZ1_SCLKx2N(obj)                  ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ1_MASK) | (0x01UL << 8)))
 #define CLK_EXAZ1_SCLKx4N(obj)                  ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_EXAZ1_MASK) | (0x03UL << 8)))
@@ -185,7 +196,7 @@ extern "C" {
 /* Monitor Function Setting Register 0 */
 #define CMPCR0_REGS0(obj, param)                ((obj)->CMPCR0 = (uint32_t)(((obj)->CMPCR0 & ~CMPCR0_REGS0_MASK) | (param)))
 
-#define CMPCR0_ADBIG0(obj, param)               ((obj)->CMPCR0 = (uint32_t)(((obj)->CMPCR0 & ~CMPCR0_ADBIG0_MASK) | (param << 5)))
+#define CMPCR0_ADBIG0(obj, param)               ((obj)->CMPCR0 = (uint32_t)(((obj)->CMPCR0 & ~CMPCR0_ADBIG0_MASK) | ((param) << 5)))
 
 #define CMPCR0_CMPCND0_CONTINUOUS(obj)          ((obj)->CMPCR0 = (uint32_t)(((obj)->CMPCR0 & ~CMPCR0_CMPCND0_MASK) | (0x00UL << 6)))
 #define CMPCR0_CMPCND0_ACCUMULATED(obj)         ((obj)->CMPCR0 = (uint32_t)(((obj)->CMPCR0 & ~CMPCR0_CMPCND0_MASK) | (0x01UL << 6)))
@@ -195,13 +206,12 @@ extern "C" {
 /* Monitor Function Setting Register 1 */
 #define CMPCR1_REGS1(obj, param)                ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_REGS1_MASK) | (param)))
 
-#define CMPCR1_ADBIG1(obj, param)               ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_ADBIG1_MASK) | (param)))
+#define CMPCR1_ADBIG1(obj, param)               ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_ADBIG1_MASK) | ((param) << 5)))
 
 #define CMPCR1_CMPCND1_CONTINUOUS(obj)          ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_CMPCND1_MASK) | (0x00UL << 6)))
 #define CMPCR1_CMPCND1_ACCUMULATED(obj)         ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_CMPCND1_MASK) | (0x01UL << 6)))
 
-#define CMPCR1_CMPCNT1_CONTINUOUS(obj)          ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_CMPCNT1_MASK) | (0x00UL << 8)))
-#define CMPCR1_CMPCNT1_ACCUMULATED(obj)         ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_CMPCNT1_MASK) | (0x01UL << 8)))
+#define CMPCR1_CMPCNT1(obj, param)              ((obj)->CMPCR1 = (uint32_t)(((obj)->CMPCR1 & ~CMPCR1_CMPCNT1_MASK) | ((param) << 8)))
 
 /* Conversion Result Comparison Register 0 */
 #define CMP0_AD0CMP0(obj, param)                ((obj)->CMP0 = (uint32_t)(((obj)->CMP0 & ~CMP0_AD0CMP0_MASK) | (param)))
@@ -217,20 +227,33 @@ extern "C" {
 #define PSEL0_PENS0_DISABLE(obj)                ((obj)->PSEL0 = (uint32_t)(((obj)->PSEL0 & ~PSEL0_PENS0_MASK) | (0x00UL << 7)))
 #define PSEL0_PENS0_ENABLE(obj)                 ((obj)->PSEL0 = (uint32_t)(((obj)->PSEL0 & ~PSEL0_PENS0_MASK) | (0x01UL << 7)))
 
+/* PMD Trigger Program Nummber Selection Register x */
+/* reg should be given as a pointer, example: ADA->PSEL4 */
+#define PSELx_PMDS(reg, param)                  (reg = (uint32_t)((reg & ~PSEL0_PMDS0_MASK) | (param)))
+
+#define PSELx_PENS_DISABLE(reg)                 (reg = (uint32_t)((reg & ~PSEL0_PENS0_MASK) | (0x00UL << 7)))
+#define PSELx_PENS_ENABLE(reg)                  (reg = (uint32_t)((reg & ~PSEL0_PENS0_MASK) | (0x01UL << 7)))
+
 /* PMD Trigger Interrupt Selection Register 0 */
 #define PINTS0_INTSEL0_NO_INT(obj)              ((obj)->PINTS0 = (uint32_t)(((obj)->PINTS0 & ~PINTS0_INTSEL0_MASK) | (0x00UL)))
 #define PINTS0_INTSEL0_INTADA(obj)              ((obj)->PINTS0 = (uint32_t)(((obj)->PINTS0 & ~PINTS0_INTSEL0_MASK) | (0x01UL)))
 #define PINTS0_INTSEL0_INTADB(obj)              ((obj)->PINTS0 = (uint32_t)(((obj)->PINTS0 & ~PINTS0_INTSEL0_MASK) | (0x02UL)))
 
+/* PMD Trigger Interrupt Selection Register x */
+/* reg should be given as a pointer, example: ADA->PINTS1 */
+#define PINTSx_INTSEL_NO_INT(reg)               (reg = (uint32_t)((reg & ~PINTS0_INTSEL0_MASK) | (0x00UL)))
+#define PINTSx_INTSEL_INTADA(reg)               (reg = (uint32_t)((reg & ~PINTS0_INTSEL0_MASK) | (0x01UL)))
+#define PINTSx_INTSEL_INTADB(reg)               (reg = (uint32_t)((reg & ~PINTS0_INTSEL0_MASK) | (0x02UL)))
+
 /* PMD Trigger Storage Selection Register */
 #define PREGS_REGSEL0(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL0_MASK) | (param)))
-#define PREGS_REGSEL1(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL1_MASK) | (param)))
-#define PREGS_REGSEL2(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL2_MASK) | (param)))
-#define PREGS_REGSEL3(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL3_MASK) | (param)))
-#define PREGS_REGSEL4(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL4_MASK) | (param)))
-#define PREGS_REGSEL5(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL5_MASK) | (param)))
-#define PREGS_REGSEL6(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL6_MASK) | (param)))
-#define PREGS_REGSEL7(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL7_MASK) | (param)))
+#define PREGS_REGSEL1(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL1_MASK) | ((param) << 4)))
+#define PREGS_REGSEL2(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL2_MASK) | ((param) << 8)))
+#define PREGS_REGSEL3(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL3_MASK) | ((param) << 12)))
+#define PREGS_REGSEL4(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL4_MASK) | ((param) << 16)))
+#define PREGS_REGSEL5(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL5_MASK) | ((param) << 20)))
+#define PREGS_REGSEL6(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL6_MASK) | ((param) << 24)))
+#define PREGS_REGSEL7(obj, param)               ((obj)->PREGS = (uint32_t)(((obj)->PREGS & ~PREGS_REGSEL7_MASK) | ((param) << 28)))
 
 /* PMD Trigger Program Register 0 */
 /* reg should be given as a pointer, example: ADA->PSET8 */
@@ -283,16 +306,126 @@ extern "C" {
 #define TSETx_ENINT0_ENABLE(reg)                (reg = (uint32_t)((reg & ~TSET0_ENINT0_MASK) | (0x01UL << 7)))
 
 
+#define ADC_PMD_POINTS                          2       // Sample points used per program (SP0, SP1)
+#define ADC_PMD_SLOTS                           (2 * ADC_PMD_POINTS)    // Program 0 -> slot 0..1 | Program 1 -> slot 2..3
+#define ADC_PMD_REG(slot)                       (4 * ((slot) / ADC_PMD_POINTS) + ((slot) % ADC_PMD_POINTS))   // Result register of a slot (REGSEL0 = 0, REGSEL1 = 1)
+
+#define ADC_UNITS                               3       // ADA, ADB, ADC
+#define ADC_MONITORS                            2       // Monitor function 0 / 1 per unit
+#define ADC_RESULT_REGS                         24      // REG0..REG23
+#define ADC_CMP_COUNT_MAX                       7       // CMPCNTn
+#define ADC_CODE_MAX                            4095
+#define ADC_GAIN_UNITY                          0x1000  // Calibration gain Q12 (1.0)
+#define ADC_NO_DMA                              0xFF    // ADC_Handle.dma of a unit without a DMA request
+
+/* Oversampling: CIC order 1 (boxcar) to 3, ratio 2^rate_log2, order * rate_log2 <= 20 (12 + 20 bit word) */
+#define ADC_DECIM_ORDER_MAX                     3
+#define ADC_DECIM_GROWTH_MAX                    20
+#define ADC_DECIM_EXTRA_MAX                     4       // Up to 16 bit results
+#define ADC_DECIM_MAX                           8       // Decimators per unit
+
+/* 12 bit code of a scan frame word (raw REGn) */
+#define ADC_FRAME_CODE(word)                    (uint16_t)(((word) & ADC_ADR0_MASK) >> 4)
+
+enum _conversionType
+{
+    Single_Conversion,
+    Continuous_Conversion,
+    General_Purpose,
+    PMD_Trigger
+};
+
+/* One descriptor per converter, every unit keeps its own mode so ADA (PMD triggered),
+   ADB and ADC (software or timer started) convert at the same time. TSETn converts ain[n]
+   into REGn for the single / continuous / general purpose modes */
+typedef struct
+{
+    TSB_AD_TypeDef * ADx;           // TSB_ADA / TSB_ADB / TSB_ADC
+    enum _conversionType mode;
+    uint8_t channels;               // TSET0..TSET(channels - 1) in use
+    uint8_t ain[ADC_RESULT_REGS];   // AINxnn per TSETn
+    volatile uint32_t * trigger;    // General_Purpose: TSEL control register routing the start source, 0 = left as it is
+    uint32_t trigger_cr;            // Value written to it
+    uint32_t exaz;                  // CLK EXAZ0 sampling time (0: SCLK x N, 1: x 2N, 3: x 4N)
+    uint32_t mod1;                  // MOD1 conversion timing for the SCLK used
+    int16_t offset;                 // Calibration, codes added to every ADC_Read()
+    uint16_t gain;                  // Calibration, Q12 (ADC_GAIN_UNITY = 1.0)
+    uint8_t dma;                    // DMA channel of the continuous conversion end request, ADC_NO_DMA if none
+} ADC_Handle;
+
+/* Scan frame: REG0..REG(channels - 1) of one pass over the channel list, raw words */
+typedef void (*ADC_Frame_Callback)(const volatile uint32_t * frame, uint8_t channels);
+
+/* All result registers in one pass (ADC_Snapshot_Read) */
+typedef struct
+{
+    uint16_t code[ADC_RESULT_REGS];     // 12 bit results
+    uint32_t valid;                     // Bit n: REGn held a new result (ADRFn)
+    uint32_t overrun;                   // Bit n: REGn was overwritten unread (ADOVRFn)
+} ADC_Snapshot;
+
+/* One oversampled channel. Integrators at the input rate, combs at the output rate, so the
+   filter costs a few adds per sample and no divide. out = sum >> (order * rate_log2 - extra_bits),
+   a 12 + extra_bits bit result; the extra bits are real only with enough noise on the input.
+   The first order - 1 outputs after ADC_Decim_Init() are still settling */
+typedef struct
+{
+    uint8_t reg;                    // REGn / scan frame index, PMD slot with ADC_Oversample_PMD()
+    uint8_t rate_log2;              // Decimation ratio 2^rate_log2
+    uint8_t order;                  // CIC stages, 1 = boxcar average
+    uint8_t extra_bits;             // Resolution enhancement (0 - ADC_DECIM_EXTRA_MAX)
+    uint32_t integ[ADC_DECIM_ORDER_MAX];
+    uint32_t comb[ADC_DECIM_ORDER_MAX];
+    uint32_t phase;                 // Input samples into the current output (up to 2^ADC_DECIM_GROWTH_MAX)
+    volatile uint32_t out;          // Latest output (12 + extra_bits bit)
+    volatile uint32_t count;        // Outputs produced
+} ADC_Decimator;
+
+/* Monitor function: REGn against a 12 bit level in hardware, nothing runs per sample.
+   hyst = 0: one INTADxCPn at the first detection (or none without a callback), re-armed by
+   ADC_Monitor_Arm(); must be 0 when the PMD OVV takes this monitor (OVVCR ADINxEN).
+   hyst > 0: after the detection the monitor watches for the return past level -/+ hyst,
+   the callback sees both edges */
+typedef struct
+{
+    uint8_t reg;                    // Result register REG0..REG23
+    uint16_t level;                 // 12 bit code
+    uint32_t dir;                   // ADC_CMP_ABOVE / ADC_CMP_BELOW
+    uint8_t count;                  // CMPCNTn: further conversions past the level before the output (0-7)
+    bool accumulated;               // CMPCNDn: count them accumulated instead of in a row
+    uint16_t hyst;                  // Release band (codes), 0 = one shot
+    void (*callback)(bool active);  // Called from INTADxCPn, 0 = no interrupt
+} ADC_Monitor;
+
 /*===================================================================*
                   Functions declaration for ADCx
 *===================================================================*/
-void ADC_Init(TSB_AD_TypeDef * ADx);
+void ADC_Init(ADC_Handle * adc);
 void ADC_CG_Config(TSB_AD_TypeDef * ADx);
-void ADC_Config(TSB_AD_TypeDef * ADx);
-void ADC_Conversion_Setting(TSB_AD_TypeDef * ADx);
-void ADC_Conversion_Start(TSB_AD_TypeDef * ADx);
-uint32_t ADC_Read(TSB_AD_TypeDef * ADx, uint8_t num);
-uint32_t ADC_Read_Samples(TSB_AD_TypeDef * ADx, uint8_t num, uint16_t samples);
+void ADC_Config(ADC_Handle * adc);
+void ADC_Conversion_Setting(ADC_Handle * adc);
+void ADC_Conversion_Start(ADC_Handle * adc);
+uint32_t ADC_Read(ADC_Handle * adc, uint8_t num);
+uint32_t ADC_Read_Samples(ADC_Handle * adc, uint8_t num, uint16_t samples);
+
+bool ADC_Scan_Start(ADC_Handle * adc, ADC_Frame_Callback callback);
+void ADC_Scan_Stop(ADC_Handle * adc);
+uint32_t ADC_Scan_Frames(ADC_Handle * adc);
+
+bool ADC_Decim_Init(ADC_Decimator * dec, uint8_t reg, uint8_t rate_log2, uint8_t order, uint8_t extra_bits);
+bool ADC_Decim_Push(ADC_Decimator * dec, uint16_t code);
+void ADC_Decim_Frame(ADC_Decimator * dec, uint8_t n, const volatile uint32_t * frame);
+bool ADC_Oversample_Start(ADC_Handle * adc, ADC_Decimator * dec, uint8_t n);
+bool ADC_Oversample_PMD(ADC_Decimator * dec, uint8_t n);
+
+void ADC_PMD_Trigger_Setting(TSB_AD_TypeDef * ADx);
+void ADC_PMD_Set_Callback(void (*callback)(void));
+uint32_t ADC_PMD_Read(uint8_t slot);
+
+bool ADC_Monitor_Arm(TSB_AD_TypeDef * ADx, uint8_t cmp, const ADC_Monitor * mon);
+void ADC_Monitor_Disarm(TSB_AD_TypeDef * ADx, uint8_t cmp);
+void ADC_Monitor_Set_Level(TSB_AD_TypeDef * ADx, uint8_t cmp, uint16_t level);
+bool ADC_Monitor_Active(TSB_AD_TypeDef * ADx, uint8_t cmp);
 
 uint32_t getADC_CR0(TSB_AD_TypeDef * ADx); 
 uint32_t getADC_CR1(TSB_AD_TypeDef * ADx);
@@ -311,22 +444,18 @@ uint32_t getADC_PSEL0(TSB_AD_TypeDef * ADx);
 uint32_t getADC_PINTS0(TSB_AD_TypeDef * ADx);
 uint32_t getADC_PREGS(TSB_AD_TypeDef * ADx);
 uint32_t getADC_REGx(TSB_AD_TypeDef * ADx, uint8_t num);
+uint32_t ADC_Result(TSB_AD_TypeDef * ADx, uint8_t reg);
+void ADC_Snapshot_Read(TSB_AD_TypeDef * ADx, ADC_Snapshot * snap, uint8_t n);
 
 /*===================================================================*
-                        Typedef Structures
+                        Unit Descriptors
 *===================================================================*/
-enum _conversionType
-{
-    Single_Conversion,
-    Continuous_Conversion,
-    General_Purpose,
-    PMD_Trigger
-};
+extern ADC_Handle ADC_Handle_A;
+extern ADC_Handle ADC_Handle_B;
+extern ADC_Handle ADC_Handle_C;
 
-typedef struct
-{
-    enum _conversionType typex;
-} ADxConversionType;
+extern volatile uint16_t ADC_PMD_Sample[ADC_PMD_SLOTS];
+extern volatile uint32_t ADC_PMD_Count;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,35 @@
+/**
+ *******************************************************************************
+ * @file    DS_CRC.h
+ * @brief   CRC-16/CCITT-FALSE, table driven
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC16_INIT                              (uint16_t)(0xFFFF)     // CRC-16/CCITT-FALSE seed
+
+/*===================================================================*
+                  Functions declaration for CRC
+*===================================================================*/
+uint16_t CRC16_Calc(const uint8_t * data, uint16_t length, uint16_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __CRC_H__ */
@@ -0,0 +1,199 @@
+/**
+*******************************************************************************
+* @file    DS_DMA.c
+* @brief   Toshiba Direct Memory Access Controller (uDMA)
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_DMA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Channel Control Data
+*===================================================================*/
+
+/* Primary structures for ch0-31 followed by the alternate ones (base must be 1 KB aligned) */
+static volatile DMA_Descriptor DMA_Control[2 * DMA_CHANNELS] __attribute__((aligned(1024)));
+
+static void (*DMA_Callback[DMA_CHANNELS])(void);
+static volatile uint32_t DMA_Active = 0;            // Channels started and not yet reported complete
+static volatile uint32_t DMA_Kick = 0;              // Channels whose callback was requested by software
+
+/* Ping-pong channels never stop, each half is re-armed from its saved control word once reported */
+static void (*DMA_Half_Callback[DMA_CHANNELS])(uint8_t ch, bool alternate);
+static uint32_t DMA_Half_Control[DMA_CHANNELS];
+static volatile uint32_t DMA_PingPong = 0;          // Channels running a ping-pong cycle
+static volatile uint32_t DMA_Next_Alt = 0;          // Half each of them completes next (1 = alternate)
+
+/* Shared by every driver that uses a channel, only the first call configures the unit */
+void DMA_Init(void){
+    if(TSB_DMAA->CTRLBASEPTR == (uint32_t)(uintptr_t)DMA_Control){
+        return;
+    }
+    CFG_MASTER_DISABLE(TSB_DMAA);
+    TSB_DMAA->CTRLBASEPTR = (uint32_t)(uintptr_t)DMA_Control;
+    TSB_DMAA->CHNLENABLECLR = 0xFFFFFFFFUL;          // All channels stopped
+    TSB_DMAA->CHNLPRIALTCLR = 0xFFFFFFFFUL;          // Primary structures selected
+    TSB_DMAA_ERRCLR_ERR_CLR = 1;                    // Clear a pending bus error
+    DMA_Active = 0;
+    DMA_Kick = 0;
+    DMA_PingPong = 0;
+    DMA_Next_Alt = 0;
+    CFG_MASTER_ENABLE(TSB_DMAA);
+
+    NVIC_ClearPendingIRQ(INTDMAATC_IRQn);
+    NVIC_EnableIRQ(INTDMAATC_IRQn);
+}
+
+void DMA_Set_Callback(uint8_t ch, void (*callback)(void)){
+    if(ch < DMA_CHANNELS){
+        DMA_Callback[ch] = callback;
+    }
+}
+
+volatile DMA_Descriptor * DMA_Get_Descriptor(uint8_t ch, bool alternate){
+    return &DMA_Control[(alternate ? DMA_CHANNELS : 0) + ch];
+}
+
+/* Address of the last element for a given increment (no increment keeps the start address) */
+static uintptr_t DMA_End_Address(volatile const void * start, uint16_t n, uint32_t inc){
+    if(inc == DMA_NO_INC){
+        return (uintptr_t)start;
+    }
+    return (uintptr_t)start + ((uintptr_t)(n - 1) << inc);
+}
+
+/*===================================================================
+    Start a basic cycle of n transfers (1 - 1024) on a peripheral request
+ ===================================================================*/
+void DMA_Basic_Start(uint8_t ch, volatile const void * src, volatile void * dst, uint16_t n, uint32_t control){
+    volatile DMA_Descriptor * d = &DMA_Control[ch];
+
+    d->src_end = (volatile const void *)DMA_End_Address(src, n, (control & DMACTRL_SRC_INC_MASK) >> 26);
+    d->dst_end = (volatile void *)DMA_End_Address(dst, n, (control & DMACTRL_DST_INC_MASK) >> 30);
+    d->control = (control & ~(DMACTRL_N_MINUS_1_MASK | DMACTRL_CYCLE_CTRL_MASK)) | DMACTRL_N_MINUS_1(n) | DMACTRL_CYCLE_BASIC;
+
+    DMA_Active |= (0x01UL << ch);
+    CHNL_PRIMARY(TSB_DMAA, ch);
+    CHNL_USEBURST_CLR(TSB_DMAA, ch);
+    CHNL_REQMASK_CLR(TSB_DMAA, ch);
+    CHNL_ENABLE(TSB_DMAA, ch);
+}
+
+/*===================================================================
+    Start a ping-pong cycle: n transfers (1 - 1024) from src into dst0
+    (primary), the next n into dst1 (alternate) and so on. The source
+    restarts at src for every half. callback(ch, alternate) runs from
+    INTDMAATC for each completed half, which then stays free until the
+    other half completes
+ ===================================================================*/
+void DMA_PingPong_Start(uint8_t ch, volatile const void * src, volatile void * dst0, volatile void * dst1, uint16_t n,
+                        uint32_t control, void (*callback)(uint8_t ch, bool alternate)){
+    volatile DMA_Descriptor * pri = &DMA_Control[ch];
+    volatile DMA_Descriptor * alt = &DMA_Control[DMA_CHANNELS + ch];
+    uint32_t src_inc = (control & DMACTRL_SRC_INC_MASK) >> 26;
+    uint32_t dst_inc = (control & DMACTRL_DST_INC_MASK) >> 30;
+
+    CHNL_DISABLE(TSB_DMAA, ch);
+    DMA_Half_Control[ch] = (control & ~(DMACTRL_N_MINUS_1_MASK | DMACTRL_CYCLE_CTRL_MASK)) | DMACTRL_N_MINUS_1(n) | DMACTRL_CYCLE_PINGPONG;
+    DMA_Half_Callback[ch] = callback;
+    pri->src_end = (volatile const void *)DMA_End_Address(src, n, src_inc);
+    pri->dst_end = (volatile void *)DMA_End_Address(dst0, n, dst_inc);
+    pri->control = DMA_Half_Control[ch];
+    alt->src_end = pri->src_end;
+    alt->dst_end = (volatile void *)DMA_End_Address(dst1, n, dst_inc);
+    alt->control = DMA_Half_Control[ch];
+
+    DMA_Next_Alt &= ~(0x01UL << ch);
+    DMA_PingPong |= (0x01UL << ch);
+    CHNL_PRIMARY(TSB_DMAA, ch);
+    CHNL_USEBURST_CLR(TSB_DMAA, ch);
+    CHNL_REQMASK_CLR(TSB_DMAA, ch);
+    CHNL_ENABLE(TSB_DMAA, ch);
+}
+
+/* The controller writes cycle_ctrl = stop back into a finished half. Both halves
+   finished means the callbacks fell behind and the channel stopped: restart it */
+static void DMA_PingPong_Service(uint8_t ch){
+    bool alternate = (DMA_Next_Alt >> ch) & 0x01UL;
+    volatile DMA_Descriptor * d = &DMA_Control[(alternate ? DMA_CHANNELS : 0) + ch];
+
+    while((d->control & DMACTRL_CYCLE_CTRL_MASK) == DMACTRL_CYCLE_STOP){
+        d->control = DMA_Half_Control[ch];
+        DMA_Next_Alt ^= (0x01UL << ch);
+        if(DMA_Half_Callback[ch] != 0){
+            DMA_Half_Callback[ch](ch, alternate);
+        }
+        alternate = !alternate;
+        d = &DMA_Control[(alternate ? DMA_CHANNELS : 0) + ch];
+    }
+    if(!DMA_Busy(ch) && ((DMA_PingPong >> ch) & 0x01UL)){
+        if(alternate){
+            CHNL_ALTERNATE(TSB_DMAA, ch);
+        }
+        else {
+            CHNL_PRIMARY(TSB_DMAA, ch);
+        }
+        CHNL_ENABLE(TSB_DMAA, ch);
+    }
+}
+
+/* Runs the channel callback from INTDMAATC, so starting a transfer never races the completion path */
+void DMA_Request_Service(uint8_t ch){
+    DMA_Kick |= (0x01UL << ch);
+    NVIC_SetPendingIRQ(INTDMAATC_IRQn);
+}
+
+bool DMA_Busy(uint8_t ch){
+    return (TSB_DMAA->CHNLENABLESET >> ch) & 0x01UL;
+}
+
+void DMA_Stop(uint8_t ch){
+    CHNL_DISABLE(TSB_DMAA, ch);
+    DMA_Active &= ~(0x01UL << ch);
+    DMA_PingPong &= ~(0x01UL << ch);
+}
+
+/*===================================================================
+    End of transfer (ch0 - 31): the controller clears the enable bit
+    of every channel whose basic cycle has completed, ping-pong
+    channels are checked through their control data
+ ===================================================================*/
+void INTDMAATC_IRQHandler(void){
+    uint32_t done = DMA_Active & ~TSB_DMAA->CHNLENABLESET;
+    uint32_t pingpong = DMA_PingPong;
+    DMA_Active &= ~done;
+    done |= DMA_Kick;
+    DMA_Kick = 0;
+
+    for(uint8_t ch = 0; pingpong != 0; ch++, pingpong >>= 1){
+        if(pingpong & 0x01UL){
+            DMA_PingPong_Service(ch);
+        }
+    }
+
+    for(uint8_t ch = 0; done != 0; ch++, done >>= 1){
+        if((done & 0x01UL) && DMA_Callback[ch] != 0){
+            DMA_Callback[ch]();
+        }
+    }
+}
+
+/*===================================================================
+                    Read Register Value
+ ===================================================================*/
+uint32_t getDMA_STATUS(void){
+    return TSB_DMAA->STATUS;
+}
+
+uint32_t getDMA_CHNLENABLESET(void){
+    return TSB_DMAA->CHNLENABLESET;
+}
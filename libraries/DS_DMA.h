@@ -0,0 +1,111 @@
+/**
+ *******************************************************************************
+ * @file    DS_DMA.h
+ * @brief   Toshiba Direct Memory Access Controller (uDMA)
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __DMA_H__
+#define __DMA_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DMA_CHANNELS                            32          // DMAC unit A, ch0 - ch31
+#define DMA_MAX_TRANSFERS                       1024        // Transfers per cycle (n_minus_1 is 10 bit)
+
+/* DMA request channels used by the drivers (must match the DMAC unit A request map) */
+#define DMA_CH_UART0_TX                         (uint8_t) 13        // UART0 transmit request
+#define DMA_CH_ADA_CNT                          (uint8_t) 0         // ADC unit A end of continuous conversion
+
+/*===================================================================*
+                        Masks for Registers
+*===================================================================*/
+/* Channel Control Word Mask */
+#define DMACTRL_CYCLE_CTRL_MASK                 (uint32_t)(0x07UL)
+#define DMACTRL_NEXT_USEBURST_MASK              (uint32_t)(0x01UL << 3)
+#define DMACTRL_N_MINUS_1_MASK                  (uint32_t)(0x3FFUL << 4)
+#define DMACTRL_R_POWER_MASK                    (uint32_t)(0x0FUL << 14)
+#define DMACTRL_SRC_SIZE_MASK                   (uint32_t)(0x03UL << 24)
+#define DMACTRL_SRC_INC_MASK                    (uint32_t)(0x03UL << 26)
+#define DMACTRL_DST_SIZE_MASK                   (uint32_t)(0x03UL << 28)
+#define DMACTRL_DST_INC_MASK                    (uint32_t)(0x03UL << 30)
+
+/*===================================================================*
+                        Define Registers
+*===================================================================*/
+/* Channel Control Word (data width and address increment: 0 = byte | 1 = half-word | 2 = word | 3 = no increment) */
+#define DMACTRL_CYCLE_STOP                      (uint32_t)(0x00UL)
+#define DMACTRL_CYCLE_BASIC                     (uint32_t)(0x01UL)
+#define DMACTRL_CYCLE_AUTO                      (uint32_t)(0x02UL)
+#define DMACTRL_CYCLE_PINGPONG                  (uint32_t)(0x03UL)
+
+#define DMACTRL_N_MINUS_1(n)                    (uint32_t)((((uint32_t)(n) - 1UL) << 4) & DMACTRL_N_MINUS_1_MASK)
+#define DMACTRL_R_POWER(param)                  (uint32_t)(((uint32_t)(param) << 14) & DMACTRL_R_POWER_MASK)
+
+#define DMACTRL_SRC_SIZE(param)                 (uint32_t)((uint32_t)(param) << 24)
+#define DMACTRL_SRC_INC(param)                  (uint32_t)((uint32_t)(param) << 26)
+#define DMACTRL_DST_SIZE(param)                 (uint32_t)((uint32_t)(param) << 28)
+#define DMACTRL_DST_INC(param)                  (uint32_t)((uint32_t)(param) << 30)
+
+#define DMA_BYTE                                0x00UL
+#define DMA_HALFWORD                            0x01UL
+#define DMA_WORD                                0x02UL
+#define DMA_NO_INC                              0x03UL
+
+/* Configuration Register */
+#define CFG_MASTER_ENABLE(obj)                  ((obj)->CFG = (uint32_t)(0x01UL))
+#define CFG_MASTER_DISABLE(obj)                 ((obj)->CFG = (uint32_t)(0x00UL))
+
+/* Channel Registers (one bit per channel, the SET/CLR pair avoids read-modify-write) */
+#define CHNL_ENABLE(obj, ch)                    ((obj)->CHNLENABLESET = (uint32_t)(0x01UL << (ch)))
+#define CHNL_DISABLE(obj, ch)                   ((obj)->CHNLENABLECLR = (uint32_t)(0x01UL << (ch)))
+#define CHNL_REQMASK_SET(obj, ch)               ((obj)->CHNLREQMASKSET = (uint32_t)(0x01UL << (ch)))
+#define CHNL_REQMASK_CLR(obj, ch)               ((obj)->CHNLREQMASKCLR = (uint32_t)(0x01UL << (ch)))
+#define CHNL_USEBURST_CLR(obj, ch)              ((obj)->CHNLUSEBURSTCLR = (uint32_t)(0x01UL << (ch)))
+#define CHNL_PRIMARY(obj, ch)                   ((obj)->CHNLPRIALTCLR = (uint32_t)(0x01UL << (ch)))
+#define CHNL_ALTERNATE(obj, ch)                 ((obj)->CHNLPRIALTSET = (uint32_t)(0x01UL << (ch)))
+#define CHNL_SW_REQUEST(obj, ch)                ((obj)->CHNLSWREQUEST = (uint32_t)(0x01UL << (ch)))
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+/* Channel control data, the controller reads it from RAM at CTRLBASEPTR */
+typedef struct
+{
+    volatile const void * src_end;      // Address of the last source element
+    volatile void * dst_end;            // Address of the last destination element
+    volatile uint32_t control;          // Channel control word
+    uint32_t reserved;
+} DMA_Descriptor;
+
+/*===================================================================*
+                  Functions declaration for DMA
+*===================================================================*/
+void DMA_Init(void);
+void DMA_Set_Callback(uint8_t ch, void (*callback)(void));
+void DMA_Basic_Start(uint8_t ch, volatile const void * src, volatile void * dst, uint16_t n, uint32_t control);
+void DMA_PingPong_Start(uint8_t ch, volatile const void * src, volatile void * dst0, volatile void * dst1, uint16_t n,
+                        uint32_t control, void (*callback)(uint8_t ch, bool alternate));
+void DMA_Request_Service(uint8_t ch);
+bool DMA_Busy(uint8_t ch);
+void DMA_Stop(uint8_t ch);
+volatile DMA_Descriptor * DMA_Get_Descriptor(uint8_t ch, bool alternate);
+
+uint32_t getDMA_STATUS(void);
+uint32_t getDMA_CHNLENABLESET(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DMA_H__ */
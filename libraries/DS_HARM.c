@@ -0,0 +1,293 @@
+/**
+*******************************************************************************
+* @file    DS_HARM.c
+* @brief   Line current harmonic analyser (Goertzel bank, IEC 61000-3-2 limits)
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_HARM.h"
+#include "DS_METER.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/* 2 pi in Q29, radians of a Q32 phase: (phase * HARM_TWO_PI_Q29) >> 31 is Q30 */
+#define HARM_TWO_PI_Q29                         3373259426ULL
+#define HARM_COS_TERMS                          7           // Taylor terms up to x^12, < 1e-8 at pi/2
+
+/* IEC 61000-3-2 class A (mA rms) for h2..h13, then 150 * 15 / h odd and 230 * 8 / h even */
+static const uint16_t HARM_Class_A_mA[14] = { 0, 0, 1080, 2300, 430, 1140, 300, 770, 230, 400, 184, 330, 153, 210 };
+
+/* Class D (uA per W) for h3..h11 odd, then 3850 / h */
+static const uint16_t HARM_Class_D_uA[12] = { 0, 0, 0, 3400, 0, 1900, 0, 1000, 0, 500, 0, 350 };
+
+/*===================================================================*
+                        Analyser State
+*===================================================================*/
+
+static HARM_Bin HARM_Bank[HARM_BINS_PER_CYCLE];     // Sample rate context only
+static uint8_t HARM_Group = 0;                      // Bank on h = HARM_Group * HARM_BINS_PER_CYCLE + 1 ..
+static uint32_t HARM_N = 0;
+static bool HARM_Synced = false;                    // Bank started on a crossing with valid coefficients
+
+static uint8_t HARM_Bank_Group = HARM_CYCLES;       // Group of the bank coefficients, HARM_CYCLES = none
+
+static int64_t HARM_Next_Coeff[HARM_BINS_PER_CYCLE];   // Background context, for the group the bank takes next
+static uint8_t HARM_Next_Group = HARM_CYCLES;
+static volatile uint32_t HARM_Step = 0;             // PLL phase per sample at the last crossing
+
+static HARM_Bin HARM_Latch[HARM_BINS_PER_CYCLE];    // Last closed window
+static uint8_t HARM_Latch_Group;
+static uint32_t HARM_Latch_N;
+static volatile bool HARM_Ready = false;
+
+static HARM_Result HARM_Out;
+static HARM_Event HARM_On_Event = 0;
+
+/* cos of a Q32 phase (full turn = 2^32) in Q30 */
+static int64_t HARM_Cos_Q30(uint32_t phase){
+    int32_t p = (int32_t)phase;                     // -pi .. pi
+    bool neg = false;
+    int64_t x, x2, term, sum;
+
+    if(p < 0){
+        p = -p;                                     // cos(-x) = cos(x), -pi stays in range as uint32 below
+    }
+    if((uint32_t)p > 0x40000000UL){
+        p = (int32_t)(0x80000000UL - (uint32_t)p);  // cos(x) = -cos(pi - x)
+        neg = true;
+    }
+    x = (int64_t)(((uint64_t)(uint32_t)p * HARM_TWO_PI_Q29) >> 31);
+    x2 = (x * x) >> HARM_Q;
+    term = (int64_t)1 << HARM_Q;
+    sum = term;
+    for(int32_t k = 1; k < HARM_COS_TERMS; k++){
+        term = -((term * x2) >> HARM_Q) / ((2 * k - 1) * (2 * k));
+        sum += term;
+    }
+    return neg ? -sum : sum;
+}
+
+/*===================================================================
+    Background: coefficients of the group the bank takes at the next
+    crossing (the one after the running group, or the running group
+    while the bank has none for it), for the line frequency of the
+    last crossing. The cosines (Taylor series, 24 divides for a group)
+    stay out of the crossing interrupt, which only copies them
+ ===================================================================*/
+static void HARM_Prepare(void){
+    uint32_t primask = __get_PRIMASK();
+    int64_t coeff[HARM_BINS_PER_CYCLE];
+    uint32_t step;
+    uint8_t group;
+
+    __disable_irq();
+    group = HARM_Group;
+    if(HARM_Bank_Group == group){
+        group = (group + 1 < HARM_CYCLES) ? group + 1 : 0;
+    }
+    step = HARM_Step;
+    __set_PRIMASK(primask);
+    if(step == 0 || group == HARM_Next_Group){
+        return;
+    }
+
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        uint32_t h = (uint32_t)group * HARM_BINS_PER_CYCLE + k + 1;
+
+        coeff[k] = 2 * HARM_Cos_Q30(h * step);
+    }
+    __disable_irq();                                // Published whole, a crossing meanwhile waits for the next call
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        HARM_Next_Coeff[k] = coeff[k];
+    }
+    HARM_Next_Group = group;
+    __set_PRIMASK(primask);
+}
+
+/* Crossing: the bank takes the prepared coefficients of HARM_Group (or keeps its own), states cleared.
+   False while the background has not prepared them, the group then waits for the next crossing */
+static bool HARM_Bank_Load(void){
+    if(HARM_Next_Group == HARM_Group){
+        for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+            HARM_Bank[k].coeff = HARM_Next_Coeff[k];
+        }
+        HARM_Bank_Group = HARM_Group;
+        HARM_Next_Group = HARM_CYCLES;
+    }
+    if(HARM_Bank_Group != HARM_Group){
+        return false;
+    }
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        HARM_Bank[k].s1 = 0;
+        HARM_Bank[k].s2 = 0;
+    }
+    HARM_N = 0;
+    return true;
+}
+
+void HARM_Init(HARM_Event event){
+    HARM_On_Event = event;
+    HARM_Synced = false;
+    HARM_Group = 0;
+    HARM_Bank_Group = HARM_CYCLES;
+    HARM_Next_Group = HARM_CYCLES;
+    HARM_Ready = false;
+    HARM_Prepare();                                 // Group 0 ready for the first crossing once a step is known
+    for(uint8_t h = 0; h <= HARM_MAX; h++){
+        HARM_Out.rms[h] = 0;
+    }
+    HARM_Out.over = 0;
+    HARM_Out.thd = 0;
+    HARM_Out.sweeps = 0;
+}
+
+/* Drop the running window (samples stopped or the phase restarted), results and limits stay */
+void HARM_Restart(void){
+    HARM_Synced = false;
+}
+
+/*===================================================================
+    One line current sample (Q15): HARM_BINS_PER_CYCLE Goertzel
+    updates, whatever the number of harmonics in the bank
+        s0 = x + 2 cos(w) s1 - s2
+ ===================================================================*/
+void HARM_Sample(int32_t i){
+    int64_t s0;
+
+    if(!HARM_Synced){
+        return;
+    }
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        s0 = i + ((HARM_Bank[k].coeff * HARM_Bank[k].s1) >> HARM_Q) - HARM_Bank[k].s2;
+        HARM_Bank[k].s2 = HARM_Bank[k].s1;
+        HARM_Bank[k].s1 = s0;
+    }
+    if(++HARM_N > METER_MAX_SAMPLES){
+        HARM_Synced = false;                        // No crossing for too long
+    }
+}
+
+/*===================================================================
+    Rising zero crossing: the window of the current group closes on
+    a whole line cycle and the next group starts with the coefficients
+    HARM_Process() prepared for the measured line frequency (step =
+    PLL phase per sample). Call before the HARM_Sample() of the same
+    period
+ ===================================================================*/
+void HARM_Cycle_End(uint32_t step){
+    HARM_Step = step;
+    if(HARM_Synced && HARM_N >= HARM_MIN_SAMPLES){
+        for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+            HARM_Latch[k] = HARM_Bank[k];
+        }
+        HARM_Latch_Group = HARM_Group;
+        HARM_Latch_N = HARM_N;
+        HARM_Ready = true;                          // An unread window is replaced
+        HARM_Group = (HARM_Group + 1 < HARM_CYCLES) ? HARM_Group + 1 : 0;
+    }
+    HARM_Synced = HARM_Bank_Load();
+}
+
+/*===================================================================
+    Background reduction of the last closed group: harmonic RMS from
+    the Goertzel states, limit check (event on the way over the
+    limit), THD once the sweep reaches HARM_MAX. Prepares the next
+    coefficients first, so call it at least once per line cycle
+        |X|^2 = s1^2 + s2^2 - 2 cos(w) s1 s2,  rms = sqrt(2 |X|^2) / n
+ ===================================================================*/
+bool HARM_Process(void){
+    HARM_Bin bin[HARM_BINS_PER_CYCLE];
+    uint32_t primask = __get_PRIMASK();
+    uint8_t group;
+    uint32_t n;
+    uint64_t sum = 0;
+
+    HARM_Prepare();
+    __disable_irq();
+    if(!HARM_Ready){
+        __set_PRIMASK(primask);
+        return false;
+    }
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        bin[k] = HARM_Latch[k];
+    }
+    group = HARM_Latch_Group;
+    n = HARM_Latch_N;
+    HARM_Ready = false;
+    __set_PRIMASK(primask);
+
+    for(uint8_t k = 0; k < HARM_BINS_PER_CYCLE; k++){
+        uint8_t h = (uint8_t)(group * HARM_BINS_PER_CYCLE + k + 1);
+        int64_t power = bin[k].s1 * bin[k].s1 + bin[k].s2 * bin[k].s2 - ((bin[k].coeff * bin[k].s1) >> HARM_Q) * bin[k].s2;
+        int32_t rms = (power > 0) ? (int32_t)(METER_Sqrt64(2 * (uint64_t)power) / n) : 0;
+        uint64_t bit = (uint64_t)1 << h;
+        int32_t limit = HARM_Out.limit[h];
+
+        HARM_Out.rms[h] = rms;
+        if(limit != HARM_NO_LIMIT && rms > limit){
+            if((HARM_Out.over & bit) == 0 && HARM_On_Event != 0){
+                HARM_On_Event(h, rms, limit);
+            }
+            HARM_Out.over |= bit;
+        }
+        else {
+            HARM_Out.over &= ~bit;
+        }
+    }
+
+    if(group == HARM_CYCLES - 1){
+        for(uint8_t h = 2; h <= HARM_MAX; h++){
+            sum += (uint64_t)((int64_t)HARM_Out.rms[h] * HARM_Out.rms[h]);
+        }
+        HARM_Out.thd = (HARM_Out.rms[1] > 0) ? (int32_t)((METER_Sqrt64(sum) << 15) / (uint32_t)HARM_Out.rms[1]) : 0;
+        HARM_Out.sweeps++;
+    }
+    return true;
+}
+
+const HARM_Result * HARM_Get(void){
+    return &HARM_Out;
+}
+
+/* limit[h], h = 0..HARM_MAX, input scale (HARM_NO_LIMIT = none) */
+void HARM_Set_Limits(const int32_t * limit){
+    for(uint8_t h = 0; h <= HARM_MAX; h++){
+        HARM_Out.limit[h] = limit[h];
+    }
+    HARM_Out.over = 0;
+}
+
+/*===================================================================*
+                IEC 61000-3-2 Limit Tables (input scale)
+*===================================================================*/
+static uint32_t HARM_Class_A_Entry(uint8_t h){
+    if(h < 14){
+        return HARM_Class_A_mA[h];
+    }
+    return (h & 0x01) ? (150UL * 15) / h : (230UL * 8) / h;
+}
+
+/* Class A, lsb_per_a = input LSB per ampere */
+void HARM_Limits_Class_A(int32_t * limit, uint32_t lsb_per_a){
+    for(uint8_t h = 0; h <= HARM_MAX; h++){
+        limit[h] = (int32_t)((HARM_Class_A_Entry(h) * lsb_per_a) / 1000);
+    }
+}
+
+/* Class D (75 - 600 W): odd harmonics per watt of input power, capped at class A */
+void HARM_Limits_Class_D(int32_t * limit, uint32_t lsb_per_a, uint32_t watts){
+    for(uint8_t h = 0; h <= HARM_MAX; h++){
+        uint32_t ua = (h < 12) ? HARM_Class_D_uA[h] : ((h & 0x01) ? 3850UL / h : 0);
+        uint32_t ma = (ua * watts) / 1000;
+
+        ma = (ma > HARM_Class_A_Entry(h)) ? HARM_Class_A_Entry(h) : ma;
+        limit[h] = (int32_t)((ma * lsb_per_a) / 1000);
+    }
+}
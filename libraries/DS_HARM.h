@@ -0,0 +1,77 @@
+/**
+ *******************************************************************************
+ * @file    DS_HARM.h
+ * @brief   Line current harmonic analyser (Goertzel bank, IEC 61000-3-2 limits)
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __HARM_H__
+#define __HARM_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Analyser Settings
+*===================================================================*/
+#define HARM_MAX                                40          // Highest harmonic (IEC 61000-3-2)
+#define HARM_BINS_PER_CYCLE                     4           // Goertzel filters updated per sample
+#define HARM_CYCLES                             (HARM_MAX / HARM_BINS_PER_CYCLE)   // Line cycles per sweep (200 ms at 50 Hz)
+#define HARM_MIN_SAMPLES                        64          // Shorter windows are dropped
+#define HARM_NO_LIMIT                           0           // Limit entry without a limit
+
+/* Q30 coefficient, 2 cos(w) reaches 2.0 */
+#define HARM_Q                                  30
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+/* Harmonic h over limit (rms and limit in the input scale), from HARM_Process() */
+typedef void (*HARM_Event)(uint8_t h, int32_t rms, int32_t limit);
+
+/* Goertzel states of one bin */
+typedef struct
+{
+    int64_t coeff;                  // 2 cos(h w) (Q30)
+    int64_t s1;
+    int64_t s2;
+} HARM_Bin;
+
+/* Results, index = harmonic order (0 unused), input scale (Q15 samples) */
+typedef struct
+{
+    int32_t rms[HARM_MAX + 1];      // Harmonic RMS of its last measured cycle
+    int32_t limit[HARM_MAX + 1];    // Class limit (HARM_NO_LIMIT = none)
+    uint64_t over;                  // Bit h: harmonic h above its limit
+    int32_t thd;                    // sqrt(sum h2..h40) / h1 (Q15), once a whole sweep is in
+    uint32_t sweeps;                // Completed sweeps over h1..HARM_MAX
+} HARM_Result;
+
+/*===================================================================*
+                  Functions declaration for HARM
+*===================================================================*/
+void HARM_Init(HARM_Event event);
+void HARM_Restart(void);
+void HARM_Sample(int32_t i);
+void HARM_Cycle_End(uint32_t step);
+bool HARM_Process(void);
+const HARM_Result * HARM_Get(void);
+void HARM_Set_Limits(const int32_t * limit);
+void HARM_Limits_Class_A(int32_t * limit, uint32_t lsb_per_a);
+void HARM_Limits_Class_D(int32_t * limit, uint32_t lsb_per_a, uint32_t watts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __HARM_H__ */
@@ -0,0 +1,152 @@
+/**
+*******************************************************************************
+* @file    DS_METER.c
+* @brief   Line cycle metering: RMS, real power, power factor, THD (fixed point)
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_METER.h"
+#include "DS_HARM.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Metering State
+*===================================================================*/
+
+static METER_Sums METER_Acc;                        // Window being accumulated, sample rate context only
+static METER_Sums METER_Latch;                      // Last closed window
+static volatile bool METER_Ready = false;           // METER_Latch not reduced yet
+static bool METER_Synced = false;                   // METER_Acc started on a crossing
+static uint16_t METER_Frac = 0;                     // Crossing offset of the window start (Q16 samples)
+static uint32_t METER_Fs = 0;
+static METER_Result METER_Out;
+
+static void METER_Clear(METER_Sums * sums){
+    sums->vv = 0;
+    sums->ii = 0;
+    sums->vi = 0;
+    sums->is = 0;
+    sums->ic = 0;
+    sums->ss = 0;
+    sums->cc = 0;
+    sums->n = 0;
+}
+
+/* fs = sample rate (Hz), the results restart from zero */
+void METER_Init(uint32_t fs){
+    METER_Clear(&METER_Acc);
+    METER_Ready = false;
+    METER_Synced = false;
+    METER_Frac = 0;
+    METER_Fs = fs;
+    METER_Out = (METER_Result){ 0 };
+}
+
+/*===================================================================
+    One synchronised sample pair (Q15) with the line phase of the PLL
+    (sin / cos Q15), seven multiply-accumulates and no branch on the
+    data: runs at the PWM rate next to the current loop
+ ===================================================================*/
+void METER_Sample(int32_t v, int32_t i, int16_t sin, int16_t cos){
+    METER_Acc.vv += v * v;
+    METER_Acc.ii += i * i;
+    METER_Acc.vi += v * i;
+    METER_Acc.is += i * sin;
+    METER_Acc.ic += i * cos;
+    METER_Acc.ss += sin * sin;
+    METER_Acc.cc += cos * cos;
+    if(++METER_Acc.n > METER_MAX_SAMPLES){
+        METER_Clear(&METER_Acc);                    // No crossing for too long
+        METER_Synced = false;
+    }
+}
+
+/* Rising zero crossing, frac = time since it in sample periods (Q16, PLL_ZC_Callback).
+   Call before the METER_Sample() of the same period: that sample opens the next window */
+void METER_Cycle_End(uint16_t frac){
+    if(METER_Synced && METER_Acc.n >= METER_MIN_SAMPLES){
+        METER_Latch = METER_Acc;
+        METER_Latch.len = (METER_Acc.n << 16) + METER_Frac - frac;
+        METER_Ready = true;                         // An unread window is replaced
+    }
+    METER_Clear(&METER_Acc);
+    METER_Synced = true;
+    METER_Frac = frac;
+}
+
+/* Bit by bit square root, floor(sqrt(x)) */
+uint32_t METER_Sqrt64(uint64_t x){
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while(bit > x){
+        bit >>= 2;
+    }
+    while(bit != 0){
+        if(x >= root + bit){
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/*===================================================================
+    Background reduction of the last closed window (square roots and
+    divides once per line cycle, never in the sample path). Returns
+    true when METER_Get() holds a new cycle. The fundamental comes
+    from the single bin correlation with the PLL phase (THD from the
+    harmonic analyser, the bins above h1 are its job):
+        a = sum(i sin) / sum(sin^2), b = sum(i cos) / sum(cos^2)
+        i1rms^2 = (a^2 + b^2) / 2
+ ===================================================================*/
+bool METER_Process(void){
+    METER_Sums w;
+    uint32_t primask = __get_PRIMASK();
+    int64_t a, b;
+    uint64_t vv, ii, i1;
+
+    __disable_irq();                                // The crossing may latch the next window meanwhile
+    if(!METER_Ready){
+        __set_PRIMASK(primask);
+        return false;
+    }
+    w = METER_Latch;
+    METER_Ready = false;
+    __set_PRIMASK(primask);
+
+    vv = (uint64_t)w.vv / w.n;                      // Q30
+    ii = (uint64_t)w.ii / w.n;
+    a = (w.ss > 0) ? (w.is << 15) / w.ss : 0;        // Q15 peak components
+    b = (w.cc > 0) ? (w.ic << 15) / w.cc : 0;
+    i1 = ((uint64_t)(a * a) + (uint64_t)(b * b)) >> 1;     // Q30
+
+    METER_Out.vrms = (int32_t)METER_Sqrt64(vv);
+    METER_Out.irms = (int32_t)METER_Sqrt64(ii);
+    METER_Out.i1rms = (int32_t)METER_Sqrt64(i1);
+    METER_Out.p = (int32_t)((w.vi / (int64_t)w.n) >> 15);
+    METER_Out.s = (METER_Out.vrms * METER_Out.irms) >> 15;
+    METER_Out.pf = (METER_Out.s > 0) ? (int32_t)(((int64_t)METER_Out.p << 15) / METER_Out.s) : 0;
+    METER_Out.dist = (i1 > 0) ? (int32_t)METER_Sqrt64((((ii > i1) ? ii - i1 : 0) << 30) / i1) : 0;
+    METER_Out.thd = (HARM_Get()->sweeps > 0) ? HARM_Get()->thd : 0;     // Band limited, h2..h40
+    METER_Out.freq = (uint32_t)(((uint64_t)METER_Fs << 24) / w.len);
+    METER_Out.samples = w.n;
+    METER_Out.cycles++;
+    return true;
+}
+
+const METER_Result * METER_Get(void){
+    return &METER_Out;
+}
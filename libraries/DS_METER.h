@@ -0,0 +1,84 @@
+/**
+ *******************************************************************************
+ * @file    DS_METER.h
+ * @brief   Line cycle metering: RMS, real power, power factor, THD (fixed point)
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __METER_H__
+#define __METER_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Window Settings
+*===================================================================*/
+/* A window is one line cycle, rising zero crossing to rising zero crossing */
+#define METER_MIN_SAMPLES                       64          // Shorter windows are dropped (noise on the crossing)
+#define METER_MAX_SAMPLES                       65535       // Longer ones restart (line lost), 0.5 s at 131 kHz
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+/* One line cycle in the units of the samples (Q15 inputs): RMS in the input scale,
+   power as mean(v * i) >> 15, ratios Q15 (0x8000 = 1.0).
+   thd is the IEC 61000-4-7 figure, sqrt(I2^2 + .. + I40^2) / I1 over harmonics 2 to
+   HARM_MAX, taken from the last whole sweep of the harmonic analyser (DS_HARM), so it
+   follows the line 10 cycles late and stays 0 until HARM_Init() has run a sweep.
+   dist is everything besides the fundamental in this cycle: harmonics above h40,
+   noise and DC offset as well, always the larger of the two */
+typedef struct
+{
+    int32_t vrms;                   // Voltage RMS
+    int32_t irms;                   // Current RMS
+    int32_t i1rms;                  // Current fundamental RMS
+    int32_t p;                      // Real power, mean(v * i) >> 15
+    int32_t s;                      // Apparent power, vrms * irms >> 15
+    int32_t pf;                     // Power factor p / s (Q15, negative when power flows back)
+    int32_t thd;                    // Current THD h2..h40 (Q15), see below
+    int32_t dist;                   // Current distortion sqrt(irms^2 - i1rms^2) / i1rms (Q15), see below
+    uint32_t freq;                  // Line frequency (Hz, Q8)
+    uint32_t samples;               // Samples in the window
+    uint32_t cycles;                // Windows published
+} METER_Result;
+
+/* Sums of one window, latched at the crossing and reduced by METER_Process() */
+typedef struct
+{
+    int64_t vv;                     // sum v^2 (Q30)
+    int64_t ii;                     // sum i^2 (Q30)
+    int64_t vi;                     // sum v * i (Q30)
+    int64_t is;                     // sum i * sin(theta) (Q30), fundamental in phase
+    int64_t ic;                     // sum i * cos(theta) (Q30), fundamental in quadrature
+    int64_t ss;                     // sum sin^2 / sum cos^2 (Q30), exact normalisation of a window
+    int64_t cc;                     // that is not a whole number of samples
+    uint32_t n;                     // Samples
+    uint32_t len;                   // Window length in sample periods (Q16)
+} METER_Sums;
+
+/*===================================================================*
+                  Functions declaration for METER
+*===================================================================*/
+void METER_Init(uint32_t fs);
+void METER_Sample(int32_t v, int32_t i, int16_t sin, int16_t cos);
+void METER_Cycle_End(uint16_t frac);
+bool METER_Process(void);
+const METER_Result * METER_Get(void);
+uint32_t METER_Sqrt64(uint64_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __METER_H__ */
@@ -0,0 +1,498 @@
+/**
+*******************************************************************************
+* @file    DS_PFC.c
+* @brief   Totem-Pole PFC average current mode control (fixed point)
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_PFC.h"
+#include "APMD.h"
+#include "DS_ADC.h"
+#include "DS_PLL.h"
+#include "DS_METER.h"
+#include "DS_HARM.h"
+#include "DS_SCOPE.h"
+#include "DS_PROT.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Current Loop State
+*===================================================================*/
+
+static PFC_PI PFC_Current_PI;
+static volatile int32_t PFC_Conductance = 0;        // Line current per line volt (Q12, Q15 A / Q15 V)
+static volatile PFC_Status PFC_St;
+static bool PFC_Sat_Low = false;                    // Duty clamped at 0% on the last sample
+static bool PFC_Sat_High = false;                   // Duty clamped at 100% on the last sample
+
+/*===================================================================*
+                        Voltage Loop State
+*===================================================================*/
+
+static PFC_PI PFC_Voltage_PI;
+static volatile int32_t PFC_Vbus_Ref = PFC_VBUS_REF_DEFAULT;
+static bool PFC_VLoop_On = true;
+static bool PFC_VFilter_On = true;
+static uint8_t PFC_Decim = 0;
+
+static uint16_t PFC_MA_Buf[PFC_VLOOP_MA_MAX];       // Decimated bus voltage history
+static uint8_t PFC_MA_Head = 0;
+static uint8_t PFC_MA_N = 0;                        // Whole taps in PFC_MA_Sum
+static int32_t PFC_MA_Sum = 0;
+static bool PFC_MA_Empty = true;
+static uint32_t PFC_Window = 0;                     // Half line cycle in voltage loop samples (Q8)
+
+static PLL_SOGI PFC_PLL;                            // Line phase, frequency and amplitude
+static int32_t PFC_Vpk = PFC_VPK_DEFAULT;
+
+/*===================================================================*
+                    Zero Crossing Sequence State
+*===================================================================*/
+
+/* What ends a state */
+#define PFC_ZC_EXIT_APPROACH                    0           // Crossing closer than the blank length
+#define PFC_ZC_EXIT_CROSSING                    1           // PLL zero crossing callback
+#define PFC_ZC_EXIT_TIMER                       2           // State length elapsed
+
+#define PFC_FAST_MASTER                         APMD_LEG_ROLES      // Master switch alone (upper or lower with the polarity)
+
+typedef struct
+{
+    APMD_Leg fast;                  // Fast leg, PWM / PFC_FAST_MASTER = current loop duty
+    bool slow_on;                   // Slow leg on the half cycle polarity, else both switches off
+    bool ramp;                      // Master on time ramps from zero (current loop restarts on entry)
+    uint8_t exit;
+    PFC_ZC_State next;
+} PFC_ZC_Entry;
+
+static const PFC_ZC_Entry PFC_ZC_Table[PFC_ZC_STATES] = {
+    /* fast             slow    ramp    exit                   next          */
+    { APMD_LEG_PWM,     true,   false,  PFC_ZC_EXIT_APPROACH,  PFC_ZC_BLANK },     // PFC_ZC_RUN
+    { APMD_LEG_OFF,     true,   false,  PFC_ZC_EXIT_CROSSING,  PFC_ZC_DEAD  },     // PFC_ZC_BLANK
+    { APMD_LEG_OFF,     false,  false,  PFC_ZC_EXIT_TIMER,     PFC_ZC_RAMP  },     // PFC_ZC_DEAD
+    { PFC_FAST_MASTER,  true,   true,   PFC_ZC_EXIT_TIMER,     PFC_ZC_RUN   },     // PFC_ZC_RAMP
+};
+
+static bool PFC_ZC_On = false;
+static PFC_ZC_State PFC_ZC_St = PFC_ZC_RUN;
+static uint16_t PFC_ZC_Len[PFC_ZC_STATES] = { 0, PFC_ZC_BLANK_DEFAULT, PFC_ZC_DEAD_DEFAULT, PFC_ZC_RAMP_DEFAULT };
+static int32_t PFC_ZC_Ramp_Step = PFC_DUTY_MAX / ((PFC_ZC_RAMP_DEFAULT != 0) ? PFC_ZC_RAMP_DEFAULT : 1);
+static uint16_t PFC_ZC_Timer = 0;                   // Carrier periods spent in the state
+static bool PFC_ZC_Crossed = false;                 // Set by the PLL callback, same interrupt
+static bool PFC_ZC_Rising = false;
+static bool PFC_Neg = false;                        // Negative half cycle: slow leg upper on, fast leg upper is the master
+static APMD_Leg PFC_Fast_Leg = APMD_LEG_PWM;
+static APMD_Leg PFC_Slow_Leg = APMD_LEG_OFF;
+static int32_t PFC_Master_Cap = PFC_DUTY_MAX;       // Master switch on time limit
+
+static void PFC_Line_Edge(bool rising, uint16_t frac);
+static void PFC_ZC_Sequence(int32_t vac);
+
+/*===================================================================
+    Current loop on the PMD0 carrier period interrupt (INTPWM0 at
+    the carrier end, half a period after the peak samples)
+ ===================================================================*/
+void PFC_Init(void){
+    APMD_Stage stage;
+
+    PFC_Stop();
+    APMD_Stage_Begin(&stage, PFC_PMD);
+    MDCR_INTPRD_ONEPERIOD(&stage);                  // One INTPWM0 every carrier period
+    MDCR_PINT_END(&stage);                          // At the carrier end (triangle valley)
+    APMD_Stage_Commit(&stage);
+
+    APMD_ADC_Trigger_Config(PFC_PMD);               // TRG0 at the carrier peak, TRG1 at TRGCMP1
+    setPWM_TriggerPoint(PFC_PMD, 1, PFC_TRGCMP1_DEFAULT);
+    ADC_PMD_Trigger_Setting(TSB_ADA);              // The loop needs the PMD synchronised samples whatever mode ADC_Handle_A is in
+
+    PFC_PI_Init(&PFC_Current_PI, PFC_KP_I_DEFAULT, PFC_KI_I_DEFAULT, -PFC_DUTY_MAX, PFC_DUTY_MAX);
+    PFC_PI_Init(&PFC_Voltage_PI, PFC_KP_V_DEFAULT, PFC_KI_V_DEFAULT, 0, PFC_IAMP_MAX);
+    PFC_Conductance = 0;
+}
+
+void PFC_Start(void){
+    PFC_Current_PI.integ = 0;
+    PFC_Sat_Low = false;
+    PFC_Sat_High = false;
+    PFC_St.count = 0;
+    PFC_St.saturated = 0;
+
+    /* Half line cycle window for PFC_LINE_HZ_DEFAULT at the running carrier, until measured */
+    uint32_t fpwm = (uint32_t)(((uint64_t)SystemCoreClock * PFC_PMD->RATE) >> 24);
+    PFC_Window = (fpwm << 8) / (2UL * PFC_LINE_HZ_DEFAULT * PFC_VLOOP_DECIM);
+    PFC_Window = (PFC_Window < (PFC_VLOOP_MA_MIN << 8)) ? (PFC_VLOOP_MA_MIN << 8) :
+                 ((PFC_Window >= ((PFC_VLOOP_MA_MAX - 1) << 8)) ? ((PFC_VLOOP_MA_MAX - 1) << 8) : PFC_Window);
+    PFC_Voltage_PI.integ = 0;
+    PFC_MA_Empty = true;
+    PFC_Decim = 0;
+    PFC_Vpk = PFC_VPK_DEFAULT;
+    PLL_Init(&PFC_PLL, fpwm);
+    PLL_Set_Callback(&PFC_PLL, PFC_Line_Edge);
+    METER_Init(fpwm);
+    HARM_Restart();
+    PFC_ZC_St = PFC_ZC_RUN;
+    PFC_ZC_Timer = 0;
+    PFC_ZC_Crossed = false;
+    PFC_Master_Cap = PFC_DUTY_MAX;
+
+    /* Leg roles from scratch, a protection release (DS_PROT) leaves every output off */
+    APMD_Leg_Set(PFC_SLOW_PMD, 'U', APMD_LEG_OFF);
+    APMD_Leg_Set(PFC_PMD, 'U', APMD_LEG_PWM);
+    PFC_Slow_Leg = APMD_LEG_OFF;
+    PFC_Fast_Leg = APMD_LEG_PWM;
+
+    NVIC_ClearPendingIRQ(INTPWM0_IRQn);
+    NVIC_EnableIRQ(INTPWM0_IRQn);
+}
+
+/* The fast leg keeps its last compare value */
+void PFC_Stop(void){
+    NVIC_DisableIRQ(INTPWM0_IRQn);
+}
+
+void PFC_Set_Current_Gains(int32_t kp, int32_t ki){
+    PFC_Current_PI.kp = kp;
+    PFC_Current_PI.ki = ki;
+}
+
+/* Current reference = g * line voltage, set by the voltage loop (0 .. PFC_G_MAX) */
+void PFC_Set_Conductance(int32_t g){
+    PFC_Conductance = (g < 0) ? 0 : ((g > PFC_G_MAX) ? PFC_G_MAX : g);
+}
+
+int32_t PFC_Get_Conductance(void){
+    return PFC_Conductance;
+}
+
+void PFC_Set_Voltage_Gains(int32_t kp, int32_t ki){
+    PFC_Voltage_PI.kp = kp;
+    PFC_Voltage_PI.ki = ki;
+}
+
+void PFC_Set_Vbus_Ref(int32_t vref){
+    PFC_Vbus_Ref = vref;
+}
+
+/* Off = the conductance comes from PFC_Set_Conductance() */
+void PFC_Voltage_Loop_Enable(bool enable){
+    PFC_VLoop_On = enable;
+}
+
+/* Off = the loop sees the raw bus voltage (2x line ripple included) */
+void PFC_Voltage_Filter_Enable(bool enable){
+    PFC_VFilter_On = enable;
+}
+
+/*===================================================================
+    Zero crossing sequence on/off (call while stopped). On: the slow
+    leg is driven by PFC_SLOW_PMD, off: the slow leg is left to the
+    hardware (or the application) and PFC_SLOW_PMD is stopped
+ ===================================================================*/
+void PFC_ZC_Enable(bool enable){
+    PFC_ZC_On = enable;
+    PFC_ZC_St = PFC_ZC_RUN;
+    PFC_ZC_Timer = 0;
+    PFC_ZC_Crossed = false;
+    PFC_Master_Cap = PFC_DUTY_MAX;
+
+    if(enable){
+        setPWM_Form(PFC_SLOW_PMD);                  // Fixed outputs, its carrier only times the MDOUT updates
+        setPWM_Frequency(PFC_SLOW_PMD, PFC_PMD->RATE);
+        APMD_Leg_Set(PFC_SLOW_PMD, 'U', APMD_LEG_OFF);
+        MDEN_PWMEN_ENABLE(PFC_SLOW_PMD);
+    }
+    else {
+        APMD_Leg_Set(PFC_SLOW_PMD, 'U', APMD_LEG_OFF);
+        MDEN_PWMEN_DISABLE(PFC_SLOW_PMD);
+    }
+    PFC_Slow_Leg = APMD_LEG_OFF;
+    PFC_Fast_Leg = APMD_LEG_PWM;
+    APMD_Leg_Set(PFC_PMD, 'U', APMD_LEG_PWM);
+}
+
+/* Blank before the crossing, dead zone after it and duty ramp, in carrier periods */
+void PFC_Set_ZC_Sequence(uint16_t blank, uint16_t dead, uint16_t ramp){
+    PFC_ZC_Len[PFC_ZC_BLANK] = blank;
+    PFC_ZC_Len[PFC_ZC_DEAD] = dead;
+    PFC_ZC_Len[PFC_ZC_RAMP] = ramp;
+    PFC_ZC_Ramp_Step = (ramp == 0) ? PFC_DUTY_MAX : (PFC_DUTY_MAX / ramp);
+}
+
+const volatile PFC_Status * PFC_Get_Status(void){
+    return &PFC_St;
+}
+
+const PLL_SOGI * PFC_Get_PLL(void){
+    return &PFC_PLL;
+}
+
+/*===================================================================
+    Q15 PI (Q12 gains). hold freezes the integrator while the stage
+    after it is saturated in the direction the error pushes it
+ ===================================================================*/
+void PFC_PI_Init(PFC_PI * pi, int32_t kp, int32_t ki, int32_t out_min, int32_t out_max){
+    pi->kp = kp;
+    pi->ki = ki;
+    pi->integ = 0;
+    pi->out_min = out_min;
+    pi->out_max = out_max;
+}
+
+int32_t PFC_PI_Run(PFC_PI * pi, int32_t error, bool hold){
+    int32_t lo = pi->out_min << PFC_GAIN_SHIFT;
+    int32_t hi = pi->out_max << PFC_GAIN_SHIFT;
+    int32_t out;
+
+    error = __SSAT(error, 16);
+    if(!hold){
+        pi->integ += pi->ki * error;
+        pi->integ = (pi->integ < lo) ? lo : ((pi->integ > hi) ? hi : pi->integ);
+    }
+    out = (pi->kp * error + pi->integ) >> PFC_GAIN_SHIFT;
+    return (out < pi->out_min) ? pi->out_min : ((out > pi->out_max) ? pi->out_max : out);
+}
+
+/*===================================================================
+    Average current mode step: iref = g * vac, PI on the current
+    error gives the inductor voltage, the fast leg duty follows from
+    the line and bus voltage (upper switch on time):
+        d = ((negative half cycle ? vbus : 0) + vac - vl) / vbus
+ ===================================================================*/
+void PFC_Current_Loop(void){
+    int32_t il = ((int32_t)ADC_PMD_Sample[PFC_SLOT_IL] - PFC_IL_OFFSET) << PFC_IL_SHIFT;
+    int32_t vac = ((int32_t)ADC_PMD_Sample[PFC_SLOT_VAC] - PFC_VAC_OFFSET) << PFC_VAC_SHIFT;
+    int32_t vbus = (int32_t)ADC_PMD_Sample[PFC_SLOT_VBUS] << PFC_VBUS_SHIFT;
+    int32_t iref, error, vl = 0, num, duty = 0;
+
+    if(vbus < PFC_VBUS_MIN){
+        vbus = PFC_VBUS_MIN;
+    }
+    il = __SSAT(il, 16);
+    iref = __SSAT((PFC_Conductance * vac) >> PFC_GAIN_SHIFT, 16);
+    error = iref - il;
+
+    /* Half cycle polarity and leg roles */
+    PLL_Run(&PFC_PLL, vac);
+    METER_Sample(vac, il, PFC_PLL.sin, PFC_PLL.cos);   // After the crossing callback, this sample opens a window
+    HARM_Sample(il);
+    if(PFC_ZC_On){
+        PFC_ZC_Sequence(vac);
+    }
+    else {
+        PFC_Neg = (vac < 0);
+    }
+
+    if(PFC_Fast_Leg != APMD_LEG_OFF){
+        /* A larger inductor voltage lowers the duty: hold at 0% on a positive error, at 100% on a negative one */
+        PFC_Current_PI.out_min = -vbus;
+        PFC_Current_PI.out_max = vbus;
+        vl = PFC_PI_Run(&PFC_Current_PI, error, (PFC_Sat_Low && error > 0) || (PFC_Sat_High && error < 0));
+
+        num = (PFC_Neg ? vbus : 0) + vac - vl;
+        PFC_Sat_Low = (num <= 0);
+        PFC_Sat_High = (num >= vbus);
+        if(PFC_Sat_Low){
+            duty = 0;
+        }
+        else if(PFC_Sat_High){
+            duty = PFC_DUTY_MAX;
+        }
+        else {
+            duty = (num << 15) / vbus;
+        }
+
+        /* Master switch on time limit: upper in the negative half cycle, lower in the positive one */
+        if(PFC_Neg && duty > PFC_Master_Cap){
+            duty = PFC_Master_Cap;
+            PFC_Sat_High = true;
+        }
+        else if(!PFC_Neg && duty < PFC_DUTY_MAX - PFC_Master_Cap){
+            duty = PFC_DUTY_MAX - PFC_Master_Cap;
+            PFC_Sat_Low = true;
+        }
+        PWMCR_CMPU(PFC_PMD, duty);
+    }
+
+    PFC_St.il = (int16_t)il;
+    PFC_St.iref = (int16_t)iref;
+    PFC_St.vac = (int16_t)vac;
+    PFC_St.vbus = (int16_t)vbus;
+    PFC_St.vl = (int16_t)vl;
+    PFC_St.duty = (uint16_t)duty;
+    PFC_St.zc_state = (uint8_t)PFC_ZC_St;
+    PFC_St.count++;
+    if(PFC_Sat_Low || PFC_Sat_High){
+        PFC_St.saturated++;
+    }
+    SCOPE_Sample();
+
+    if(PFC_VLoop_On && ++PFC_Decim >= PFC_VLOOP_DECIM){
+        PFC_Decim = 0;
+        PFC_Voltage_Loop(vbus);
+    }
+}
+
+/*===================================================================
+    Zero crossing sequence, one table step per carrier period (no
+    loop): the fast leg is blanked PFC_ZC_BLANK periods ahead of the
+    crossing the PLL predicts, both legs stay off for the dead zone,
+    then the slow leg takes the new polarity and the master switch
+    restarts alone (synchronous rectifier off, its diode conducts) with
+    its on time ramping from zero. Until the PLL locks the slow leg
+    follows the sampled line polarity
+ ===================================================================*/
+static void PFC_Legs_Apply(APMD_Leg fast, bool slow_on){
+    APMD_Leg slow = !slow_on ? APMD_LEG_OFF : (PFC_Neg ? APMD_LEG_UPPER : APMD_LEG_LOWER);
+
+    if(fast == PFC_FAST_MASTER){
+        fast = PFC_Neg ? APMD_LEG_PWM_UPPER : APMD_LEG_PWM_LOWER;
+    }
+
+    if(fast != PFC_Fast_Leg){
+        APMD_Leg_Set(PFC_PMD, 'U', fast);
+        PFC_Fast_Leg = fast;
+    }
+    if(slow != PFC_Slow_Leg){
+        APMD_Leg_Set(PFC_SLOW_PMD, 'U', slow);
+        PFC_Slow_Leg = slow;
+        if(slow_on){
+            PROT_Line_Polarity(PFC_Neg);            // Over-current monitor of the new half cycle
+        }
+    }
+}
+
+static void PFC_ZC_Sequence(int32_t vac){
+    const PFC_ZC_Entry * e = &PFC_ZC_Table[PFC_ZC_St];
+    uint32_t ahead = 0x80000000UL - (PFC_PLL.theta & 0x7FFFFFFFUL);
+    bool done;
+
+    if(!PFC_PLL.locked){
+        PFC_ZC_St = PFC_ZC_RUN;
+        PFC_ZC_Timer = 0;
+        PFC_ZC_Crossed = false;
+        PFC_Master_Cap = PFC_DUTY_MAX;
+        PFC_Neg = (vac < 0);
+        PFC_Legs_Apply(APMD_LEG_PWM, true);
+        return;
+    }
+
+    switch(e->exit){
+        case PFC_ZC_EXIT_APPROACH:
+            done = PFC_ZC_Crossed || ((uint64_t)ahead <= (uint64_t)PFC_ZC_Len[PFC_ZC_BLANK] * PFC_PLL.step);
+            break;
+        case PFC_ZC_EXIT_CROSSING:
+            done = PFC_ZC_Crossed;
+            break;
+        default:
+            done = (PFC_ZC_Timer >= PFC_ZC_Len[PFC_ZC_St]);
+            break;
+    }
+    if(done){
+        if(e->exit == PFC_ZC_EXIT_CROSSING){
+            PFC_ZC_Crossed = false;
+            PFC_Neg = !PFC_ZC_Rising;
+            PFC_St.zc_count++;
+        }
+        PFC_ZC_St = e->next;
+        PFC_ZC_Timer = 0;
+        e = &PFC_ZC_Table[PFC_ZC_St];
+        if(e->ramp){
+            PFC_Current_PI.integ = 0;
+            PFC_Sat_Low = false;
+            PFC_Sat_High = false;
+        }
+        PFC_Legs_Apply(e->fast, e->slow_on);
+    }
+
+    PFC_Master_Cap = e->ramp ? (int32_t)(PFC_ZC_Timer + 1) * PFC_ZC_Ramp_Step : PFC_DUTY_MAX;
+    PFC_Master_Cap = (PFC_Master_Cap > PFC_DUTY_MAX) ? PFC_DUTY_MAX : PFC_Master_Cap;
+    if(PFC_ZC_Timer < 0xFFFFU){
+        PFC_ZC_Timer++;
+    }
+}
+
+/*===================================================================
+    Line zero crossing of the locked PLL: both edges step the zero
+    crossing sequence, the rising one also updates the half line
+    cycle window and the line peak for the voltage loop
+        window = fs / (2 * f * DECIM) = 2^31 / (step * DECIM)   (Q8)
+ ===================================================================*/
+static void PFC_Line_Edge(bool rising, uint16_t frac){
+    uint32_t window;
+
+    PFC_ZC_Crossed = true;
+    PFC_ZC_Rising = rising;
+    SCOPE_Line_Edge(rising);
+    if(!rising){
+        return;
+    }
+    METER_Cycle_End(frac);
+    HARM_Cycle_End(PFC_PLL.step);
+    window = (0x80000000UL / (PFC_PLL.step >> 8)) / PFC_VLOOP_DECIM;
+    if(window >= (PFC_VLOOP_MA_MIN << 8) && window < ((PFC_VLOOP_MA_MAX - 1) << 8)){
+        PFC_Window = window;
+    }
+    PFC_Vpk = (PFC_PLL.amp < PFC_VPK_MIN) ? PFC_VPK_MIN : PFC_PLL.amp;
+}
+
+/* Sliding average over PFC_Window samples: n whole taps plus the next older sample weighted by the fraction.
+   A new window length is reached one tap per sample (the window moves with the line frequency, a few taps
+   at a time), so the cost stays a handful of operations whatever the change */
+static int32_t PFC_Vbus_Average(int32_t vbus){
+    uint32_t n = PFC_Window >> 8;
+    uint32_t frac = PFC_Window & 0xFFUL;
+    uint16_t old;
+
+    if(PFC_MA_Empty){
+        for(uint8_t i = 0; i < PFC_VLOOP_MA_MAX; i++){
+            PFC_MA_Buf[i] = (uint16_t)vbus;
+        }
+        PFC_MA_N = (uint8_t)n;
+        PFC_MA_Sum = (int32_t)n * vbus;
+        PFC_MA_Empty = false;
+    }
+    if(n > PFC_MA_N){
+        PFC_MA_Sum += PFC_MA_Buf[(uint8_t)(PFC_MA_Head - PFC_MA_N) & (PFC_VLOOP_MA_MAX - 1)];
+        PFC_MA_N++;
+    }
+    else if(n < PFC_MA_N){
+        PFC_MA_N--;
+        PFC_MA_Sum -= PFC_MA_Buf[(uint8_t)(PFC_MA_Head - PFC_MA_N) & (PFC_VLOOP_MA_MAX - 1)];
+    }
+
+    PFC_MA_Head = (PFC_MA_Head + 1) & (PFC_VLOOP_MA_MAX - 1);
+    PFC_MA_Buf[PFC_MA_Head] = (uint16_t)vbus;
+    old = PFC_MA_Buf[(uint8_t)(PFC_MA_Head - PFC_MA_N) & (PFC_VLOOP_MA_MAX - 1)];
+    PFC_MA_Sum += vbus - old;
+
+    return ((PFC_MA_Sum << 8) + (int32_t)(frac * old)) / (int32_t)(((uint32_t)PFC_MA_N << 8) | frac);
+}
+
+/*===================================================================
+    Outer voltage loop: bus voltage error -> line current amplitude
+    (clamped 0 .. PFC_IAMP_MAX) -> conductance for the current loop
+ ===================================================================*/
+void PFC_Voltage_Loop(int32_t vbus){
+    int32_t avg = PFC_VFilter_On ? PFC_Vbus_Average(vbus) : vbus;
+    int32_t iamp = PFC_PI_Run(&PFC_Voltage_PI, PFC_Vbus_Ref - avg, false);
+
+    int32_t g = (iamp << PFC_GAIN_SHIFT) / PFC_Vpk;
+    PFC_Conductance = (g > PFC_G_MAX) ? PFC_G_MAX : g;  // Only reached under ~23 V peak at full amplitude
+
+    PFC_St.vbus_avg = (int16_t)avg;
+    PFC_St.iamp = (int16_t)iamp;
+    PFC_St.vpk = (int16_t)PFC_Vpk;
+    PFC_St.window = (uint16_t)PFC_Window;
+}
+
+void INTPWM0_IRQHandler(void){
+    PFC_Current_Loop();
+}
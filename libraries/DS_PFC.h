@@ -0,0 +1,146 @@
+/**
+ *******************************************************************************
+ * @file    DS_PFC.h
+ * @brief   Totem-Pole PFC average current mode control (fixed point)
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __PFC_H__
+#define __PFC_H__
+
+#include "TMPM4KyA.h"
+#include "APMD.h"
+#include "DS_PLL.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Sensing and Scaling
+*===================================================================*/
+#define PFC_PMD                                 TSB_PMD0    // Fast leg unit, its INTPWM0 runs the current loop
+
+/* PMD triggered ADC slots (see ADC_PMD_Trigger_Setting), ADC_PMD_REG() gives the result register */
+#define PFC_SLOT_IL                             0           // AINA05 - Inductor current, Carrier Peak (REG0)
+#define PFC_SLOT_VBUS                           2           // AINA07 - Bus voltage, TRGCMP1 (REG4)
+#define PFC_SLOT_VAC                            3           // AINA08 - Line voltage, TRGCMP1 (REG5)
+#define PFC_TRGCMP1_DEFAULT                     0x4000      // TRG1 half way up the carrier (duty scale), bus and line voltage sample point
+
+/* 12 bit results to Q15. Bus and line voltage must land on the same scale
+   (8 counts/V bus, 4 counts/V line -> 64 LSB/V, 512 V full scale) */
+#define PFC_IL_OFFSET                           2048        // Zero current code
+#define PFC_IL_SHIFT                            4           // 100 counts/A -> 1600 LSB/A, 20.48 A full scale
+#define PFC_IL_LSB_PER_A                        (100 << PFC_IL_SHIFT)
+#define PFC_VAC_OFFSET                          2048        // Zero line voltage code
+#define PFC_VAC_SHIFT                           4
+#define PFC_VBUS_SHIFT                          3
+#define PFC_VBUS_MIN                            64          // 1 V, floor of the duty divide
+
+/* Gains are Q12 (0x1000 = 1.0), the integrator runs in Q27 */
+#define PFC_GAIN_SHIFT                          12
+#define PFC_G_MAX                               0xFFFF      // Conductance limit (16.0), g * vac stays in int32
+#define PFC_KP_I_DEFAULT                        2458        // 15 V/A
+#define PFC_KI_I_DEFAULT                        227         // 90000 V/(A s) at 65 kHz (Ki * Ts)
+
+#define PFC_DUTY_MAX                            (int32_t)(0x8000)
+
+/* Outer voltage loop, every PFC_VLOOP_DECIM carrier periods on a sliding average over
+   exactly half a line cycle (notch at 2x line frequency and its harmonics) */
+#define PFC_VLOOP_DECIM                         16          // 4.06 kHz at a 65 kHz carrier
+#define PFC_VLOOP_MA_MAX                        64          // Taps, half line cycle down to ~32 Hz at 4.06 kHz
+#define PFC_VLOOP_MA_MIN                        8
+#define PFC_LINE_HZ_DEFAULT                     50          // Window used until the PLL locks
+#define PFC_VPK_DEFAULT                         20800       // 325 V until the PLL locks
+#define PFC_VPK_MIN                             1280        // 20 V, floor of the conductance divide
+#define PFC_VBUS_REF_DEFAULT                    25600       // 400 V
+#define PFC_IAMP_MAX                            24000       // 15 A line current amplitude
+#define PFC_KP_V_DEFAULT                        22000       // 0.21 A/V, ~30 Hz crossover with 470 uF at 400 V
+#define PFC_KI_V_DEFAULT                        500         // 20 A/(V s) at 4.06 kHz (Ki * Ts)
+
+/* Zero crossing sequence (once the PLL is locked), slow leg on the U phase of PFC_SLOW_PMD
+   held by the MDOUT fixed outputs. Lengths in carrier periods, one period minimum */
+#define PFC_SLOW_PMD                            TSB_PMD1
+#define PFC_ZC_BLANK_DEFAULT                    2           // Fast leg off before the crossing
+#define PFC_ZC_DEAD_DEFAULT                     2           // Both legs off after the crossing (dead zone)
+/* Master switch on time ramp from zero, off: pfc_sim --zc shows the same ~2.3 A peak
+   at the crossing for every ramp length and the THD rising from 16 periods up */
+#define PFC_ZC_RAMP_DEFAULT                     0
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+/* Q15 PI with Q12 gains, output and integrator clamped to [out_min, out_max] */
+typedef struct
+{
+    int32_t kp;                     // Proportional gain (Q12)
+    int32_t ki;                     // Integral gain per sample (Q12)
+    int32_t integ;                  // Integrator (Q27)
+    int32_t out_min;                // Output limits (Q15)
+    int32_t out_max;
+} PFC_PI;
+
+/* Zero crossing sequence states (PFC_ZC_Table in DS_PFC.c) */
+typedef enum
+{
+    PFC_ZC_RUN = 0,                 // Fast leg switching, slow leg on the half cycle polarity
+    PFC_ZC_BLANK,                   // Fast leg off until the crossing
+    PFC_ZC_DEAD,                    // Both legs off
+    PFC_ZC_RAMP,                    // Slow leg swapped, master switch on time ramping up
+    PFC_ZC_STATES
+} PFC_ZC_State;
+
+/* Last current loop sample, written only by INTPWM0 */
+typedef struct
+{
+    int16_t il;                     // Inductor current (Q15)
+    int16_t iref;                   // Current reference (Q15)
+    int16_t vac;                    // Line voltage (Q15)
+    int16_t vbus;                   // Bus voltage (Q15)
+    int16_t vl;                     // Inductor voltage demand (Q15)
+    uint16_t duty;                  // Fast leg compare (0x8000 = 100%)
+    uint32_t count;                 // Loop executions
+    uint32_t saturated;             // Samples with the duty clamped
+    int16_t vbus_avg;               // Half line cycle bus voltage average (Q15)
+    int16_t iamp;                   // Line current amplitude demand (Q15)
+    int16_t vpk;                    // Line peak from the PLL (Q15)
+    uint16_t window;                // Average length in voltage loop samples (Q8)
+    uint8_t zc_state;               // PFC_ZC_State
+    uint32_t zc_count;              // Zero crossings sequenced
+} PFC_Status;
+
+/*===================================================================*
+                  Functions declaration for PFC
+*===================================================================*/
+void PFC_Init(void);
+void PFC_Start(void);
+void PFC_Stop(void);
+void PFC_Set_Current_Gains(int32_t kp, int32_t ki);
+void PFC_Set_Conductance(int32_t g);
+int32_t PFC_Get_Conductance(void);
+void PFC_Set_Voltage_Gains(int32_t kp, int32_t ki);
+void PFC_Set_Vbus_Ref(int32_t vref);
+void PFC_Voltage_Loop_Enable(bool enable);
+void PFC_Voltage_Filter_Enable(bool enable);
+void PFC_ZC_Enable(bool enable);
+void PFC_Set_ZC_Sequence(uint16_t blank, uint16_t dead, uint16_t ramp);
+const volatile PFC_Status * PFC_Get_Status(void);
+const PLL_SOGI * PFC_Get_PLL(void);
+
+void PFC_PI_Init(PFC_PI * pi, int32_t kp, int32_t ki, int32_t out_min, int32_t out_max);
+int32_t PFC_PI_Run(PFC_PI * pi, int32_t error, bool hold);
+void PFC_Current_Loop(void);
+void PFC_Voltage_Loop(int32_t vbus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __PFC_H__ */
@@ -0,0 +1,171 @@
+/**
+*******************************************************************************
+* @file    DS_PLL.c
+* @brief   Line synchroniser, SOGI quadrature generator + SRF-PLL (fixed point)
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_PLL.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Sine Table
+*===================================================================*/
+
+/* First quarter of the sine, 128 intervals (Q15) */
+static const int16_t PLL_Sin_Table[129] = {
+        0,   402,   804,  1206,  1608,  2009,  2410,  2811,  3212,  3612,  4011,  4410,
+     4808,  5205,  5602,  5998,  6393,  6786,  7179,  7571,  7962,  8351,  8739,  9126,
+     9512,  9896, 10278, 10659, 11039, 11417, 11793, 12167, 12539, 12910, 13279, 13645,
+    14010, 14372, 14732, 15090, 15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869,
+    18204, 18537, 18868, 19195, 19519, 19841, 20159, 20475, 20787, 21096, 21403, 21705,
+    22005, 22301, 22594, 22884, 23170, 23452, 23731, 24007, 24279, 24547, 24811, 25072,
+    25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019, 27245, 27466, 27683, 27896,
+    28105, 28310, 28510, 28706, 28898, 29085, 29268, 29447, 29621, 29791, 29956, 30117,
+    30273, 30424, 30571, 30714, 30852, 30985, 31113, 31237, 31356, 31470, 31580, 31685,
+    31785, 31880, 31971, 32057, 32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+    32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765, 32767
+};
+
+/* sin(theta) (Q15), quarter wave table with linear interpolation */
+int16_t PLL_Sin_Q15(uint32_t theta){
+    uint32_t p = (theta & PLL_PHASE_90) ? (~theta & 0x3FFFFFFFUL) : (theta & 0x3FFFFFFFUL);
+    uint32_t i = p >> 23;
+    int32_t f = (int32_t)((p >> 7) & 0xFFFFUL);
+    int32_t s = PLL_Sin_Table[i] + (((PLL_Sin_Table[i + 1] - PLL_Sin_Table[i]) * f) >> 16);
+
+    return (int16_t)((theta & 0x80000000UL) ? -s : s);
+}
+
+/* Phase per sample for a frequency in Hz */
+static uint32_t PLL_Step(uint32_t hz, uint32_t fs){
+    return (uint32_t)(((uint64_t)hz << 32) / fs);
+}
+
+/*===================================================================
+    Gains for a sample rate fs (Hz), PI natural frequency PLL_BW_HZ:
+        kp = 2*zeta*wn*Ts  -> sqrt(2) * fn * 2^17 / fs
+        ki = (wn*Ts)^2     -> 2*pi * fn^2 * 2^33 / fs^2 (Q16)
+    in phase per sample for a Q15 (~rad) error
+ ===================================================================*/
+void PLL_Init(PLL_SOGI * pll, uint32_t fs){
+    pll->fs = fs;
+    pll->kp = (int32_t)(((uint64_t)PLL_SOGI_K * PLL_BW_HZ << 5) / fs);
+    pll->ki = (int32_t)(((uint64_t)PLL_TWO_PI_Q15 * PLL_BW_HZ * PLL_BW_HZ << 18) / ((uint64_t)fs * fs));
+    pll->step_min = PLL_Step(PLL_F_MIN_HZ, fs);
+    pll->step_max = PLL_Step(PLL_F_MAX_HZ, fs);
+    pll->step_split = PLL_Step(PLL_F_SPLIT_HZ, fs);
+    pll->lock_samples = (fs / PLL_F_START_HZ) * PLL_LOCK_CYCLES;
+    pll->on_zc = 0;
+    PLL_Reset(pll);
+}
+
+/* Back to PLL_F_START_HZ, unlocked (the callback is kept) */
+void PLL_Reset(PLL_SOGI * pll){
+    pll->step = PLL_Step(PLL_F_START_HZ, pll->fs);
+    pll->integ = (int64_t)pll->step << 16;
+    pll->wts = (uint32_t)(((uint64_t)pll->step * PLL_TWO_PI_Q15) >> 15);
+    pll->theta = 0;
+    pll->theta_prev = 0;
+    pll->sin = 0;
+    pll->cos = 32767;
+    pll->alpha = 0;
+    pll->beta = 0;
+    pll->amp = 0;
+    pll->err = 0;
+    pll->freq = (uint32_t)(((uint64_t)pll->step * pll->fs) >> 24);
+    pll->line_hz = 0;
+    pll->locked = false;
+    pll->lock_count = 0;
+}
+
+/* Called from PLL_Run(), in the same interrupt as the samples */
+void PLL_Set_Callback(PLL_SOGI * pll, PLL_ZC_Callback callback){
+    pll->on_zc = callback;
+}
+
+/*===================================================================
+    One sample v (Q15). Straight line code, no loop and no 64 bit
+    divide, so it fits in the current loop interrupt:
+      SOGI   alpha += wTs * (k * (v - alpha) - beta), beta += wTs * alpha
+      PD     vq = alpha * cos + beta * sin = A * sin(phase error)
+    The discrete SOGI puts alpha one sample and beta one and a half
+    ahead of the input, vq is rotated back by 1.25 * wTs
+      PI     step = integ + ki * vq / A, theta += step + kp * vq / A
+ ===================================================================*/
+void PLL_Run(PLL_SOGI * pll, int32_t v){
+    uint32_t now = pll->theta;
+    int64_t x;
+    int32_t a, b, vq, vd, err;
+    uint32_t m2, amp, delta, frac;
+
+    /* Quadrature generator, beta integrates the updated alpha (semi-implicit, stays on the unit circle) */
+    x = (((int64_t)PLL_SOGI_K * ((v << 14) - pll->alpha)) >> 12) - pll->beta;
+    pll->alpha += (int32_t)((x * (int64_t)pll->wts) >> 32);
+    pll->beta += (int32_t)(((int64_t)pll->alpha * (int64_t)pll->wts) >> 32);
+    a = __SSAT(pll->alpha >> 14, 16);
+    b = __SSAT(pll->beta >> 14, 16);
+
+    /* Amplitude: one Newton step of sqrt(a^2 + b^2) per sample */
+    m2 = (uint32_t)(a * a) + (uint32_t)(b * b);
+    amp = (pll->amp < 64) ? 64UL : (uint32_t)pll->amp;
+    pll->amp = (int32_t)((amp + m2 / amp) >> 1);
+
+    /* Phase detector on the phase used for this sample, normalised by the amplitude */
+    vq = (a * pll->cos + b * pll->sin) >> 15;
+    vd = (a * pll->sin - b * pll->cos) >> 15;
+    vq -= (vd * (int32_t)((pll->wts + (pll->wts >> 2)) >> 17)) >> 15;
+    if(pll->amp < PLL_AMP_MIN){
+        err = 0;                                    // No line: hold the frequency, drop the lock
+        pll->locked = false;
+        pll->lock_count = 0;
+    }
+    else {
+        err = __SSAT((vq << 15) / pll->amp, 16);
+        pll->integ += (int64_t)pll->ki * err;
+        if(pll->integ < ((int64_t)pll->step_min << 16)){
+            pll->integ = (int64_t)pll->step_min << 16;
+        }
+        else if(pll->integ > ((int64_t)pll->step_max << 16)){
+            pll->integ = (int64_t)pll->step_max << 16;
+        }
+        pll->step = (uint32_t)(pll->integ >> 16);
+        pll->wts = (uint32_t)(((uint64_t)pll->step * PLL_TWO_PI_Q15) >> 15);
+    }
+    pll->err = err;
+    pll->theta = now + pll->step + (uint32_t)(pll->kp * err);
+    pll->sin = PLL_Sin_Q15(pll->theta);
+    pll->cos = PLL_Sin_Q15(pll->theta + PLL_PHASE_90);
+    pll->freq = (uint32_t)(((uint64_t)pll->step * pll->fs) >> 24);
+
+    /* Lock after PLL_LOCK_CYCLES line cycles under the error limit, drop it at twice the limit */
+    if(err > -PLL_LOCK_ERR && err < PLL_LOCK_ERR){
+        if(pll->lock_count < pll->lock_samples){
+            pll->lock_count++;
+        }
+        else if(!pll->locked){
+            pll->locked = true;
+            pll->line_hz = (pll->step < pll->step_split) ? 50 : 60;
+        }
+    }
+    else if(err <= -2 * PLL_LOCK_ERR || err >= 2 * PLL_LOCK_ERR){
+        pll->locked = false;
+        pll->lock_count = 0;
+    }
+
+    /* Zero crossing between the previous and this sample, interpolated on the phase advance */
+    delta = now - pll->theta_prev;
+    if(pll->locked && pll->on_zc != 0 && ((now ^ pll->theta_prev) & 0x80000000UL) && delta < 0x80000000UL){
+        frac = (((now & 0x7FFFFFFFUL) >> 10) << 16) / ((delta >> 10) | 0x01UL);
+        pll->on_zc((now & 0x80000000UL) == 0, (uint16_t)((frac > 0xFFFFUL) ? 0xFFFFUL : frac));
+    }
+    pll->theta_prev = now;
+}
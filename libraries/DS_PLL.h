@@ -0,0 +1,95 @@
+/**
+ *******************************************************************************
+ * @file    DS_PLL.h
+ * @brief   Line synchroniser, SOGI quadrature generator + SRF-PLL (fixed point)
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __PLL_H__
+#define __PLL_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Loop Settings
+*===================================================================*/
+/* Phase is a full turn in 32 bits (0x40000000 = 90 deg), samples and outputs are Q15 */
+#define PLL_PHASE_90                            (uint32_t)(0x40000000UL)
+#define PLL_TWO_PI_Q15                          205887UL    // 2*pi (Q15)
+
+#define PLL_SOGI_K                              5793        // SOGI damping gain sqrt(2) (Q12)
+#define PLL_BW_HZ                               25          // PI natural frequency, damping 0.707
+#define PLL_F_MIN_HZ                            40          // Frequency range of the integrator
+#define PLL_F_MAX_HZ                            70
+#define PLL_F_START_HZ                          55          // Between both nominal frequencies
+#define PLL_F_SPLIT_HZ                          55          // Below = 50 Hz line, above = 60 Hz line
+
+#define PLL_AMP_MIN                             1280        // Below it the line is absent and the loop holds
+#define PLL_LOCK_ERR                            1638        // 0.05 rad phase error
+#define PLL_LOCK_CYCLES                         2           // Line cycles under PLL_LOCK_ERR before lock
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+/* Zero crossing of the locked phase: rising = negative to positive half cycle,
+   frac = time since the crossing in sample periods (Q16) */
+typedef void (*PLL_ZC_Callback)(bool rising, uint16_t frac);
+
+typedef struct
+{
+    /* Outputs, valid after every PLL_Run() */
+    uint32_t theta;                 // Line phase at the next sample (full turn = 2^32), 0 at the rising zero crossing
+    int16_t sin;                    // sin(theta) (Q15)
+    int16_t cos;                    // cos(theta) (Q15)
+    int32_t amp;                    // Line amplitude (Q15)
+    int32_t err;                    // Normalised phase error (Q15, ~rad)
+    uint32_t freq;                  // Line frequency (Hz, Q8)
+    uint8_t line_hz;                // Detected nominal frequency (50 / 60), 0 until the first lock
+    bool locked;
+
+    /* SOGI, alpha in phase with the input, beta lagging 90 deg (Q29) */
+    int32_t alpha;
+    int32_t beta;
+    uint32_t wts;                   // omega * Ts at the integrator frequency (Q32)
+
+    /* PI on the phase error, phase increments per sample */
+    uint32_t step;                  // Integrator frequency (phase per sample)
+    int64_t integ;                  // Integrator (Q16 phase per sample)
+    int32_t kp;                     // Phase per sample per Q15 error
+    int32_t ki;                     // Phase per sample per Q15 error and sample (Q16)
+    uint32_t step_min;
+    uint32_t step_max;
+    uint32_t step_split;            // Step at PLL_F_SPLIT_HZ
+    uint32_t fs;                    // Sample rate (Hz)
+    uint32_t theta_prev;            // Phase of the last sample, for the zero crossing
+
+    uint32_t lock_count;            // Samples under PLL_LOCK_ERR
+    uint32_t lock_samples;
+    PLL_ZC_Callback on_zc;
+} PLL_SOGI;
+
+/*===================================================================*
+                  Functions declaration for PLL
+*===================================================================*/
+void PLL_Init(PLL_SOGI * pll, uint32_t fs);
+void PLL_Reset(PLL_SOGI * pll);
+void PLL_Set_Callback(PLL_SOGI * pll, PLL_ZC_Callback callback);
+void PLL_Run(PLL_SOGI * pll, int32_t v);
+int16_t PLL_Sin_Q15(uint32_t theta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __PLL_H__ */
@@ -0,0 +1,182 @@
+/**
+*******************************************************************************
+* @file    DS_PROT.c
+* @brief   Hardware fast-trip protection, A-PMD EMG / OVV with the ADC monitors
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_PROT.h"
+#include "APMD.h"
+#include "DS_ADC.h"
+#include "DS_PFC.h"
+#include "DS_SCOPE.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Protection State
+*===================================================================*/
+
+static volatile PROT_State PROT_St = PROT_OFF;
+static PROT_Fault PROT_Last;
+static volatile uint32_t PROT_Trips = 0;
+static uint16_t PROT_IL_Max = PROT_IL_MAX_DEFAULT;
+static volatile bool PROT_IL_Neg = false;           // ADC monitor 1 watching the negative half cycle
+
+/* ADC monitor 1 on the inductor current of the line polarity: one shot without interrupt,
+   the output goes through OVV and INTOVV0 takes the trip */
+static void PROT_IL_Arm(void){
+    ADC_Monitor il = { PROT_REG_IL, PROT_IL_Max, ADC_CMP_ABOVE, PROT_CMP_COUNT, false, 0, 0 };
+
+    if(PROT_IL_Neg){
+        il.level = (uint16_t)(2 * PROT_IL_ZERO - PROT_IL_Max);
+        il.dir = ADC_CMP_BELOW;
+    }
+    ADC_Monitor_Arm(PROT_ADC, 1, &il);
+}
+
+/*===================================================================
+    The shutdown is all hardware: the EMG input (external current
+    comparator) and the ADC monitors (through OVV) turn the fast leg
+    outputs off without the CPU, the slow leg unit follows through
+    SYNCCR. INTEMG0 / INTOVV0 only stop the loops and keep a snapshot
+ ===================================================================*/
+void PROT_Init(void){
+    PROT_St = PROT_OFF;
+    PROT_Trips = 0;
+    PROT_Last.source = 0;
+
+    /* ADC monitor 0: bus over-voltage, monitor 1: inductor over-current of the positive half
+       cycle until PROT_Line_Polarity(). One shot without interrupt, the outputs go through OVV
+       and INTOVV0 takes the trip */
+    ADC_Monitor vbus = { PROT_REG_VBUS, PROT_VBUS_MAX_DEFAULT, ADC_CMP_ABOVE, PROT_CMP_COUNT, false, 0, 0 };
+    ADC_Monitor_Arm(PROT_ADC, 0, &vbus);
+    PROT_IL_Max = PROT_IL_MAX_DEFAULT;
+    PROT_IL_Neg = false;
+    PROT_IL_Arm();
+
+    APMD_EMG_Enable(PROT_PMD, PROT_EMG_COUNT);
+    APMD_OVV_Enable(PROT_PMD, OVVCR_ADIN0EN_MASK | OVVCR_ADIN1EN_MASK, PROT_OVV_COUNT);
+    SYNCCR_EMGSMD_ENABLE_EMG_DISABLE(PFC_SLOW_PMD);     // Slow leg off with the fast leg EMG
+    SYNCCR_OVVSMD_ENABLE_OVV_DISABLE(PFC_SLOW_PMD);     // and OVV
+
+    NVIC_ClearPendingIRQ(INTEMG0_IRQn);
+    NVIC_ClearPendingIRQ(INTOVV0_IRQn);
+    NVIC_EnableIRQ(INTEMG0_IRQn);
+    NVIC_EnableIRQ(INTOVV0_IRQn);
+    PROT_St = PROT_ARMED;
+}
+
+/* Monitor levels in 12 bit codes (il_max from PROT_IL_ZERO up, mirrored for the negative half cycle),
+   take effect on the next conversion */
+void PROT_Set_Limits(uint16_t vbus_max, uint16_t il_max){
+    uint32_t primask = __get_PRIMASK();
+
+    ADC_Monitor_Set_Level(PROT_ADC, 0, vbus_max);
+    if(il_max <= PROT_IL_ZERO || il_max > ADC_CODE_MAX){
+        return;
+    }
+    __disable_irq();                                // Against a polarity change from the current loop
+    PROT_IL_Max = il_max;
+    ADC_Monitor_Set_Level(PROT_ADC, 1, PROT_IL_Neg ? (uint16_t)(2 * PROT_IL_ZERO - il_max) : il_max);
+    __set_PRIMASK(primask);
+}
+
+/* Line polarity the slow leg has taken (current loop, both legs off around it): the inductor
+   current monitor turns to that half cycle, the EMG comparator keeps both polarities */
+void PROT_Line_Polarity(bool neg){
+    if(PROT_St == PROT_OFF || neg == PROT_IL_Neg){
+        return;
+    }
+    PROT_IL_Neg = neg;
+    PROT_IL_Arm();
+}
+
+/*===================================================================
+    Controlled re-arm: refused unless tripped and both inputs have
+    cleared. The fast leg (PROT_PMD, every phase) and the slow leg are
+    put on fixed output with both switches off and EMGRS / OVVRS
+    written; the state goes back to PROT_ARMED at the next carrier
+    period (PROT_Get_State()), then PFC_Start() restores the leg roles
+ ===================================================================*/
+uint8_t PROT_Rearm(void){
+    if(PROT_St != PROT_TRIPPED){
+        return PROT_REARM_ERR_STATE;
+    }
+    if(!APMD_Protect_Release(PROT_PMD)){
+        return PROT_REARM_ERR_INPUT;
+    }
+    APMD_Leg_Set(PROT_PMD, 'U', APMD_LEG_OFF);      // Already off from the release, kept explicit
+    APMD_Leg_Set(PFC_SLOW_PMD, 'U', APMD_LEG_OFF);
+    PROT_St = PROT_RELEASE;
+    return PROT_REARM_OK;
+}
+
+PROT_State PROT_Get_State(void){
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();                                // A trip between the read and the write wins
+    if(PROT_St == PROT_RELEASE &&
+       ((PROT_PMD->EMGSTA & EMGSTA_EMGST_MASK) | (PROT_PMD->OVVSTA & OVVSTA_OVVST_MASK)) == 0){
+        PROT_St = PROT_ARMED;
+    }
+    __set_PRIMASK(primask);
+    return PROT_St;
+}
+
+const PROT_Fault * PROT_Get_Fault(void){
+    return &PROT_Last;
+}
+
+uint32_t PROT_Get_Trips(void){
+    return PROT_Trips;
+}
+
+/*===================================================================*
+                        Trip Handlers
+*===================================================================*/
+
+static uint16_t PROT_Result(uint8_t reg){
+    return (uint16_t)ADC_Result(PROT_ADC, reg);
+}
+
+static void PROT_Trip(uint8_t source){
+    const volatile PFC_Status * st = PFC_Get_Status();
+
+    if(PROT_St == PROT_TRIPPED){
+        PROT_Last.source |= source;                 // Other source of the same event
+        return;
+    }
+    PFC_Stop();                                     // Loops off, the outputs are already off
+    SCOPE_Fault();                                  // A running capture keeps the samples up to the trip
+
+    PROT_Last.source = source;
+    PROT_Last.emgsta = PROT_PMD->EMGSTA;
+    PROT_Last.ovvsta = PROT_PMD->OVVSTA;
+    PROT_Last.mdout = PROT_PMD->MDOUT;
+    PROT_Last.cmpu = PROT_PMD->CMPU;
+    PROT_Last.il = PROT_Result(PROT_REG_IL);
+    PROT_Last.vbus = PROT_Result(PROT_REG_VBUS);
+    PROT_Last.vac = PROT_Result(ADC_PMD_REG(PFC_SLOT_VAC));
+    PROT_Last.iref = st->iref;
+    PROT_Last.zc_state = st->zc_state;
+    PROT_Last.theta = PFC_Get_PLL()->theta;
+    PROT_Last.count = st->count;
+    PROT_Trips++;
+    PROT_St = PROT_TRIPPED;
+}
+
+void INTEMG0_IRQHandler(void){
+    PROT_Trip(PROT_SRC_EMG);
+}
+
+void INTOVV0_IRQHandler(void){
+    PROT_Trip(PROT_SRC_OVV);
+}
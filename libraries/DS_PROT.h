@@ -0,0 +1,97 @@
+/**
+ *******************************************************************************
+ * @file    DS_PROT.h
+ * @brief   Hardware fast-trip protection, A-PMD EMG / OVV with the ADC monitors
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __PROT_H__
+#define __PROT_H__
+
+#include "TMPM4KyA.h"
+#include "DS_PFC.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Trip Settings
+*===================================================================*/
+#define PROT_PMD                                PFC_PMD     // EMG input and OVV of the fast leg unit (INTEMG0 / INTOVV0)
+#define PROT_ADC                                TSB_ADA     // ADC monitor 0 / 1 outputs feed OVVCR ADIN0EN / ADIN1EN
+
+/* Monitored PMD triggered results (result register of the DS_PFC.h slot) and levels in 12 bit codes */
+#define PROT_REG_VBUS                           ADC_PMD_REG(PFC_SLOT_VBUS)
+#define PROT_REG_IL                             ADC_PMD_REG(PFC_SLOT_IL)
+#define PROT_VBUS_MAX_DEFAULT                   3600        // 450 V bus (8 counts/V), ADC monitor 0
+#define PROT_IL_MAX_DEFAULT                     3948        // +19 A inductor current (2048 + 100 counts/A), ADC monitor 1
+#define PROT_IL_ZERO                            2048        // 0 A, the negative level mirrors the positive one: 148 = -19 A
+#define PROT_CMP_COUNT                          0           // Extra conversions over the level before the monitor output
+
+/* Noise filters, 16/fsys per count. The EMG input is the external window comparator
+   on the inductor current (both polarities), the ADC monitor 1 is its slower backup:
+   above the level in the positive half cycle, below the mirrored one in the negative */
+#define PROT_EMG_COUNT                          2           // 200 ns at 160 MHz
+#define PROT_OVV_COUNT                          1
+
+/* Fault sources (PROT_Fault.source) */
+#define PROT_SRC_EMG                            (uint8_t)(0x01)
+#define PROT_SRC_OVV                            (uint8_t)(0x02)
+
+/* PROT_Rearm() result (0 = release written) */
+#define PROT_REARM_OK                           (uint8_t)(0x00)
+#define PROT_REARM_ERR_STATE                    (uint8_t)(0x01)     // Not tripped
+#define PROT_REARM_ERR_INPUT                    (uint8_t)(0x02)     // EMG input or monitored result still over the level
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef enum
+{
+    PROT_OFF = 0,                   // PROT_Init() not called
+    PROT_ARMED,                     // EMG / OVV watching, outputs free
+    PROT_TRIPPED,                   // Outputs held off by the A-PMD, fault captured
+    PROT_RELEASE                    // Release written, waiting for the protection state to clear
+} PROT_State;
+
+/* Captured by the first INTEMG0 / INTOVV0 of a trip, the outputs are already off by then */
+typedef struct
+{
+    uint8_t source;                 // PROT_SRC_ bits, a second source of the same trip is added
+    uint32_t emgsta;                // EMGSTA / OVVSTA in the handler
+    uint32_t ovvsta;
+    uint32_t mdout;                 // Leg roles at the trip
+    uint32_t cmpu;                  // Fast leg compare at the trip
+    uint16_t il;                    // Latest IL / VBUS / VAC conversions (12 bit codes)
+    uint16_t vbus;
+    uint16_t vac;
+    int16_t iref;                   // Current reference of the last loop sample (Q15)
+    uint8_t zc_state;               // PFC_ZC_State
+    uint32_t theta;                 // Line phase (full turn = 2^32)
+    uint32_t count;                 // Current loop executions, time stamp in carrier periods
+} PROT_Fault;
+
+/*===================================================================*
+                  Functions declaration for PROT
+*===================================================================*/
+void PROT_Init(void);
+void PROT_Set_Limits(uint16_t vbus_max, uint16_t il_max);
+void PROT_Line_Polarity(bool neg);
+uint8_t PROT_Rearm(void);
+PROT_State PROT_Get_State(void);
+const PROT_Fault * PROT_Get_Fault(void);
+uint32_t PROT_Get_Trips(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __PROT_H__ */
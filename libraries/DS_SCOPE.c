@@ -0,0 +1,279 @@
+/**
+*******************************************************************************
+* @file    DS_SCOPE.c
+* @brief   Pre-trigger waveform capture of the current loop, binary UART dump
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_SCOPE.h"
+#include "DS_ADC.h"
+#include "DS_PFC.h"
+#include "DS_UART.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*===================================================================*
+                        Capture State
+*===================================================================*/
+
+static uint16_t SCOPE_Buf[SCOPE_DEPTH][SCOPE_CHANNELS];
+static const volatile uint16_t * SCOPE_Src[SCOPE_CHANNELS];
+static SCOPE_Config SCOPE_Cfg;
+static volatile SCOPE_State SCOPE_St = SCOPE_IDLE;
+
+/* Sample rate context while recording, frozen afterwards */
+static uint16_t SCOPE_Head = 0;                     // Next slot
+static uint16_t SCOPE_Filled = 0;                   // Valid samples, up to SCOPE_DEPTH
+static uint16_t SCOPE_Since = 0;                    // Samples from the trigger sample on
+static uint16_t SCOPE_Post = 0;                     // Samples still to record after the trigger
+static uint16_t SCOPE_Skip = 0;
+static int32_t SCOPE_Prev = 0;
+
+/* Dump position (background) */
+static uint32_t SCOPE_Pos = 0;
+static uint8_t SCOPE_Sum1 = 0;
+static uint8_t SCOPE_Sum2 = 0;
+
+/* Inductor current, line and bus voltage codes and the fast leg duty */
+void SCOPE_Init(void){
+    SCOPE_St = SCOPE_IDLE;
+    SCOPE_Src[0] = &ADC_PMD_Sample[PFC_SLOT_IL];
+    SCOPE_Src[1] = &ADC_PMD_Sample[PFC_SLOT_VAC];
+    SCOPE_Src[2] = &ADC_PMD_Sample[PFC_SLOT_VBUS];
+    SCOPE_Src[3] = &PFC_Get_Status()->duty;
+}
+
+/* Any 16 bit value updated at the carrier rate: ADC_PMD_Sample[], PFC_Status fields */
+void SCOPE_Set_Channel(uint8_t ch, const volatile uint16_t * src){
+    if(ch < SCOPE_CHANNELS && src != 0){
+        SCOPE_Src[ch] = src;
+    }
+}
+
+/* Starts a new capture, refused while a dump is running or with a bad configuration */
+bool SCOPE_Arm(const SCOPE_Config * cfg){
+    if(SCOPE_St == SCOPE_SENDING || cfg->pre >= SCOPE_DEPTH || cfg->channel >= SCOPE_CHANNELS){
+        return false;
+    }
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    SCOPE_Cfg = *cfg;
+    SCOPE_Cfg.decim = (cfg->decim == 0) ? 1 : cfg->decim;
+    SCOPE_Head = 0;
+    SCOPE_Filled = 0;
+    SCOPE_Since = 0;
+    SCOPE_Skip = SCOPE_Cfg.decim - 1;               // First sample on the next carrier period
+    SCOPE_St = (cfg->pre == 0) ? SCOPE_ARMED : SCOPE_FILL;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+/* Trigger between samples: the next recorded sample is the trigger sample */
+static void SCOPE_Trigger_Async(void){
+    SCOPE_Post = SCOPE_DEPTH - SCOPE_Cfg.pre;
+    SCOPE_St = SCOPE_TRIGGERED;
+}
+
+static void SCOPE_Freeze(void){
+    SCOPE_St = SCOPE_FROZEN;
+}
+
+void SCOPE_Force(void){
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if(SCOPE_St == SCOPE_ARMED){
+        SCOPE_Trigger_Async();
+    }
+    __set_PRIMASK(primask);
+}
+
+/* Level crossing or step of the trigger channel, prev / v in the channel format */
+static bool SCOPE_Hit(int32_t v){
+    int32_t prev = SCOPE_Prev;
+    int32_t level = SCOPE_Cfg.level;
+    bool up, down;
+
+    SCOPE_Prev = v;
+    if(SCOPE_Cfg.mode == SCOPE_TRIG_LEVEL){
+        up = (prev < level && v >= level);
+        down = (prev > level && v <= level);
+    }
+    else if(SCOPE_Cfg.mode == SCOPE_TRIG_SLOPE){
+        up = (v - prev >= level);
+        down = (prev - v >= level);
+    }
+    else {
+        return false;
+    }
+    return ((SCOPE_Cfg.edge & SCOPE_RISING) && up) || ((SCOPE_Cfg.edge & SCOPE_FALLING) && down);
+}
+
+/*===================================================================
+    Current loop sample (INTPWM0, after PFC_Status is written): one
+    load and one store per channel into the circular buffer, the
+    trigger test only once the pre-trigger part is in. Never waits
+ ===================================================================*/
+void SCOPE_Sample(void){
+    uint16_t * slot;
+    int32_t v;
+
+    if(SCOPE_St < SCOPE_FILL || SCOPE_St > SCOPE_TRIGGERED){
+        return;
+    }
+    if(++SCOPE_Skip < SCOPE_Cfg.decim){
+        return;
+    }
+    SCOPE_Skip = 0;
+
+    slot = SCOPE_Buf[SCOPE_Head];
+    for(uint8_t ch = 0; ch < SCOPE_CHANNELS; ch++){
+        slot[ch] = *SCOPE_Src[ch];
+    }
+    SCOPE_Head = (SCOPE_Head + 1) & (SCOPE_DEPTH - 1);
+    if(SCOPE_Filled < SCOPE_DEPTH){
+        SCOPE_Filled++;
+    }
+
+    v = SCOPE_Cfg.sign ? (int32_t)(int16_t)slot[SCOPE_Cfg.channel] : (int32_t)slot[SCOPE_Cfg.channel];
+    switch(SCOPE_St){
+        case SCOPE_FILL:
+            SCOPE_Prev = v;
+            if(SCOPE_Filled >= SCOPE_Cfg.pre){
+                SCOPE_St = SCOPE_ARMED;
+            }
+            break;
+        case SCOPE_ARMED:
+            if(SCOPE_Hit(v)){
+                SCOPE_Since = 1;
+                SCOPE_Post = SCOPE_DEPTH - SCOPE_Cfg.pre - 1;
+                SCOPE_St = SCOPE_TRIGGERED;
+                if(SCOPE_Post == 0){
+                    SCOPE_Freeze();
+                }
+            }
+            break;
+        default:                                    // SCOPE_TRIGGERED
+            SCOPE_Since++;
+            if(--SCOPE_Post == 0){
+                SCOPE_Freeze();
+            }
+            break;
+    }
+}
+
+/* PLL crossing (PFC_Line_Edge), before the SCOPE_Sample() of the same period */
+void SCOPE_Line_Edge(bool rising){
+    if(SCOPE_St == SCOPE_ARMED && SCOPE_Cfg.mode == SCOPE_TRIG_ZC &&
+       (SCOPE_Cfg.edge & (rising ? SCOPE_RISING : SCOPE_FALLING))){
+        SCOPE_Trigger_Async();
+    }
+}
+
+/* EMG / OVV trip (PROT): the loop stops, a running capture freezes with the trip after its last sample */
+void SCOPE_Fault(void){
+    if(SCOPE_St < SCOPE_FILL || SCOPE_St > SCOPE_TRIGGERED){
+        return;
+    }
+    if(SCOPE_St != SCOPE_TRIGGERED || SCOPE_Since == 0){
+        SCOPE_Since = 1;
+    }
+    SCOPE_Freeze();
+}
+
+SCOPE_State SCOPE_Get_State(void){
+    return SCOPE_St;
+}
+
+/* Samples of the frozen capture */
+uint16_t SCOPE_Count(void){
+    return (SCOPE_St >= SCOPE_FROZEN) ? SCOPE_Filled : 0;
+}
+
+/* Position of the trigger sample in the frozen capture */
+uint16_t SCOPE_Trigger_Index(void){
+    return (SCOPE_St >= SCOPE_FROZEN) ? SCOPE_Filled - SCOPE_Since : 0;
+}
+
+/* Sample n of the frozen capture, oldest first */
+uint16_t SCOPE_Read(uint16_t n, uint8_t ch){
+    return SCOPE_Buf[(SCOPE_Head - SCOPE_Filled + n) & (SCOPE_DEPTH - 1)][ch];
+}
+
+/*===================================================================*
+                        Binary Dump
+*===================================================================*/
+static uint8_t SCOPE_Stream_Byte(uint32_t pos){
+    uint32_t data = (uint32_t)SCOPE_Filled * SCOPE_CHANNELS * 2;
+    uint16_t value;
+
+    if(pos < SCOPE_HEADER_SIZE){
+        switch(pos){
+            case 4:  return SCOPE_CHANNELS;
+            case 5:  return (uint8_t)SCOPE_Cfg.mode;
+            case 6:  return (uint8_t)SCOPE_Filled;
+            case 7:  return (uint8_t)(SCOPE_Filled >> 8);
+            case 8:  return (uint8_t)SCOPE_Trigger_Index();
+            case 9:  return (uint8_t)(SCOPE_Trigger_Index() >> 8);
+            case 10: return (uint8_t)SCOPE_Cfg.decim;
+            case 11: return (uint8_t)(SCOPE_Cfg.decim >> 8);
+            default: return (uint8_t)SCOPE_MAGIC[pos];
+        }
+    }
+    pos -= SCOPE_HEADER_SIZE;
+    if(pos < data){
+        value = SCOPE_Read((uint16_t)(pos / (SCOPE_CHANNELS * 2)), (uint8_t)((pos / 2) % SCOPE_CHANNELS));
+        return (pos & 0x01) ? (uint8_t)(value >> 8) : (uint8_t)value;
+    }
+    return (pos == data) ? SCOPE_Sum1 : SCOPE_Sum2;
+}
+
+/*===================================================================
+    Background dump of the frozen capture through the UART transmit
+    ring, as much as the ring takes per call (never waits). Returns
+    true once the whole block is queued, the state is SCOPE_IDLE then
+ ===================================================================*/
+bool SCOPE_Send(TSB_UART_TypeDef * UARTx){
+    char chunk[SCOPE_SEND_CHUNK];
+    uint32_t total, length;
+
+    if(SCOPE_St == SCOPE_FROZEN){
+        SCOPE_Pos = 0;
+        SCOPE_Sum1 = 0;
+        SCOPE_Sum2 = 0;
+        SCOPE_St = SCOPE_SENDING;
+    }
+    if(SCOPE_St != SCOPE_SENDING){
+        return false;
+    }
+    total = SCOPE_HEADER_SIZE + (uint32_t)SCOPE_Filled * SCOPE_CHANNELS * 2 + 2;
+
+    while(SCOPE_Pos < total){
+        length = total - SCOPE_Pos;
+        length = (length > SCOPE_SEND_CHUNK) ? SCOPE_SEND_CHUNK : length;
+        if(UART_TX_Free() < length){
+            return false;                           // Next call, once the ring drains
+        }
+        for(uint32_t k = 0; k < length; k++){
+            uint8_t b = SCOPE_Stream_Byte(SCOPE_Pos + k);
+
+            chunk[k] = (char)b;
+            if(SCOPE_Pos + k < total - 2){
+                SCOPE_Sum1 = (uint8_t)((SCOPE_Sum1 + b) % 255);
+                SCOPE_Sum2 = (uint8_t)((SCOPE_Sum2 + SCOPE_Sum1) % 255);
+            }
+        }
+        UART_TX_Queue(UARTx, chunk, (uint16_t)length);
+        SCOPE_Pos += length;
+    }
+    SCOPE_St = SCOPE_IDLE;
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ *******************************************************************************
+ * @file    DS_SCOPE.h
+ * @brief   Pre-trigger waveform capture of the current loop, binary UART dump
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __SCOPE_H__
+#define __SCOPE_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Capture Settings
+*===================================================================*/
+#define SCOPE_CHANNELS                          4           // Values stored per sample
+#define SCOPE_DEPTH                             512         // Samples, power of two (4 KB, 7.9 ms at 65 kHz)
+#define SCOPE_SEND_CHUNK                        64          // Bytes queued per UART_TX_Queue() call
+
+/* Dump block: header, count * SCOPE_CHANNELS samples (uint16), Fletcher-16, all little endian
+     'S' 'C' 'P' '1' | channels | mode | count (2) | trigger (2) | decim (2) | samples ... | sum1 | sum2 */
+#define SCOPE_MAGIC                             "SCP1"
+#define SCOPE_HEADER_SIZE                       12
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef enum
+{
+    SCOPE_TRIG_LEVEL = 0,           // Channel crosses the level
+    SCOPE_TRIG_SLOPE,               // Channel moves by level or more in one sample
+    SCOPE_TRIG_ZC,                  // Line zero crossing of the locked PLL
+    SCOPE_TRIG_FAULT                // EMG / OVV trip only (a trip freezes any capture)
+} SCOPE_Trigger;
+
+typedef enum
+{
+    SCOPE_RISING = 0x01,
+    SCOPE_FALLING = 0x02,
+    SCOPE_EITHER = 0x03
+} SCOPE_Edge;
+
+typedef enum
+{
+    SCOPE_IDLE = 0,                 // Not armed, or dump finished
+    SCOPE_FILL,                     // Recording the pre-trigger part, triggers ignored
+    SCOPE_ARMED,                    // Recording, waiting for the trigger
+    SCOPE_TRIGGERED,                // Recording the post-trigger part
+    SCOPE_FROZEN,                   // Capture complete, SCOPE_Read() / SCOPE_Send()
+    SCOPE_SENDING                   // Dump in progress
+} SCOPE_State;
+
+typedef struct
+{
+    SCOPE_Trigger mode;
+    SCOPE_Edge edge;
+    uint8_t channel;                // Level / slope source
+    bool sign;                      // Channel value is signed (Q15), else unsigned (codes, duty)
+    int32_t level;                  // Level, or step per recorded sample for SCOPE_TRIG_SLOPE
+    uint16_t pre;                   // Samples before the trigger sample (< SCOPE_DEPTH)
+    uint16_t decim;                 // Record one carrier period out of decim (1 = all)
+} SCOPE_Config;
+
+/*===================================================================*
+                  Functions declaration for SCOPE
+*===================================================================*/
+void SCOPE_Init(void);
+void SCOPE_Set_Channel(uint8_t ch, const volatile uint16_t * src);
+bool SCOPE_Arm(const SCOPE_Config * cfg);
+void SCOPE_Force(void);
+void SCOPE_Sample(void);
+void SCOPE_Line_Edge(bool rising);
+void SCOPE_Fault(void);
+SCOPE_State SCOPE_Get_State(void);
+uint16_t SCOPE_Count(void);
+uint16_t SCOPE_Trigger_Index(void);
+uint16_t SCOPE_Read(uint16_t n, uint8_t ch);
+bool SCOPE_Send(TSB_UART_TypeDef * UARTx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SCOPE_H__ */
@@ -0,0 +1,238 @@
+/**
+*******************************************************************************
+* @file    DS_TLM.c
+* @brief   Binary telemetry frames (COBS, CRC-16/CCITT-FALSE) over UART
+*          TOSHIBA 'TMPM4KNA' Group
+* @version V1.0.0.0
+* @date    2026-10-17
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "TMPM4KyA.h"
+#include "DS_TLM.h"
+#include "DS_CRC.h"
+#include "DS_UART.h"
+#include "DS_PFC.h"
+#include "DS_METER.h"
+#include "DS_HARM.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+
+static uint8_t TLM_Seq = 0;
+volatile uint32_t TLM_Frames = 0;                   // Frames queued, UART_TX_Dropped counts the refused ones
+
+/* Sequence and frame count restart */
+void TLM_Init(void){
+    TLM_Seq = 0;
+    TLM_Frames = 0;
+}
+
+/*===================================================================*
+                        Little Endian Packing
+*===================================================================*/
+uint8_t * TLM_Put_U16(uint8_t * p, uint16_t value){
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+uint8_t * TLM_Put_U32(uint8_t * p, uint32_t value){
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+uint16_t TLM_Get_U16(const uint8_t * p){
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+uint32_t TLM_Get_U32(const uint8_t * p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*===================================================================*
+                        Framing
+*===================================================================*/
+/* Consistent overhead byte stuffing: every 0x00 becomes the distance to the next one */
+static uint16_t TLM_Cobs_Encode(const uint8_t * in, uint16_t length, uint8_t * out){
+    uint16_t code_at = 0;
+    uint16_t o = 1;
+    uint8_t code = 1;
+
+    for(uint16_t k = 0; k < length; k++){
+        if(in[k] == 0){
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+        else {
+            out[o++] = in[k];
+            if(++code == 0xFF){                     // Full block, no zero implied after it
+                out[code_at] = code;
+                code_at = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+/*===================================================================
+    Frame of one message into frame[TLM_FRAME_MAX], delimiters
+    included. Returns the frame length (0 = body too long)
+        CRC-16/CCITT-FALSE over id, seq and body
+ ===================================================================*/
+uint16_t TLM_Encode(uint8_t id, uint8_t seq, const uint8_t * body, uint8_t length, uint8_t * frame){
+    uint8_t raw[TLM_HEADER_SIZE + TLM_MAX_BODY + TLM_CRC_SIZE];
+    uint16_t n;
+
+    if(length > TLM_MAX_BODY){
+        return 0;
+    }
+    raw[0] = id;
+    raw[1] = seq;
+    memcpy(&raw[TLM_HEADER_SIZE], body, length);
+    n = TLM_HEADER_SIZE + length;
+    TLM_Put_U16(&raw[n], CRC16_Calc(raw, n, CRC16_INIT));
+    n += TLM_CRC_SIZE;
+
+    frame[0] = TLM_DELIMITER;
+    n = 1 + TLM_Cobs_Encode(raw, n, &frame[1]);
+    frame[n++] = TLM_DELIMITER;
+    return n;
+}
+
+/*===================================================================
+    Bytes between two delimiters back to a message: COBS, length
+    and CRC checked, msg untouched beyond the body on an error
+ ===================================================================*/
+uint8_t TLM_Decode(const uint8_t * frame, uint16_t length, TLM_Message * msg){
+    uint8_t raw[TLM_HEADER_SIZE + TLM_MAX_BODY + TLM_CRC_SIZE];
+    uint16_t i = 0, o = 0;
+    uint8_t code;
+
+    while(i < length){
+        code = frame[i++];
+        if(code == 0 || i + code - 1 > length){
+            return TLM_ERR_COBS;
+        }
+        for(uint8_t k = 1; k < code; k++){
+            if(frame[i] == 0 || o >= sizeof(raw)){
+                return (frame[i] == 0) ? TLM_ERR_COBS : TLM_ERR_LENGTH;
+            }
+            raw[o++] = frame[i++];
+        }
+        if(code != 0xFF && i < length){
+            if(o >= sizeof(raw)){
+                return TLM_ERR_LENGTH;
+            }
+            raw[o++] = 0;
+        }
+    }
+    if(o < TLM_HEADER_SIZE + TLM_CRC_SIZE){
+        return TLM_ERR_LENGTH;
+    }
+    o -= TLM_CRC_SIZE;
+    if(CRC16_Calc(raw, o, CRC16_INIT) != TLM_Get_U16(&raw[o])){
+        return TLM_ERR_CRC;
+    }
+    msg->id = raw[0];
+    msg->seq = raw[1];
+    msg->length = (uint8_t)(o - TLM_HEADER_SIZE);
+    memcpy(msg->body, &raw[TLM_HEADER_SIZE], msg->length);
+    return TLM_OK;
+}
+
+/* Whole frame into the UART transmit ring or nothing (background only, as sendUART()) */
+bool TLM_Send(TSB_UART_TypeDef * UARTx, uint8_t id, const uint8_t * body, uint8_t length){
+    uint8_t frame[TLM_FRAME_MAX];
+    uint16_t n = TLM_Encode(id, TLM_Seq++, body, length, frame);
+
+    if(n == 0 || !UART_TX_Queue(UARTx, (const char *)frame, n)){
+        return false;
+    }
+    TLM_Frames++;
+    return true;
+}
+
+/*===================================================================*
+                        Messages
+*===================================================================*/
+/* 33 bytes: il iref vac vbus vl duty, count saturated, vbus_avg iamp vpk window, zc_state, zc_count */
+bool TLM_Send_Status(TSB_UART_TypeDef * UARTx){
+    const volatile PFC_Status * st = PFC_Get_Status();
+    uint8_t body[33];
+    uint8_t * p = body;
+
+    p = TLM_Put_U16(p, (uint16_t)st->il);
+    p = TLM_Put_U16(p, (uint16_t)st->iref);
+    p = TLM_Put_U16(p, (uint16_t)st->vac);
+    p = TLM_Put_U16(p, (uint16_t)st->vbus);
+    p = TLM_Put_U16(p, (uint16_t)st->vl);
+    p = TLM_Put_U16(p, st->duty);
+    p = TLM_Put_U32(p, st->count);
+    p = TLM_Put_U32(p, st->saturated);
+    p = TLM_Put_U16(p, (uint16_t)st->vbus_avg);
+    p = TLM_Put_U16(p, (uint16_t)st->iamp);
+    p = TLM_Put_U16(p, (uint16_t)st->vpk);
+    p = TLM_Put_U16(p, st->window);
+    *p++ = st->zc_state;
+    p = TLM_Put_U32(p, st->zc_count);
+    return TLM_Send(UARTx, TLM_ID_STATUS, body, (uint8_t)(p - body));
+}
+
+/* 40 bytes: vrms irms i1rms p s pf thd freq samples cycles, 32 bit each */
+bool TLM_Send_Meter(TSB_UART_TypeDef * UARTx){
+    const METER_Result * r = METER_Get();
+    uint8_t body[40];
+    uint8_t * p = body;
+
+    p = TLM_Put_U32(p, (uint32_t)r->vrms);
+    p = TLM_Put_U32(p, (uint32_t)r->irms);
+    p = TLM_Put_U32(p, (uint32_t)r->i1rms);
+    p = TLM_Put_U32(p, (uint32_t)r->p);
+    p = TLM_Put_U32(p, (uint32_t)r->s);
+    p = TLM_Put_U32(p, (uint32_t)r->pf);
+    p = TLM_Put_U32(p, (uint32_t)r->thd);
+    p = TLM_Put_U32(p, r->freq);
+    p = TLM_Put_U32(p, r->samples);
+    p = TLM_Put_U32(p, r->cycles);
+    return TLM_Send(UARTx, TLM_ID_METER, body, (uint8_t)(p - body));
+}
+
+/* 94 bytes: rms h1..h40 (16 bit, saturated), thd, over (64 bit), sweeps */
+bool TLM_Send_Harm(TSB_UART_TypeDef * UARTx){
+    const HARM_Result * r = HARM_Get();
+    uint8_t body[2 * HARM_MAX + 14];
+    uint8_t * p = body;
+
+    for(uint8_t h = 1; h <= HARM_MAX; h++){
+        p = TLM_Put_U16(p, (uint16_t)((r->rms[h] > 0xFFFF) ? 0xFFFF : r->rms[h]));
+    }
+    p = TLM_Put_U16(p, (uint16_t)((r->thd > 0xFFFF) ? 0xFFFF : r->thd));
+    p = TLM_Put_U32(p, (uint32_t)r->over);
+    p = TLM_Put_U32(p, (uint32_t)(r->over >> 32));
+    p = TLM_Put_U32(p, r->sweeps);
+    return TLM_Send(UARTx, TLM_ID_HARM, body, (uint8_t)(p - body));
+}
+
+/* Up to TLM_MAX_BODY / 2 samples */
+bool TLM_Send_Samples(TSB_UART_TypeDef * UARTx, const int16_t * samples, uint8_t count){
+    uint8_t body[TLM_MAX_BODY];
+    uint8_t * p = body;
+
+    if(count > TLM_MAX_BODY / 2){
+        return false;
+    }
+    for(uint8_t k = 0; k < count; k++){
+        p = TLM_Put_U16(p, (uint16_t)samples[k]);
+    }
+    return TLM_Send(UARTx, TLM_ID_SAMPLES, body, (uint8_t)(p - body));
+}
@@ -0,0 +1,81 @@
+/**
+ *******************************************************************************
+ * @file    DS_TLM.h
+ * @brief   Binary telemetry frames (COBS, CRC-16/CCITT-FALSE) over UART
+ *          TOSHIBA 'TMPM4KNA' Group
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __TLM_H__
+#define __TLM_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Frame Layout
+*===================================================================*/
+/* On the wire: 0x00 | COBS(id | seq | body | crc16) | 0x00, body and CRC little endian.
+   JSON text never holds 0x00, so both share the UART: bytes between two 0x00 are a frame */
+#define TLM_DELIMITER                           0x00
+#define TLM_MAX_BODY                            240         // Body bytes, keeps the COBS block under 254
+#define TLM_HEADER_SIZE                         2           // id, seq
+#define TLM_CRC_SIZE                            2
+#define TLM_FRAME_MAX                           (TLM_HEADER_SIZE + TLM_MAX_BODY + TLM_CRC_SIZE + 3)    // + COBS code, two delimiters
+
+/* Message IDs */
+#define TLM_ID_STATUS                           (uint8_t)(0x01)     // PFC_Status
+#define TLM_ID_METER                            (uint8_t)(0x02)     // METER_Result
+#define TLM_ID_HARM                             (uint8_t)(0x03)     // HARM_Result
+#define TLM_ID_SAMPLES                          (uint8_t)(0x10)     // int16 samples from the application
+
+/* TLM_Decode() result */
+#define TLM_OK                                  (uint8_t)(0x00)
+#define TLM_ERR_COBS                            (uint8_t)(0x01)     // Code byte past the end, or 0x00 inside
+#define TLM_ERR_LENGTH                          (uint8_t)(0x02)     // Shorter than id, seq and CRC, or body too long
+#define TLM_ERR_CRC                             (uint8_t)(0x03)
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef struct
+{
+    uint8_t id;
+    uint8_t seq;                    // Running frame count, a gap shows a dropped frame
+    uint8_t length;                 // Body bytes
+    uint8_t body[TLM_MAX_BODY];
+} TLM_Message;
+
+/*===================================================================*
+                  Functions declaration for TLM
+*===================================================================*/
+void TLM_Init(void);
+uint16_t TLM_Encode(uint8_t id, uint8_t seq, const uint8_t * body, uint8_t length, uint8_t * frame);
+uint8_t TLM_Decode(const uint8_t * frame, uint16_t length, TLM_Message * msg);
+bool TLM_Send(TSB_UART_TypeDef * UARTx, uint8_t id, const uint8_t * body, uint8_t length);
+bool TLM_Send_Status(TSB_UART_TypeDef * UARTx);
+bool TLM_Send_Meter(TSB_UART_TypeDef * UARTx);
+bool TLM_Send_Harm(TSB_UART_TypeDef * UARTx);
+bool TLM_Send_Samples(TSB_UART_TypeDef * UARTx, const int16_t * samples, uint8_t count);
+
+uint8_t * TLM_Put_U16(uint8_t * p, uint16_t value);
+uint8_t * TLM_Put_U32(uint8_t * p, uint32_t value);
+uint16_t TLM_Get_U16(const uint8_t * p);
+uint32_t TLM_Get_U32(const uint8_t * p);
+
+extern volatile uint32_t TLM_Frames;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __TLM_H__ */
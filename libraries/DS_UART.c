@@ -11,6 +11,7 @@
 */
 
 #include "DS_UART.h"
+#include "DS_DMA.h"
 #include "APMD.h"
 #include "TMPM4KyA.h"
 #include "jsmn.h"
@@ -25,6 +26,9 @@
 #define UART0_TX_Pin                "PC0"   				        // PC0, PC1, PN0 or PN1 or (None for disable)
 #define UART0_RX_Pin                "PC1"   				        // PC0, PC1, PN0 or PN1 or (None for disable)
 
+/*  Transmit path for UART0: UART_TX_INTERRUPT or UART_TX_DMA  */
+#define UART0_TX_MODE               UART_TX_INTERRUPT
+
 /* UART PORT 1 */
 #define UART1_TX_Pin                "None"   				        // PC4, PC5, PU5 or PU6 or (None for disable) 
 #define UART1_RX_Pin                "None"   				        // PC4, PC5, PU5 or PU6 or (None for disable)
@@ -43,15 +47,28 @@
 void UART_Init(TSB_UART_TypeDef * UARTx, uint32_t baudRate){
     if(UARTx == TSB_UART0){
         /* Set the Clock Supply */
-        UART_Set_ClkSupply(port);
+        UART_Set_ClkSupply(0);
         /* Set the Baud Rate */
         UART_Set_BaudRate(UARTx, baudRate);
 
-        CR1_INTTXWE_ENABLE(UARTx);                                  // Enable the interrupt for Transmission completion
+        CR1_RIL(UARTx, 0x01);                                       // Receive interrupt from the first byte in the FIFO
         CR1_INTRXWE_ENABLE(UARTx);                                  // Enable the interrupt for Receive completion
         CR1_INTERR_ENABLE(UARTx);                                   // Enable the interrupt for Error control
 
-        //CR1_DMATE_ENABLE(UARTx);
+        if(UART0_TX_MODE == UART_TX_DMA){
+            DMA_Init();
+            DMA_Set_Callback(DMA_CH_UART0_TX, UART_TX_DMA_Service);
+            CR1_DMATE_ENABLE(UARTx);                                // Transmit FIFO space raises the DMA request
+        }
+        else{
+            CR1_TIL(UARTx, 0x00);                                   // Interrupt once the transmit FIFO is empty
+            CR1_INTTXWE_ENABLE(UARTx);                              // Enable the interrupt for Transmission completion
+            NVIC_ClearPendingIRQ(INTSC0TX_IRQn);
+            NVIC_EnableIRQ(INTSC0TX_IRQn);
+        }
+
+        NVIC_ClearPendingIRQ(INTSC0RX_IRQn);
+        NVIC_EnableIRQ(INTSC0RX_IRQn);                              // Received bytes go to the frame ring
 
         TRANS_RXE_ENABLE(UARTx);                                    // Enable the Reception control
         TRANS_TXE_ENABLE(UARTx);                                    // Enable the Transmission control
@@ -96,8 +113,13 @@ void UART_send(TSB_UART_TypeDef * UARTx, char *msg, int bitpos){
     TRANS_TXE_ENABLE(UARTx);                                        // Enable the Transmission Control
 }
 
-void sendUART(TSB_UART_TypeDef * UARTx, char *message){
+/* False when UART0 has no room for the whole message (nothing queued, UART_TX_Dropped counts it),
+   the caller retries once UART_TX_Free() allows. The other ports block until the message is out */
+bool sendUART(TSB_UART_TypeDef * UARTx, char *message){
     int i;
+    if(UARTx == TSB_UART0){
+        return UART_TX_Queue(UARTx, message, (uint16_t)strnlen(message, bufferSize));
+    }
     for (i = 0; i <= bufferSize; i++){
         if(message[i] != NULL){
             UART_send(UARTx, message, i);
@@ -106,6 +128,7 @@ void sendUART(TSB_UART_TypeDef * UARTx, char *message){
             break;
         }
     }
+    return true;
 }
 
 /*void sendUART(TSB_UART_TypeDef * UARTx, char *message){
@@ -115,13 +138,238 @@ void sendUART(TSB_UART_TypeDef * UARTx, char *message){
     UART_send(UARTx, sendMSG, 0);                                   // Send the buffer to the UART_send function
 }*/
 
-void UART_receive(TSB_UART_TypeDef * UARTx, int rcvCharLength){
-    TRANS_RXE_DISABLE(UARTx);                                       // Disable the Reception Control
-    rcvBuffer[rcvCharLength] = (char)(getDR_reg(UARTx) & 0xFF);     // Move the data from the data receive register to the buffer
-    while( UARTx->SR & 0x80 ){}                                     // Wait for data receive to finish
-    SR_RXFF_CLEAR(UARTx);                                           // Clears the Receive FIFO flag back to 1st stage
-    SR_RXEND_CLEAR(UARTx);                                          // Clears the Reception completion flag
-    TRANS_RXE_ENABLE(UARTx);                                        // Enable the Reception Control 
+/*===================================================================*
+        Non-blocking transmit ring for UART0 (single producer)
+*===================================================================*/
+
+/* Main loop writes UART_TX_Head, INTSC0TX / the DMA completion writes UART_TX_Tail.
+   Both run free and wrap at 2^16, the ring index is taken with the size mask. */
+static char UART_TX_Ring[UART_TX_RING_SIZE];
+static volatile uint16_t UART_TX_Head = 0;
+static volatile uint16_t UART_TX_Tail = 0;
+static volatile uint16_t UART_TX_DMA_Length = 0;                    // Bytes owned by the running DMA cycle
+volatile uint32_t UART_TX_Dropped = 0;                              // Frames refused for lack of space
+
+uint16_t UART_TX_Free(void){
+    return (uint16_t)(UART_TX_RING_SIZE - (uint16_t)(UART_TX_Head - UART_TX_Tail));
+}
+
+bool UART_TX_Idle(void){
+    return (UART_TX_Head == UART_TX_Tail);
+}
+
+/* Copies the whole frame or nothing, then hands the drain to the interrupt side */
+bool UART_TX_Queue(TSB_UART_TypeDef * UARTx, const char *data, uint16_t length){
+    uint16_t head = UART_TX_Head;
+    uint16_t index = head & (UART_TX_RING_SIZE - 1);
+    uint16_t first = UART_TX_RING_SIZE - index;
+
+    (void)UARTx;
+    if(length == 0){
+        return true;
+    }
+    if(length > UART_TX_Free()){
+        UART_TX_Dropped++;
+        return false;
+    }
+    if(first > length){
+        first = length;
+    }
+    memcpy(&UART_TX_Ring[index], data, first);
+    memcpy(&UART_TX_Ring[0], data + first, length - first);
+
+    __DMB();                                                        // Data visible before the new head
+    UART_TX_Head = head + length;
+
+    /* The interrupt side is the only writer of DR, so starting it is just a pend */
+    if(UART0_TX_MODE == UART_TX_DMA){
+        DMA_Request_Service(DMA_CH_UART0_TX);
+    }
+    else{
+        NVIC_SetPendingIRQ(INTSC0TX_IRQn);
+    }
+    return true;
+}
+
+/* Tops up the transmit FIFO from the ring */
+void INTSC0TX_IRQHandler(void){
+    uint16_t tail = UART_TX_Tail;
+    uint16_t head = UART_TX_Head;
+    uint32_t level = (getSR_reg(TSB_UART0) & SR_TLVL_MASK) >> 8;
+
+    while(tail != head && level < UART_TX_FIFO_DEPTH){
+        TSB_UART0->DR = (uint8_t)UART_TX_Ring[tail & (UART_TX_RING_SIZE - 1)];
+        tail++;
+        level++;
+    }
+    UART_TX_Tail = tail;
+    SR_TXEND_CLEAR(TSB_UART0);                                      // Clears the Transmission completion flag
+}
+
+/* DMA completion or a service request from UART_TX_Queue: retire the last block, start the next contiguous one */
+void UART_TX_DMA_Service(void){
+    uint16_t tail, length, index;
+
+    if(DMA_Busy(DMA_CH_UART0_TX)){
+        return;
+    }
+    tail = UART_TX_Tail + UART_TX_DMA_Length;
+    UART_TX_Tail = tail;
+    UART_TX_DMA_Length = 0;
+
+    length = (uint16_t)(UART_TX_Head - tail);
+    if(length == 0){
+        return;
+    }
+    index = tail & (UART_TX_RING_SIZE - 1);
+    if(length > UART_TX_RING_SIZE - index){
+        length = UART_TX_RING_SIZE - index;                         // Up to the end of the ring, the rest comes next
+    }
+    if(length > DMA_MAX_TRANSFERS){
+        length = DMA_MAX_TRANSFERS;
+    }
+    UART_TX_DMA_Length = length;
+    DMA_Basic_Start(DMA_CH_UART0_TX, &UART_TX_Ring[index], &TSB_UART0->DR, length,
+                    DMACTRL_SRC_SIZE(DMA_BYTE) | DMACTRL_SRC_INC(DMA_BYTE) |
+                    DMACTRL_DST_SIZE(DMA_BYTE) | DMACTRL_DST_INC(DMA_NO_INC));
+}
+
+/*===================================================================*
+        Receive frame ring for UART0 (single producer, single consumer)
+*===================================================================*/
+
+/* INTSC0RX fills slot UART_RX_Head and writes UART_RX_Head, the background reads complete
+   slots and writes UART_RX_Tail. Both run free and wrap at 2^8, the slot is taken with the mask.
+   A slot is handed over whole, so the background reads it in place until it is released. */
+static char UART_RX_Slot[UART_RX_FRAME_SLOTS][UART_RX_FRAME_MAX];
+static volatile uint16_t UART_RX_Length[UART_RX_FRAME_SLOTS];
+static volatile uint8_t UART_RX_Type[UART_RX_FRAME_SLOTS];
+static volatile uint8_t UART_RX_Head = 0;
+static volatile uint8_t UART_RX_Tail = 0;
+volatile uint32_t UART_RX_Overrun = 0;                              // Frames lost: no free slot, too long, or FIFO overrun
+
+/* Interrupt side only */
+static uint16_t UART_RX_Fill = 0;                                   // Bytes of the frame being received
+static bool UART_RX_Binary = false;                                 // Opening 0x00 seen, '\n' is data
+static bool UART_RX_Discard = false;                                // Frame lost, skip to the next delimiter
+
+static void (*UART_RX_Binary_Handler)(const uint8_t *data, uint16_t length) = 0;
+
+static void UART_RX_Commit(uint8_t type){
+    uint8_t slot = UART_RX_Head & (UART_RX_FRAME_SLOTS - 1);
+
+    UART_RX_Length[slot] = UART_RX_Fill;
+    UART_RX_Type[slot] = type;
+    __DMB();                                                        // Slot and length visible before the new head
+    UART_RX_Head++;                                                 // Publishes the slot
+}
+
+/*===================================================================
+    One received byte: '\n' closes a text frame, 0x00 opens and
+    closes a COBS frame (0x00 | COBS | 0x00, as TLM_Encode()).
+    Empty frames are skipped, a lost frame is counted once. Only a
+    0x00 between frames opens binary mode: the delimiter that ends
+    a lost frame goes back to text whatever the frame was
+ ===================================================================*/
+static void UART_RX_Byte(char c){
+    bool full = ((uint8_t)(UART_RX_Head - UART_RX_Tail) >= UART_RX_FRAME_SLOTS);
+
+    if(c == UART_RX_COBS_DELIMITER || (c == UART_RX_TEXT_DELIMITER && !UART_RX_Binary)){
+        if(UART_RX_Discard){
+            UART_RX_Discard = false;                                // Closing delimiter of the lost frame
+            UART_RX_Binary = false;
+        }
+        else if(UART_RX_Fill != 0){
+            UART_RX_Commit((c == UART_RX_COBS_DELIMITER) ? UART_FRAME_COBS : UART_FRAME_TEXT);
+            UART_RX_Binary = false;
+        }
+        else if(c == UART_RX_COBS_DELIMITER){
+            UART_RX_Binary = true;                                  // Opening delimiter
+        }
+        UART_RX_Fill = 0;
+        return;
+    }
+    if(UART_RX_Discard){
+        return;
+    }
+    if(full || UART_RX_Fill >= UART_RX_FRAME_MAX){
+        UART_RX_Overrun++;
+        UART_RX_Discard = true;
+        return;
+    }
+    UART_RX_Slot[UART_RX_Head & (UART_RX_FRAME_SLOTS - 1)][UART_RX_Fill++] = c;
+}
+
+/*===================================================================
+    Receive FIFO into the frame ring, nothing else. Takes at most the
+    level read on entry, later bytes raise the interrupt again. The
+    FIFO holds UART_RX_FIFO_DEPTH bytes, so the control loop ISRs can
+    hold this one off for that many character times without a loss
+ ===================================================================*/
+void INTSC0RX_IRQHandler(void){
+    uint8_t level = getRLVL_reg(TSB_UART0);
+
+    if(getOVRERR_reg(TSB_UART0)){
+        UART_RX_Overrun++;
+        UART_RX_Discard = true;                                     // Frame has a hole, skip to the next delimiter
+        ERR_OVRERR_CLEAR(TSB_UART0);
+    }
+    while(level-- != 0){
+        UART_RX_Byte((char)(getDR_reg(TSB_UART0) & 0xFF));
+    }
+    SR_RXEND_CLEAR(TSB_UART0);                                      // Clears the Reception completion flag
+}
+
+/* Oldest complete frame, read in place (no copy) until UART_RX_Release() */
+bool UART_RX_Get(UART_RX_Frame *frame){
+    uint8_t tail = UART_RX_Tail;
+    uint8_t slot = tail & (UART_RX_FRAME_SLOTS - 1);
+
+    if(tail == UART_RX_Head){
+        return false;
+    }
+    frame->data = UART_RX_Slot[slot];
+    frame->length = UART_RX_Length[slot];
+    frame->type = UART_RX_Type[slot];
+    return true;
+}
+
+/* Gives the slot of the frame from UART_RX_Get() back to INTSC0RX */
+void UART_RX_Release(void){
+    if(UART_RX_Tail != UART_RX_Head){
+        UART_RX_Tail++;
+    }
+}
+
+/* Consumer of the COBS frames in UART_RX_Process(), the bytes between the delimiters (TLM_Decode()) */
+void UART_RX_Set_Binary_Handler(void (*handler)(const uint8_t *data, uint16_t length)){
+    UART_RX_Binary_Handler = handler;
+}
+
+/*===================================================================
+    Background command decoding: text frames through the streaming
+    JSON decoder, COBS frames to the binary handler, straight from
+    the slot. Returns the number of frames handled
+ ===================================================================*/
+uint8_t UART_RX_Process(void){
+    UART_RX_Frame frame;
+    uint8_t count = 0;
+
+    while(UART_RX_Get(&frame)){
+        if(frame.type == UART_FRAME_TEXT){
+            JSON_Stream_Reset();                                    // Nothing of an earlier cut line carries over
+            for(uint16_t k = 0; k < frame.length; k++){
+                JSON_Stream_Feed(frame.data[k]);
+            }
+            JSON_Stream_End();
+        }
+        else if(UART_RX_Binary_Handler != 0){
+            UART_RX_Binary_Handler((const uint8_t *)frame.data, frame.length);
+        }
+        UART_RX_Release();
+        count++;
+    }
+    return count;
 }
 
 void UART_Set_ClkSupply(uint8_t port){
@@ -411,37 +659,458 @@ uint32_t getERR_reg(TSB_UART_TypeDef * UARTx){
 /*********************** JSON PARSE ***************************/
 
 jsmn_parser p;
-jsmntok_t t[bufferSize];
-char JSON_STRING[bufferSize];
+jsmntok_t t[JSON_MAX_TOKENS];
 char JSON_STR_BUF[jsonBufferSize];
-static int jsoneq(const char *json, jsmntok_t *tok, const char *s);
+
+static const char * JSON_Frame = 0;                                 // Frame the token table refers to
+static int JSON_Tokens = 0;
 
 void json_parse_init(void){
     jsmn_init(&p);
 }
 
-static int jsoneq(const char *json, jsmntok_t *tok, const char *s) {
-  if (tok->type == JSMN_STRING && (int)strlen(s) == tok->end - tok->start &&
-      strncmp(json + tok->start, s, tok->end - tok->start) == 0) {
-    return 0;
-  }
-  return -1;
+/* Token text equals the NUL terminated key, without strlen */
+static bool json_key_eq(const char *json, const jsmntok_t *tok, const char *key){
+    int i, n = tok->end - tok->start;
+    for(i = 0; i < n; i++){
+        if(key[i] != json[tok->start + i]){
+            return false;                                           // Also stops at the key terminator
+        }
+    }
+    return (key[n] == '\0');
 }
 
-char* read_json_parse(char *jsonBuf, char *strings){
-    int r, i; 
+/* Decimal text or true / false to int32, false on any other text or a value out of range */
+static bool json_to_int(const char *s, int n, int32_t *value){
+    int i = 0;
+    bool neg = false;
+    uint32_t v = 0, limit;
+
+    if(n == 4 && memcmp(s, "true", 4) == 0){
+        *value = 1;
+        return true;
+    }
+    if(n == 5 && memcmp(s, "false", 5) == 0){
+        *value = 0;
+        return true;
+    }
+    if(i < n && (s[i] == '-' || s[i] == '+')){
+        neg = (s[i] == '-');
+        i++;
+    }
+    if(i == n){
+        return false;
+    }
+    limit = neg ? 2147483648UL : 2147483647UL;
+    for(; i < n; i++){
+        uint32_t digit = (uint32_t)(s[i] - '0');
+        if(s[i] < '0' || s[i] > '9'){
+            return false;
+        }
+        if(v > (limit - digit) / 10){
+            return false;                                           // Beyond int32
+        }
+        v = v * 10 + digit;
+    }
+    *value = neg ? (int32_t)(0U - v) : (int32_t)v;
+    return true;
+}
+
+/* Decimal text to a signed fixed-point value with frac fraction bits (e.g. "-0.25" -> -0x4000 for Q16) */
+static bool json_to_fixed(const char *s, int n, uint8_t frac, int32_t *value){
+    int i = 0;
+    bool neg = false;
+    int64_t ip = 0, fp = 0, div = 1;
+
+    if(i < n && (s[i] == '-' || s[i] == '+')){
+        neg = (s[i] == '-');
+        i++;
+    }
+    if(i == n){
+        return false;
+    }
+    for(; i < n && s[i] != '.'; i++){
+        if(s[i] < '0' || s[i] > '9'){
+            return false;
+        }
+        ip = ip * 10 + (s[i] - '0');
+    }
+    if(i < n){
+        for(i++; i < n; i++){
+            if(s[i] < '0' || s[i] > '9'){
+                return false;
+            }
+            if(div < 1000000000LL){                                 // Digits past 1e-9 are below any useful Q format
+                fp = fp * 10 + (s[i] - '0');
+                div *= 10;
+            }
+        }
+    }
+    ip = (ip << frac) + (((fp << frac) + div / 2) / div);
+    *value = (int32_t)(neg ? -ip : ip);
+    return true;
+}
+
+/*===================================================================
+    Tokenize a received frame once, in place (the frame must stay
+    untouched while its fields are read)
+ ===================================================================*/
+int JSON_Frame_Parse(const char *frame, uint16_t length){
     json_parse_init();
-    memset(JSON_STR_BUF, 0, bufferSize);
-    strncpy(JSON_STRING, jsonBuf, bufferSize);
-    r = jsmn_parse(&p, JSON_STRING, strlen(JSON_STRING), t,
-                 sizeof(t) / sizeof(t[0]));
-    for(i = 1; i < r; i++){
-        if (jsoneq(JSON_STRING, &t[i], strings) == 0) {
-			sprintf(JSON_STR_BUF, "%.*s\n", t[i + 1].end - t[i + 1].start, JSON_STRING + t[i + 1].start);
-			//sendUART(TSB_UART0, JSON_STR_BUF);
-		}
+    JSON_Frame = frame;
+    JSON_Tokens = jsmn_parse(&p, frame, length, t, sizeof(t) / sizeof(t[0]));
+    return JSON_Tokens;
+}
+
+/*===================================================================
+    Fill every requested field in one pass over the token table,
+    returns the number of fields found. Only the keys of the outer
+    object count: a nested object or array value is skipped whole,
+    its tokens all start before the value token ends
+ ===================================================================*/
+uint8_t JSON_Frame_Get(JSON_Field *fields, uint8_t count){
+    int i = 1;
+    uint8_t k, found = 0;
+
+    for(k = 0; k < count; k++){
+        fields[k].found = false;
+    }
+    if(JSON_Tokens < 1 || t[0].type != JSMN_OBJECT){
+        return 0;
+    }
+    while(i + 1 < JSON_Tokens && found < count){
+        const jsmntok_t *key = &t[i];
+        const jsmntok_t *val = &t[i + 1];
+        const char *v = JSON_Frame + val->start;
+        int n = val->end - val->start;
+
+        for(i += 2; i < JSON_Tokens && t[i].start < val->end; i++){
+            // Tokens inside the value, on to the next key of the outer object
+        }
+        if(key->type != JSMN_STRING || key->size != 1){
+            continue;                                               // Not an object key
+        }
+        for(k = 0; k < count; k++){
+            if(fields[k].found || !json_key_eq(JSON_Frame, key, fields[k].key)){
+                continue;
+            }
+            switch(fields[k].type){
+                case JSON_INT:
+                    fields[k].found = json_to_int(v, n, &fields[k].value.i);
+                    break;
+                case JSON_FIXED:
+                    fields[k].found = json_to_fixed(v, n, fields[k].frac, &fields[k].value.i);
+                    break;
+                case JSON_STR:
+                    fields[k].value.s.ptr = v;
+                    fields[k].value.s.len = (uint16_t)n;
+                    fields[k].found = true;
+                    break;
+                default:
+                    break;
+            }
+            if(fields[k].found){
+                found++;
+            }
+            break;
+        }
+    }
+    return found;
+}
+
+/*===================================================================
+    Kept for the existing callers: one key, value copied out as text
+    with a '\n'. An empty string when the key is missing, 0 when the
+    frame does not tokenize (JSON_MAX_TOKENS included) or the value
+    does not fit JSON_STR_BUF: nothing is returned cut short
+ ===================================================================*/
+char* read_json_parse(char *jsonBuf, char *strings){
+    JSON_Field field = { strings, JSON_STR, 0, false, { 0 } };
+    uint16_t n = 0;
+
+    while(n < bufferSize && jsonBuf[n] != '\0'){
+        n++;
+    }
+    JSON_STR_BUF[0] = '\0';
+    if(JSON_Frame_Parse(jsonBuf, n) < 0){
+        return 0;
+    }
+    if(JSON_Frame_Get(&field, 1) == 1){
+        if(field.value.s.len > jsonBufferSize - 2){
+            return 0;
+        }
+        memcpy(JSON_STR_BUF, field.value.s.ptr, field.value.s.len);
+        JSON_STR_BUF[field.value.s.len] = '\n';
+        JSON_STR_BUF[field.value.s.len + 1] = '\0';
     }
     return JSON_STR_BUF;
 }
 
+/*===================================================================*
+    Streaming JSON decoder: one byte at a time from UART_RX_Process(), events
+    for every key of the outermost object whose value completes (nested
+    objects and arrays are skipped as in JSON_Frame_Get()), no frame buffer
+*===================================================================*/
+
+static struct
+{
+    const JSON_Handler *table;
+    uint8_t count;
+    void (*onFrame)(void);                                          // Outermost object closed
+    char stack[JSON_STREAM_DEPTH];                                  // '{' or '[' per open level
+    uint8_t depth;
+    bool inString, inPrimitive, escape, isKey, haveKey, keyOver, valOver;
+    uint8_t keyLen, valLen;
+    uint8_t hex;                                                    // \uXXXX digits still to come
+    uint16_t code;
+    char key[JSON_KEY_MAX];
+    char val[JSON_VALUE_MAX];
+} JSON_Stream;
+
+volatile uint32_t JSON_Stream_Errors = 0;
+
+void JSON_Stream_Init(const JSON_Handler *table, uint8_t count, void (*onFrame)(void)){
+    memset(&JSON_Stream, 0, sizeof(JSON_Stream));
+    JSON_Stream.table = table;
+    JSON_Stream.count = count;
+    JSON_Stream.onFrame = onFrame;
+}
+
+void JSON_Stream_Reset(void){
+    JSON_Stream.depth = 0;
+    JSON_Stream.inString = false;
+    JSON_Stream.inPrimitive = false;
+    JSON_Stream.escape = false;
+    JSON_Stream.hex = 0;
+    JSON_Stream.haveKey = false;
+}
+
+static void json_stream_error(void){
+    JSON_Stream_Errors++;
+    JSON_Stream_Reset();                                            // Resynchronise on the next '{'
+}
+
+/* Frame delimiter: an object still open there was cut, its last value is dropped */
+void JSON_Stream_End(void){
+    if(JSON_Stream.depth != 0){
+        json_stream_error();
+    }
+}
+
+static void json_stream_emit(bool isString){
+    uint8_t k;
+    JSON_Field field;
+
+    if(JSON_Stream.depth != 1 || !JSON_Stream.haveKey || JSON_Stream.keyOver || JSON_Stream.valOver){
+        return;
+    }
+    for(k = 0; k < JSON_Stream.count; k++){
+        const JSON_Handler *h = &JSON_Stream.table[k];
+        uint8_t i;
+        for(i = 0; i < JSON_Stream.keyLen && h->key[i] == JSON_Stream.key[i]; i++){}
+        if(i != JSON_Stream.keyLen || h->key[i] != '\0'){
+            continue;
+        }
+        field.key = h->key;
+        field.type = h->type;
+        field.frac = h->frac;
+        switch(h->type){
+            case JSON_INT:
+                field.found = !isString && json_to_int(JSON_Stream.val, JSON_Stream.valLen, &field.value.i);
+                break;
+            case JSON_FIXED:
+                field.found = !isString && json_to_fixed(JSON_Stream.val, JSON_Stream.valLen, h->frac, &field.value.i);
+                break;
+            default:
+                field.value.s.ptr = JSON_Stream.val;                // Valid only during the handler call
+                field.value.s.len = JSON_Stream.valLen;
+                field.found = true;
+                break;
+        }
+        if(field.found && h->handler != 0){
+            h->handler(&field);
+        }
+        return;
+    }
+}
+
+static void json_stream_append(char c){
+    if(JSON_Stream.isKey){
+        if(JSON_Stream.keyLen < JSON_KEY_MAX){
+            JSON_Stream.key[JSON_Stream.keyLen++] = c;
+        }
+        else{
+            JSON_Stream.keyOver = true;
+        }
+    }
+    else{
+        if(JSON_Stream.valLen < JSON_VALUE_MAX){
+            JSON_Stream.val[JSON_Stream.valLen++] = c;
+        }
+        else{
+            JSON_Stream.valOver = true;
+        }
+    }
+}
+
+/* Character after a '\' in a string, false when JSON has no such escape */
+static bool json_stream_escape(char c){
+    switch(c){
+        case '"': case '\\': case '/':
+            json_stream_append(c);
+            break;
+        case 'b':
+            json_stream_append('\b');
+            break;
+        case 'f':
+            json_stream_append('\f');
+            break;
+        case 'n':
+            json_stream_append('\n');
+            break;
+        case 'r':
+            json_stream_append('\r');
+            break;
+        case 't':
+            json_stream_append('\t');
+            break;
+        case 'u':
+            JSON_Stream.hex = 4;
+            JSON_Stream.code = 0;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/* One digit of a \uXXXX escape, the code point is kept when it is ASCII and read as '?' otherwise */
+static bool json_stream_hex(char c){
+    uint8_t digit;
+
+    if(c >= '0' && c <= '9'){
+        digit = (uint8_t)(c - '0');
+    }
+    else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f'){
+        digit = (uint8_t)((c | 0x20) - 'a' + 10);
+    }
+    else{
+        return false;
+    }
+    JSON_Stream.code = (uint16_t)((JSON_Stream.code << 4) | digit);
+    if(--JSON_Stream.hex == 0){
+        json_stream_append((JSON_Stream.code < 0x80) ? (char)JSON_Stream.code : '?');
+    }
+    return true;
+}
+
+void JSON_Stream_Feed(char c){
+    char top;
+
+    if(JSON_Stream.inString){
+        if(JSON_Stream.hex != 0){
+            if(!json_stream_hex(c)){
+                json_stream_error();
+            }
+        }
+        else if(JSON_Stream.escape){
+            JSON_Stream.escape = false;
+            if(!json_stream_escape(c)){
+                json_stream_error();
+            }
+        }
+        else if(c == '\\'){
+            JSON_Stream.escape = true;
+        }
+        else if(c == '"'){
+            JSON_Stream.inString = false;
+            if(JSON_Stream.isKey){
+                JSON_Stream.haveKey = true;
+                JSON_Stream.isKey = false;
+            }
+            else{
+                json_stream_emit(true);
+            }
+        }
+        else{
+            json_stream_append(c);
+        }
+        return;
+    }
+    if(JSON_Stream.inPrimitive){
+        if((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E'){
+            json_stream_append(c);
+            return;
+        }
+        JSON_Stream.inPrimitive = false;
+        json_stream_emit(false);                                    // c still closes or separates below
+    }
+    if(JSON_Stream.depth == 0 && c != '{'){
+        return;                                                     // Line noise between frames
+    }
+
+    top = (JSON_Stream.depth > 0) ? JSON_Stream.stack[JSON_Stream.depth - 1] : 0;
+    switch(c){
+        case ' ': case '\t': case '\r': case '\n':
+            break;
+        case '{':
+        case '[':
+            if(JSON_Stream.depth == JSON_STREAM_DEPTH){
+                json_stream_error();
+                break;
+            }
+            JSON_Stream.stack[JSON_Stream.depth++] = c;
+            if(c == '{'){
+                JSON_Stream.haveKey = false;
+            }
+            break;                                                  // Values inside arrays are not emitted (depth > 1)
+        case '}':
+        case ']':
+            if(top != ((c == '}') ? '{' : '[')){
+                json_stream_error();
+                break;
+            }
+            JSON_Stream.depth--;
+            JSON_Stream.haveKey = false;
+            if(JSON_Stream.depth == 0 && JSON_Stream.onFrame != 0){
+                JSON_Stream.onFrame();
+            }
+            break;
+        case ':':
+            if(top != '{' || !JSON_Stream.haveKey){
+                json_stream_error();
+            }
+            break;
+        case ',':
+            if(top == '{'){
+                JSON_Stream.haveKey = false;
+            }
+            break;
+        case '"':
+            JSON_Stream.inString = true;
+            JSON_Stream.isKey = (top == '{' && !JSON_Stream.haveKey);
+            if(JSON_Stream.isKey){
+                JSON_Stream.keyLen = 0;
+                JSON_Stream.keyOver = false;
+            }
+            else{
+                JSON_Stream.valLen = 0;
+                JSON_Stream.valOver = false;
+            }
+            break;
+        default:
+            if((c >= '0' && c <= '9') || c == '-' || c == 't' || c == 'f' || c == 'n'){
+                JSON_Stream.inPrimitive = true;
+                JSON_Stream.isKey = false;
+                JSON_Stream.valLen = 0;
+                JSON_Stream.valOver = false;
+                json_stream_append(c);
+            }
+            else{
+                json_stream_error();
+            }
+            break;
+    }
+}
+
 /********************** END OF JSON PARSE **************************/
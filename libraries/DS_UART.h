@@ -21,7 +21,28 @@ extern "C" {
 #endif
 
 #define bufferSize                              700
-#define jsonBufferSize                          700
+#define jsonBufferSize                          bufferSize  // Value text returned by read_json_parse(), any value of a frame fits
+
+#define JSON_MAX_TOKENS                         32          // Token table of JSON_Frame_Parse(), 15 pairs (JSMN_ERROR_NOMEM beyond)
+#define JSON_STREAM_DEPTH                       8           // Nesting levels of the streaming decoder
+#define JSON_KEY_MAX                            24          // Longest key matched by the streaming decoder
+#define JSON_VALUE_MAX                          48          // Longest value text of the streaming decoder
+
+#define UART_TX_RING_SIZE                       1024        // Power of two, holds more than one telemetry frame
+#define UART_TX_FIFO_DEPTH                      8           // Transmit FIFO stages
+#define UART_RX_FIFO_DEPTH                      8           // Receive FIFO stages
+#define UART_RX_FRAME_SLOTS                     4           // Power of two, frames waiting for UART_RX_Process()
+#define UART_RX_FRAME_MAX                       256         // Bytes per frame without delimiters, holds a TLM frame
+
+/* Receive frame delimiters and UART_RX_Frame types */
+#define UART_RX_TEXT_DELIMITER                  '\n'
+#define UART_RX_COBS_DELIMITER                  0x00        // As TLM_DELIMITER
+#define UART_FRAME_TEXT                         (uint8_t)(0x00)     // JSON command line
+#define UART_FRAME_COBS                         (uint8_t)(0x01)     // COBS bytes between two 0x00
+
+/* Transmit path drain options */
+#define UART_TX_INTERRUPT                       0x00        // INTSC0TX refills the FIFO
+#define UART_TX_DMA                             0x01        // DMAC unit A feeds DR on the UART transmit request
 
 /*===================================================================*
                         Masks for Registers
@@ -77,6 +98,7 @@ extern "C" {
 #define DR_DR_MASK                              (uint32_t)(0x1FFUL)
 
 /* Status Register Mask */
+#define SR_TLVL_MASK                            (uint32_t)(0x0FUL << 8)
 #define SR_RXFF_MASK                            (uint32_t)(0x01UL << 5)
 #define SR_RXEND_MASK                           (uint32_t)(0x01UL << 6)
 #define SR_TXFF_MASK                            (uint32_t)(0x01UL << 13)
@@ -173,9 +195,9 @@ extern "C" {
 #define CR1_INTTXFE_DISABLE(obj)                ((obj)->CR1 = (uint32_t)(((obj)->CR1 & ~CR1_INTTXFE_MASK) | (0x00UL << 7)))
 #define CR1_INTTXFE_ENABLE(obj)                 ((obj)->CR1 = (uint32_t)(((obj)->CR1 & ~CR1_INTTXFE_MASK) | (0x01UL << 7)))
 
-#define CR1_RIL(obj, param)                     ((obj)->CR1 = (uint32_t)(param))
+#define CR1_RIL(obj, param)                     ((obj)->CR1 = (uint32_t)(((obj)->CR1 & ~CR1_RIL_MASK) | ((param) << 8)))
 
-#define CR1_TIL(obj, param)                     ((obj)->CR1 = (uint32_t)(param))
+#define CR1_TIL(obj, param)                     ((obj)->CR1 = (uint32_t)(((obj)->CR1 & ~CR1_TIL_MASK) | ((param) << 12)))
 
 /* Clock Control Register */
 #define CLK_PRSEL_1_1(obj)                      ((obj)->CLK = (uint32_t)(((obj)->CLK & ~CLK_PRSEL_MASK) | (0x00UL << 4)))
@@ -231,6 +253,50 @@ extern "C" {
 #define ERR_OVRERR_CLEAR(obj)                   ((obj)->ERR = (uint32_t)(((obj)->ERR & ~ERR_OVRERR_MASK) | (0x01UL << 3)))
 #define ERR_TRGERR_CLEAR(obj)                   ((obj)->ERR = (uint32_t)(((obj)->ERR & ~ERR_TRGERR_MASK) | (0x01UL << 4)))
 
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef enum
+{
+    JSON_INT,                                   // Integer (true / false read as 1 / 0)
+    JSON_FIXED,                                 // Decimal read as fixed-point with frac fraction bits
+    JSON_STR                                    // Slice of the received frame, not NUL terminated
+} JSON_Field_Type;
+
+typedef struct
+{
+    const char *key;                            // Key to look for
+    JSON_Field_Type type;
+    uint8_t frac;                               // Fraction bits for JSON_FIXED (15 -> Q15, 16 -> Q16)
+    bool found;                                 // Set by JSON_Frame_Get()
+    union
+    {
+        int32_t i;                              // JSON_INT and JSON_FIXED
+        struct
+        {
+            const char *ptr;
+            uint16_t len;
+        } s;                                    // JSON_STR
+    } value;
+} JSON_Field;
+
+/* Received frame, data points into the ring slot until UART_RX_Release() */
+typedef struct
+{
+    const char *data;
+    uint16_t length;                            // Delimiters not included
+    uint8_t type;                               // UART_FRAME_TEXT or UART_FRAME_COBS
+} UART_RX_Frame;
+
+/* Streaming decoder handler, runs in UART_RX_Process() when the value of key completes */
+typedef struct
+{
+    const char *key;
+    JSON_Field_Type type;
+    uint8_t frac;
+    void (*handler)(const JSON_Field *field);
+} JSON_Handler;
+
 /*===================================================================*
                   Functions declaration for UARTx
 *===================================================================*/
@@ -239,7 +305,6 @@ void UART_Software_Reset(TSB_UART_TypeDef * UARTx);
 void UART_Set_BaudRate(TSB_UART_TypeDef * UARTx, uint32_t baudRate);
 void UART_send(TSB_UART_TypeDef * UARTx, char *msg, int buffer);
 void sendUART_TEST(TSB_UART_TypeDef * UARTx, char *message);
-void UART_receive(TSB_UART_TypeDef * UARTx, int rcvCharLength);
 void UART_Set_ClkSupply(uint8_t port);
 
 uint8_t getRLVL_reg(TSB_UART_TypeDef * UARTx);
@@ -256,11 +321,30 @@ uint32_t getFIFOCLR_reg(TSB_UART_TypeDef * UARTx);
 uint32_t getERR_reg(TSB_UART_TypeDef * UARTx);
 
 extern char sendMSG[bufferSize];
-extern char rcvBuffer[bufferSize];
-void sendUART(TSB_UART_TypeDef * UARTx, char *message);
+bool sendUART(TSB_UART_TypeDef * UARTx, char *message);
+
+bool UART_TX_Queue(TSB_UART_TypeDef * UARTx, const char *data, uint16_t length);
+uint16_t UART_TX_Free(void);
+bool UART_TX_Idle(void);
+void UART_TX_DMA_Service(void);
+extern volatile uint32_t UART_TX_Dropped;
+
+bool UART_RX_Get(UART_RX_Frame *frame);
+void UART_RX_Release(void);
+uint8_t UART_RX_Process(void);
+void UART_RX_Set_Binary_Handler(void (*handler)(const uint8_t *data, uint16_t length));
+extern volatile uint32_t UART_RX_Overrun;
 
 void json_parse_init(void);
 char* read_json_parse(char *jsonBuf, char *strings);
+int JSON_Frame_Parse(const char *frame, uint16_t length);
+uint8_t JSON_Frame_Get(JSON_Field *fields, uint8_t count);
+
+void JSON_Stream_Init(const JSON_Handler *table, uint8_t count, void (*onFrame)(void));
+void JSON_Stream_Reset(void);
+void JSON_Stream_Feed(char c);
+void JSON_Stream_End(void);
+extern volatile uint32_t JSON_Stream_Errors;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,825 @@
+/**
+*******************************************************************************
+* @file    DS_SIM.c
+* @brief   Host register model and Totem-Pole PFC plant simulator
+*          The peripheral window is RAM at PERI_BASE, the firmware drivers write
+*          it as they would on the part, and SIM_Step() turns the PMD0 compare
+*          values into switch states, integrates the power stage, loads the ADC
+*          result registers and dispatches the enabled interrupt handlers.
+* @version V1.0.0.0
+* $Date:: 2026-10-17 #$
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DS_SIM.h"
+#include "DS_ADC.h"
+#include "APMD.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE                     0x100000
+#endif
+
+#ifndef M_PI
+#define M_PI                                    3.14159265358979323846
+#endif
+
+#define SIM_PERI_SIZE                           0x00100000UL    // PERI_BASE .. VE0, covers every driver used block
+#define SIM_BITBAND_CELLS                       512             // Power of two, hashed by register address and bit
+#define SIM_IRQ_WORDS                           4               // 128 interrupt sources
+
+#define SIM_REG(r)                              (*(volatile uint32_t *)&(r))    // Status registers read-only to the firmware
+
+/*===================================================================*
+                      Core and NVIC Emulation
+*===================================================================*/
+
+uint32_t SystemCoreClock = 160000000UL;
+
+void SystemInit(void){}
+void SystemCoreClockUpdate(void){}
+void wait(uint32_t us){ (void)us; }
+
+static uint32_t SIM_IRQ_Enabled[SIM_IRQ_WORDS];
+static uint32_t SIM_IRQ_Pending[SIM_IRQ_WORDS];
+
+void NVIC_EnableIRQ(IRQn_Type IRQn){ SIM_IRQ_Enabled[(uint32_t)IRQn >> 5] |= (1UL << ((uint32_t)IRQn & 0x1F)); }
+void NVIC_DisableIRQ(IRQn_Type IRQn){ SIM_IRQ_Enabled[(uint32_t)IRQn >> 5] &= ~(1UL << ((uint32_t)IRQn & 0x1F)); }
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn){ SIM_IRQ_Pending[(uint32_t)IRQn >> 5] &= ~(1UL << ((uint32_t)IRQn & 0x1F)); }
+void NVIC_SetPendingIRQ(IRQn_Type IRQn){ SIM_IRQ_Pending[(uint32_t)IRQn >> 5] |= (1UL << ((uint32_t)IRQn & 0x1F)); }
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority){ (void)IRQn; (void)priority; }
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn){ return (SIM_IRQ_Enabled[(uint32_t)IRQn >> 5] >> ((uint32_t)IRQn & 0x1F)) & 0x01UL; }
+
+/* Handlers the firmware may or may not provide, unresolved ones stay 0 */
+extern void INTEMG0_IRQHandler(void)    __attribute__((weak));
+extern void INTOVV0_IRQHandler(void)    __attribute__((weak));
+extern void INTPWM0_IRQHandler(void)    __attribute__((weak));
+extern void INTPWM1_IRQHandler(void)    __attribute__((weak));
+extern void INTPWM2_IRQHandler(void)    __attribute__((weak));
+extern void INTADAPDA_IRQHandler(void)  __attribute__((weak));
+extern void INTADAPDB_IRQHandler(void)  __attribute__((weak));
+extern void INTADACP0_IRQHandler(void)  __attribute__((weak));
+extern void INTADACP1_IRQHandler(void)  __attribute__((weak));
+extern void INTADASGL_IRQHandler(void)  __attribute__((weak));
+extern void INTADACNT_IRQHandler(void)  __attribute__((weak));
+extern void INTSC0RX_IRQHandler(void)   __attribute__((weak));
+extern void INTSC0TX_IRQHandler(void)   __attribute__((weak));
+extern void INTDMAATC_IRQHandler(void)  __attribute__((weak));
+
+typedef struct
+{
+    IRQn_Type irq;
+    void (*handler)(void);
+} SIM_Vector;
+
+static SIM_Vector SIM_Vectors[16];
+static uint32_t SIM_VectorCount = 0;
+
+static void SIM_Vector_Add(IRQn_Type irq, void (*handler)(void)){
+    if(handler != 0 && SIM_VectorCount < (sizeof(SIM_Vectors) / sizeof(SIM_Vectors[0]))){
+        SIM_Vectors[SIM_VectorCount].irq = irq;
+        SIM_Vectors[SIM_VectorCount].handler = handler;
+        SIM_VectorCount++;
+    }
+}
+
+/* Runs the handler now if the line is enabled, else leaves it pending */
+static void SIM_Raise(IRQn_Type irq){
+    NVIC_SetPendingIRQ(irq);
+    if(NVIC_GetEnableIRQ(irq) == 0){
+        return;
+    }
+    for(uint32_t i = 0; i < SIM_VectorCount; i++){
+        if(SIM_Vectors[i].irq == irq){
+            NVIC_ClearPendingIRQ(irq);
+            SIM_Vectors[i].handler();
+            return;
+        }
+    }
+}
+
+/* Software pended lines (NVIC_SetPendingIRQ from firmware) run at the next step */
+static void SIM_Dispatch_Pending(void){
+    for(uint32_t i = 0; i < SIM_VectorCount; i++){
+        uint32_t irq = (uint32_t)SIM_Vectors[i].irq;
+        if((SIM_IRQ_Pending[irq >> 5] & SIM_IRQ_Enabled[irq >> 5] & (1UL << (irq & 0x1F))) != 0){
+            NVIC_ClearPendingIRQ(SIM_Vectors[i].irq);
+            SIM_Vectors[i].handler();
+        }
+    }
+}
+
+/*===================================================================*
+                        Bit-Band Emulation
+*===================================================================*/
+
+/* One alias word per (register, bit). A write lands in value and is folded into
+   the register on the next access of any alias or on SIM_BitBand_Sync(). */
+typedef struct
+{
+    volatile uint32_t * reg;
+    uint32_t bit;
+    volatile uint32_t value;
+    uint32_t last;
+} SIM_BitCell;
+
+static SIM_BitCell SIM_BitCells[SIM_BITBAND_CELLS];
+static SIM_BitCell * SIM_BitDirty[SIM_BITBAND_CELLS];
+static uint32_t SIM_BitDirtyCount = 0;
+
+static void SIM_BitCell_Fold(SIM_BitCell * cell){
+    uint32_t value = cell->value & 0x01UL;
+    if(value != cell->last){
+        if(value){
+            *cell->reg |= (0x01UL << cell->bit);
+        }
+        else{
+            *cell->reg &= ~(0x01UL << cell->bit);
+        }
+    }
+}
+
+void SIM_BitBand_Sync(void){
+    for(uint32_t i = 0; i < SIM_BitDirtyCount; i++){
+        SIM_BitCell * cell = SIM_BitDirty[i];
+        SIM_BitCell_Fold(cell);
+        cell->last = (*cell->reg >> cell->bit) & 0x01UL;
+        cell->value = cell->last;
+    }
+    SIM_BitDirtyCount = 0;
+}
+
+volatile uint32_t * SIM_BitBand(volatile void * addr, uint32_t bitnum){
+    uint32_t key = (uint32_t)((uintptr_t)addr - PERI_BASE) | (bitnum << 24);
+    uint32_t idx = (uint32_t)(key * 2654435761UL) >> 23;
+    SIM_BitCell * cell;
+
+    SIM_BitBand_Sync();                                 // Earlier alias writes become visible first
+    for(uint32_t n = 0; n < SIM_BITBAND_CELLS; n++){
+        cell = &SIM_BitCells[(idx + n) & (SIM_BITBAND_CELLS - 1)];
+        if(cell->reg == 0){
+            cell->reg = (volatile uint32_t *)addr;
+            cell->bit = bitnum;
+            break;
+        }
+        if(cell->reg == (volatile uint32_t *)addr && cell->bit == bitnum){
+            break;
+        }
+    }
+    cell->last = (*cell->reg >> cell->bit) & 0x01UL;
+    cell->value = cell->last;
+    SIM_BitDirty[SIM_BitDirtyCount++] = cell;
+    return &cell->value;
+}
+
+/*===================================================================*
+                        Plant and Metering State
+*===================================================================*/
+
+static SIM_Plant_Config SIM_Cfg;
+static SIM_State SIM_St;
+static SIM_Line_Metrics SIM_Metrics;
+static void (*SIM_Controller)(void) = 0;
+static double SIM_Theta = 0.0;                          // Line angle (rad)
+static double SIM_VacSampled = 0.0;                     // Line voltage at the last ADC sample (V)
+
+static FILE * SIM_Log = 0;
+static uint32_t SIM_LogDecimation = 1;
+static uint32_t SIM_LogCount = 0;
+
+/* Line cycle accumulators */
+static struct
+{
+    double v2, i2, p, po, vo, vo_min, vo_max, i_pk, i_zc;
+    double ia2, pa;                                     // Carrier period averages, line side of the input filter
+    double re[SIM_HARMONICS + 1];
+    double im[SIM_HARMONICS + 1];
+    uint32_t n;
+    uint32_t periods;
+} SIM_Acc;
+
+static uint16_t SIM_AIN[32];                            // Sampled analog inputs of ADA (12-bit counts)
+
+static TSB_PMD_TypeDef * const SIM_PMD[3] = { TSB_PMD0, TSB_PMD1, TSB_PMD2 };
+static double SIM_EmgOver = 0.0;                        // Time the EMG comparator input has been active (s)
+static double SIM_EmgHold = 0.0;                        // Comparator output hold left after the current fell back (s)
+static uint32_t SIM_CmpHits[2];                         // Consecutive conversions over the monitor level
+
+void SIM_Default_Config(SIM_Plant_Config * cfg){
+    cfg->vac_rms = 230.0;
+    cfg->f_line = 50.0;
+    cfg->L = 500e-6;
+    cfg->R_L = 0.10;
+    cfg->C = 470e-6;
+    cfg->R_load = 400.0 * 400.0 / 1000.0;               // 1 kW at 400 V
+    cfg->vo_init = 0.0;
+    cfg->i_trip = SIM_EMG_TRIP_A;
+}
+
+static void SIM_Acc_Reset(void){
+    memset(&SIM_Acc, 0, sizeof(SIM_Acc));
+    SIM_Acc.vo_min = 1e9;
+    SIM_Acc.vo_max = -1e9;
+}
+
+/* A second call resets the registers, NVIC and plant so one process can run several cases */
+bool SIM_Init(const SIM_Plant_Config * cfg){
+    static bool mapped = false;
+
+    if(!mapped){
+        void * p = mmap((void *)PERI_BASE, SIM_PERI_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if(p != (void *)PERI_BASE){
+            if(p != MAP_FAILED){
+                munmap(p, SIM_PERI_SIZE);
+            }
+            return false;
+        }
+        mapped = true;
+    }
+    else{
+        memset((void *)PERI_BASE, 0, SIM_PERI_SIZE);
+        memset(SIM_BitCells, 0, sizeof(SIM_BitCells));
+        SIM_BitDirtyCount = 0;
+        memset(SIM_IRQ_Enabled, 0, sizeof(SIM_IRQ_Enabled));
+        memset(SIM_IRQ_Pending, 0, sizeof(SIM_IRQ_Pending));
+    }
+
+    if(cfg != 0){
+        SIM_Cfg = *cfg;
+    }
+    else{
+        SIM_Default_Config(&SIM_Cfg);
+    }
+
+    memset(&SIM_St, 0, sizeof(SIM_St));
+    memset(&SIM_Metrics, 0, sizeof(SIM_Metrics));
+    SIM_St.vo = (SIM_Cfg.vo_init > 0.0) ? SIM_Cfg.vo_init : SIM_Cfg.vac_rms * sqrt(2.0);
+    SIM_St.duty = -1.0;
+    SIM_Theta = 0.0;
+    SIM_VacSampled = 0.0;
+    SIM_EmgOver = 0.0;
+    SIM_EmgHold = 0.0;
+    memset(SIM_CmpHits, 0, sizeof(SIM_CmpHits));
+    SIM_Acc_Reset();
+
+    SIM_VectorCount = 0;
+    SIM_Vector_Add(INTEMG0_IRQn, INTEMG0_IRQHandler);
+    SIM_Vector_Add(INTOVV0_IRQn, INTOVV0_IRQHandler);
+    SIM_Vector_Add(INTPWM0_IRQn, INTPWM0_IRQHandler);
+    SIM_Vector_Add(INTPWM1_IRQn, INTPWM1_IRQHandler);
+    SIM_Vector_Add(INTPWM2_IRQn, INTPWM2_IRQHandler);
+    SIM_Vector_Add(INTADAPDA_IRQn, INTADAPDA_IRQHandler);
+    SIM_Vector_Add(INTADAPDB_IRQn, INTADAPDB_IRQHandler);
+    SIM_Vector_Add(INTADACP0_IRQn, INTADACP0_IRQHandler);
+    SIM_Vector_Add(INTADACP1_IRQn, INTADACP1_IRQHandler);
+    SIM_Vector_Add(INTADASGL_IRQn, INTADASGL_IRQHandler);
+    SIM_Vector_Add(INTADACNT_IRQn, INTADACNT_IRQHandler);
+    SIM_Vector_Add(INTSC0RX_IRQn, INTSC0RX_IRQHandler);
+    SIM_Vector_Add(INTSC0TX_IRQn, INTSC0TX_IRQHandler);
+    SIM_Vector_Add(INTDMAATC_IRQn, INTDMAATC_IRQHandler);
+    return true;
+}
+
+void SIM_Set_Controller(void (*controller)(void)){
+    SIM_Controller = controller;
+}
+
+void SIM_Set_Load(double R_load){
+    SIM_Cfg.R_load = R_load;
+}
+
+void SIM_Set_Line(double vac_rms, double f_line){
+    SIM_Cfg.vac_rms = vac_rms;
+    SIM_Cfg.f_line = f_line;
+}
+
+void SIM_Log_Open(const char * path, uint32_t decimation){
+    SIM_Log_Close();
+    SIM_Log = fopen(path, "w");
+    SIM_LogDecimation = (decimation == 0) ? 1 : decimation;
+    SIM_LogCount = 0;
+    if(SIM_Log != 0){
+        fprintf(SIM_Log, "t,vac,il,vo,duty\n");
+    }
+}
+
+void SIM_Log_Close(void){
+    if(SIM_Log != 0){
+        fclose(SIM_Log);
+        SIM_Log = 0;
+    }
+}
+
+const SIM_State * SIM_Get_State(void){
+    return &SIM_St;
+}
+
+const SIM_Line_Metrics * SIM_Get_Metrics(void){
+    return &SIM_Metrics;
+}
+
+/*===================================================================*
+                        UART0 Model
+*===================================================================*/
+/* Without DS_UART.c in the host build the transmit ring is a byte sink, the real
+   driver takes over these weak definitions when it is linked and its INTSC0TX
+   handler is drained into the same sink one character at a time */
+static uint8_t SIM_UART_Sink[SIM_UART_RING_SIZE];
+static uint32_t SIM_UART_Length = 0;
+
+__attribute__((weak)) uint16_t UART_TX_Free(void){
+    return (uint16_t)(SIM_UART_RING_SIZE - SIM_UART_Length);
+}
+
+__attribute__((weak)) bool UART_TX_Queue(TSB_UART_TypeDef * UARTx, const char *data, uint16_t length){
+    (void)UARTx;
+    if(length > UART_TX_Free()){
+        return false;
+    }
+    memcpy(&SIM_UART_Sink[SIM_UART_Length], data, length);
+    SIM_UART_Length += length;
+    return true;
+}
+
+/* DR is one RAM word, so the FIFO is offered one free stage per handler call (TLVL = depth - 1)
+   and a DR that moved off the marker is the character shifted out */
+static void SIM_UART_Drain(void){
+    if(INTSC0TX_IRQHandler == 0){
+        return;
+    }
+    NVIC_ClearPendingIRQ(INTSC0TX_IRQn);
+    while(SIM_UART_Length < SIM_UART_RING_SIZE){
+        SIM_REG(TSB_UART0->SR) = (TSB_UART0->SR & ~(0x0FUL << 8)) | (0x07UL << 8);
+        TSB_UART0->DR = SIM_UART_DR_IDLE;
+        INTSC0TX_IRQHandler();
+        if(TSB_UART0->DR == SIM_UART_DR_IDLE){
+            break;
+        }
+        SIM_UART_Sink[SIM_UART_Length++] = (uint8_t)(TSB_UART0->DR & 0xFF);
+    }
+    SIM_REG(TSB_UART0->SR) &= ~(0x0FUL << 8);
+}
+
+/* Bytes sent on UART0 since the last call, the ring is empty again */
+const uint8_t * SIM_UART_Take(uint32_t * length){
+    SIM_UART_Drain();
+    *length = SIM_UART_Length;
+    SIM_UART_Length = 0;
+    return SIM_UART_Sink;
+}
+
+/* Received characters, one INTSC0RX per character (RLVL = 1) as a line slower than the handler */
+void SIM_UART_Receive(const uint8_t * data, uint32_t length){
+    for(uint32_t k = 0; k < length; k++){
+        SIM_REG(TSB_UART0->SR) = (TSB_UART0->SR & ~0x0FUL) | 0x01UL;
+        SIM_REG(TSB_UART0->DR) = data[k];
+        SIM_Raise(INTSC0RX_IRQn);
+    }
+    SIM_REG(TSB_UART0->SR) &= ~0x0FUL;
+}
+
+/* Receive FIFO overrun: the characters that did not fit are gone, the next INTSC0RX sees OVRERR */
+void SIM_UART_Overrun(void){
+    SIM_REG(TSB_UART0->SR) &= ~0x0FUL;
+    SIM_REG(TSB_UART0->ERR) |= 0x08UL;
+    SIM_Raise(INTSC0RX_IRQn);
+    SIM_REG(TSB_UART0->ERR) &= ~0x08UL;                         // Write one to clear, RAM keeps the written bit
+}
+
+/*===================================================================*
+                        ADC Result Model
+*===================================================================*/
+
+static uint16_t SIM_ADC_Counts(double counts){
+    if(counts < 0.0) return 0;
+    if(counts > 4095.0) return 4095;
+    return (uint16_t)(counts + 0.5);
+}
+
+static void SIM_ADC_Sample(double vac, double il, double vo){
+    SIM_AIN[SIM_AIN_IL]    = SIM_ADC_Counts(SIM_ADC_I_OFFSET + SIM_ADC_I_GAIN * il);
+    SIM_AIN[SIM_AIN_VRECT] = SIM_ADC_Counts(SIM_ADC_VBUS_GAIN * fabs(vac));
+    SIM_AIN[SIM_AIN_VBUS]  = SIM_ADC_Counts(SIM_ADC_VBUS_GAIN * vo);
+    SIM_AIN[SIM_AIN_VAC]   = SIM_ADC_Counts(SIM_ADC_VAC_OFFSET + SIM_ADC_VAC_GAIN * vac);
+}
+
+/* REGn = result << 4 | valid, same layout ADC_Read()/getADC_REGx() decode */
+static void SIM_ADC_Store(TSB_AD_TypeDef * ADx, uint32_t n, uint32_t ain){
+    volatile uint32_t * reg = (volatile uint32_t *)&ADx->REG0;
+    if(n < 24){
+        reg[n] = ((uint32_t)SIM_AIN[ain & 0x1F] << 4) | 0x01UL;
+    }
+}
+
+/* General purpose / single / continuous programs: every TSETn with a start factor (TRGS).
+   Loaded even before ADEN so a polling ADC_Read() never waits on the model. */
+static void SIM_ADC_Update_TSET(TSB_AD_TypeDef * ADx){
+    volatile uint32_t * tset = &ADx->TSET0;
+    for(uint32_t n = 0; n < 24; n++){
+        if((tset[n] & TSET0_TRGS0_MASK) != 0){
+            SIM_ADC_Store(ADx, n, tset[n] & TSET0_AINST0_MASK);
+        }
+    }
+}
+
+/* PMD triggered programs: PSELn (trigger n = PMD n/4, TRG n%4) -> PSETm -> REG[4*REGSELm + slot] */
+static void SIM_ADC_Update_PMD(TSB_AD_TypeDef * ADx, IRQn_Type irqA, IRQn_Type irqB){
+    static TSB_PMD_TypeDef * const pmd[3] = { TSB_PMD0, TSB_PMD1, TSB_PMD2 };
+    volatile uint32_t * psel = &ADx->PSEL0;
+    volatile uint32_t * pints = &ADx->PINTS0;
+    volatile uint32_t * pset = &ADx->PSET0;
+    bool fireA = false, fireB = false;
+
+    if((ADx->CR0 & CR0_ADEN_MASK) == 0){
+        return;
+    }
+    for(uint32_t n = 0; n < 12; n++){
+        TSB_PMD_TypeDef * PMDx = pmd[n / 4];
+        uint32_t trgmd = (PMDx->TRGCR >> (4 * (n % 4))) & 0x07UL;
+        if((psel[n] & PSEL0_PENS0_MASK) == 0 || (PMDx->MDEN & 0x01UL) == 0 || trgmd == 0){
+            continue;
+        }
+        uint32_t prog = psel[n] & PSEL0_PMDS0_MASK;
+        uint32_t regsel = (ADx->PREGS >> (4 * prog)) & 0x07UL;
+        for(uint32_t slot = 0; slot < 4; slot++){
+            uint32_t sp = (pset[prog] >> (8 * slot)) & 0xFFUL;
+            if(sp & 0x80UL){
+                SIM_ADC_Store(ADx, 4 * regsel + slot, sp & 0x1FUL);
+            }
+        }
+        switch(pints[prog] & PINTS0_INTSEL0_MASK){
+            case 0x01 : fireA = true; break;
+            case 0x02 : fireB = true; break;
+            default : break;
+        }
+    }
+    if(fireA) SIM_Raise(irqA);
+    if(fireB) SIM_Raise(irqB);
+}
+
+/* Monitor functions 0 / 1 on the stored results (ADBIG = 0: above CMPn), CMPCNTn + 1 conversions in a row
+   (CMPCND = 0) or accumulated (CMPCND = 1).
+   The output raises INTADxCP0/1 and, through OVVCR ADIN0EN/ADIN1EN, the OVV of every enabled unit */
+static void SIM_ADC_Monitor(TSB_AD_TypeDef * ADx){
+    volatile uint32_t * reg = (volatile uint32_t *)&ADx->REG0;
+    uint32_t cr[2] = { ADx->CMPCR0, ADx->CMPCR1 };
+    uint32_t lvl[2] = { (ADx->CMP0 >> 4) & 0xFFFUL, (ADx->CMP1 >> 4) & 0xFFFUL };
+    bool out[2] = { false, false };
+
+    if((ADx->CR0 & CR0_ADEN_MASK) == 0){
+        return;
+    }
+    for(uint32_t k = 0; k < 2; k++){
+        uint32_t value = (reg[cr[k] & CMPCR0_REGS0_MASK] >> 4) & 0xFFFUL;
+        bool hit = (cr[k] & CMPCR0_ADBIG0_MASK) ? (value < lvl[k]) : (value > lvl[k]);
+
+        if((ADx->CMPEN & (CMPEN_CMP0EN_MASK << k)) == 0 || (cr[k] & CMPCR0_REGS0_MASK) >= 24){
+            SIM_CmpHits[k] = 0;
+            continue;
+        }
+        if(cr[k] & CMPCR0_CMPCND0_MASK){
+            SIM_CmpHits[k] += hit ? 1 : 0;                  // Accumulated, restarts after each output
+        }
+        else {
+            SIM_CmpHits[k] = hit ? SIM_CmpHits[k] + 1 : 0;  // In a row
+        }
+        out[k] = (SIM_CmpHits[k] > ((cr[k] & CMPCR0_CMPCNT0_MASK) >> 8));
+        if(out[k] && (cr[k] & CMPCR0_CMPCND0_MASK)){
+            SIM_CmpHits[k] = 0;
+        }
+        if(out[k]){
+            SIM_Raise((k == 0) ? INTADACP0_IRQn : INTADACP1_IRQn);
+        }
+    }
+    for(uint32_t u = 0; u < 3; u++){
+        TSB_PMD_TypeDef * PMDx = SIM_PMD[u];
+        bool ovv = ((PMDx->OVVCR & OVVCR_ADIN0EN_MASK) && out[0]) || ((PMDx->OVVCR & OVVCR_ADIN1EN_MASK) && out[1]);
+
+        if((PMDx->OVVCR & OVVCR_OVVEN_MASK) == 0){
+            continue;
+        }
+        SIM_REG(PMDx->OVVSTA) = (PMDx->OVVSTA & ~OVVSTA_OVVI_MASK) | (ovv ? OVVSTA_OVVI_MASK : 0);
+        if(ovv && (PMDx->OVVSTA & OVVSTA_OVVST_MASK) == 0){
+            SIM_REG(PMDx->OVVSTA) |= OVVSTA_OVVST_MASK;
+            SIM_Raise((IRQn_Type)(INTOVV0_IRQn + u));
+        }
+    }
+}
+
+/*===================================================================*
+                        Power Stage Model
+*===================================================================*/
+
+/* Output a protection holds on a unit: 0 = none, else the EMGMD / OVVMD code of the unit that
+   tripped (1 upper on, 2 lower on, 3 all off). SYNCCR EMGSMD / OVVSMD make a unit follow PMD0 */
+static uint32_t SIM_Protect_Mode(TSB_PMD_TypeDef * PMDx){
+    if(PMDx->EMGSTA & EMGSTA_EMGST_MASK){
+        return (PMDx->EMGCR & EMGCR_EMGMD_MASK) >> 3;
+    }
+    if((PMDx->SYNCCR & (0x02UL << 4)) && (TSB_PMD0->EMGSTA & EMGSTA_EMGST_MASK)){
+        return (TSB_PMD0->EMGCR & EMGCR_EMGMD_MASK) >> 3;
+    }
+    if(PMDx->OVVSTA & OVVSTA_OVVST_MASK){
+        return (PMDx->OVVCR & OVVCR_OVVMD_MASK) >> 3;
+    }
+    if((PMDx->SYNCCR & (0x02UL << 6)) && (TSB_PMD0->OVVSTA & OVVSTA_OVVST_MASK)){
+        return (TSB_PMD0->OVVCR & OVVCR_OVVMD_MASK) >> 3;
+    }
+    return 0;
+}
+
+/* EMGRS / OVVRS written since the last period: the state clears if the input has, the bit reads 0 */
+static void SIM_Protect_Release(void){
+    for(uint32_t u = 0; u < 3; u++){
+        TSB_PMD_TypeDef * PMDx = SIM_PMD[u];
+        if(PMDx->EMGCR & EMGCR_EMGRS_MASK){
+            PMDx->EMGCR &= ~EMGCR_EMGRS_MASK;
+            if((PMDx->EMGSTA & EMGSTA_EMGI_MASK) == 0){
+                SIM_REG(PMDx->EMGSTA) &= ~EMGSTA_EMGST_MASK;
+            }
+        }
+        if(PMDx->OVVCR & OVVCR_OVVRS_MASK){
+            PMDx->OVVCR &= ~OVVCR_OVVRS_MASK;
+            if((PMDx->OVVSTA & OVVSTA_OVVI_MASK) == 0){
+                SIM_REG(PMDx->OVVSTA) &= ~OVVSTA_OVVST_MASK;
+            }
+        }
+    }
+}
+
+/* External window comparator on |il| into the PMD0 EMG input, through the EMGCNT filter.
+   The comparator output is stretched by SIM_EMG_HOLD_S (latch and RC of the fault line),
+   so the input clears some time after the current. Returns true on the substep the
+   protection state is entered */
+static bool SIM_EMG_Input(double il, double dt){
+    TSB_PMD_TypeDef * PMDx = TSB_PMD0;
+    bool over = (SIM_Cfg.i_trip > 0.0) && (fabs(il) >= SIM_Cfg.i_trip);
+    double filter = (double)((PMDx->EMGCR & EMGCR_EMGCNT_MASK) >> 8) * 16.0 / (double)SystemCoreClock;
+    bool active;
+
+    SIM_EmgHold = over ? SIM_EMG_HOLD_S : ((SIM_EmgHold > dt) ? SIM_EmgHold - dt : 0.0);
+    active = over || (SIM_EmgHold > 0.0);
+    SIM_EmgOver = active ? SIM_EmgOver + dt : 0.0;
+    if((PMDx->EMGCR & EMGCR_EMGEN_MASK) == 0 || (PMDx->EMGCR & EMGCR_EMGISEL_MASK) != 0){
+        SIM_REG(PMDx->EMGSTA) &= ~EMGSTA_EMGI_MASK;
+        return false;
+    }
+    active = active && (SIM_EmgOver >= filter);
+    SIM_REG(PMDx->EMGSTA) = (PMDx->EMGSTA & ~EMGSTA_EMGI_MASK) | (active ? EMGSTA_EMGI_MASK : 0);
+    if(active && (PMDx->EMGSTA & EMGSTA_EMGST_MASK) == 0){
+        SIM_REG(PMDx->EMGSTA) |= EMGSTA_EMGST_MASK;
+        return true;
+    }
+    return false;
+}
+
+/* U phase of a unit: the upper gate is on for 'duty' of the period around the carrier
+   peak, the lower gate for the rest, each only if its output is enabled. MDOUT fixed
+   outputs are a duty of 1 (upper) or 0 (lower), upper and lower held on together
+   would short the bus and are modelled as off */
+typedef struct
+{
+    double duty;
+    bool upper;
+    bool lower;
+} SIM_Leg;
+
+static SIM_Leg SIM_Leg_Read(TSB_PMD_TypeDef * PMDx){
+    SIM_Leg leg = { 0.0, false, false };
+    uint32_t oc = PMDx->MDOUT & 0x03UL;
+
+    if((PMDx->MDEN & 0x01UL) == 0){
+        return leg;
+    }
+    switch(SIM_Protect_Mode(PMDx)){
+        case 0x00 : break;
+        case 0x01 : leg.duty = 1.0; leg.upper = true; return leg;
+        case 0x02 : leg.lower = true; return leg;
+        default : return leg;
+    }
+    if((PMDx->MDOUT & 0x100UL) != 0){
+        leg.duty = (double)(PMDx->CMPU & 0xFFFFUL) / 32768.0;
+        leg.duty = (leg.duty > 1.0) ? 1.0 : leg.duty;
+        leg.upper = (oc != 0x01UL);                 // UOC = 0 (reset value) taken as both, as before the roles
+        leg.lower = (oc != 0x02UL);
+        return leg;
+    }
+    if(oc == 0x02UL){
+        leg.duty = 1.0;
+        leg.upper = true;
+    }
+    else if(oc == 0x01UL){
+        leg.lower = true;
+    }
+    return leg;
+}
+
+/* Slow leg: PMD1 U phase when running (compare at or over 50% = upper), else commutated
+   with the line polarity the firmware last sampled (upper on in the negative half cycle),
+   so both legs change on the same carrier period as they would under a controller
+   driving both */
+static SIM_Leg SIM_Slow_Leg(void){
+    SIM_Leg leg = { (SIM_VacSampled < 0.0) ? 1.0 : 0.0, true, true };
+
+    if((TSB_PMD1->MDEN & 0x01UL) != 0){
+        leg = SIM_Leg_Read(TSB_PMD1);
+        if((TSB_PMD1->MDOUT & 0x100UL) != 0){
+            leg.duty = (leg.duty >= 0.5) ? 1.0 : 0.0;
+        }
+    }
+    return leg;
+}
+
+static void SIM_Line_Close(void){
+    double n = (double)SIM_Acc.n;
+    if(SIM_Acc.n == 0){
+        return;
+    }
+    SIM_Metrics.cycle++;
+    SIM_Metrics.vrms = sqrt(SIM_Acc.v2 / n);
+    SIM_Metrics.irms = sqrt(SIM_Acc.i2 / n);
+    SIM_Metrics.p_in = SIM_Acc.p / n;
+    SIM_Metrics.p_out = SIM_Acc.po / n;
+    SIM_Metrics.s_in = SIM_Metrics.vrms * SIM_Metrics.irms;
+    SIM_Metrics.pf = (SIM_Metrics.s_in > 0.0) ? SIM_Metrics.p_in / SIM_Metrics.s_in : 0.0;
+    SIM_Metrics.eff = (SIM_Metrics.p_in > 0.0) ? SIM_Metrics.p_out / SIM_Metrics.p_in : 0.0;
+    if(SIM_Acc.periods > 0){
+        SIM_Metrics.irms_line = sqrt(SIM_Acc.ia2 / SIM_Acc.periods);
+        SIM_Metrics.pf_line = (SIM_Metrics.irms_line > 0.0) ?
+            (SIM_Acc.pa / SIM_Acc.periods) / (SIM_Metrics.vrms * SIM_Metrics.irms_line) : 0.0;
+    }
+    SIM_Metrics.vbus_avg = SIM_Acc.vo / n;
+    SIM_Metrics.vbus_ripple = SIM_Acc.vo_max - SIM_Acc.vo_min;
+    SIM_Metrics.i_peak = SIM_Acc.i_pk;
+    SIM_Metrics.i_zc = SIM_Acc.i_zc;
+
+    double h1 = SIM_Acc.re[1] * SIM_Acc.re[1] + SIM_Acc.im[1] * SIM_Acc.im[1];
+    double hn = 0.0;
+    for(uint32_t k = 2; k <= SIM_HARMONICS; k++){
+        hn += SIM_Acc.re[k] * SIM_Acc.re[k] + SIM_Acc.im[k] * SIM_Acc.im[k];
+    }
+    SIM_Metrics.thd = (h1 > 0.0) ? sqrt(hn / h1) : 0.0;
+    SIM_Acc_Reset();
+}
+
+/* Advances one PWM carrier period */
+void SIM_Step(void){
+    double f_pwm, dt, vpk, v_zc, i_avg = 0.0, theta_mid;
+    double v_avg = 0.0;
+    SIM_Leg fast, slow;
+    bool wrapped = false, emg = false;
+
+    SIM_BitBand_Sync();
+    SIM_Protect_Release();
+    SIM_St.il_peak = 0.0;
+    if(NVIC_GetEnableIRQ(INTSC0TX_IRQn) != 0 && (SIM_IRQ_Pending[(uint32_t)INTSC0TX_IRQn >> 5] & (1UL << ((uint32_t)INTSC0TX_IRQn & 0x1F))) != 0){
+        SIM_UART_Drain();                                           // Before the generic dispatch writes DR blind
+    }
+    SIM_Dispatch_Pending();
+
+    f_pwm = (TSB_PMD0->RATE != 0) ? (double)SystemCoreClock * (double)TSB_PMD0->RATE / 16777216.0 : SIM_DEFAULT_PWM_HZ;
+    dt = 1.0 / (f_pwm * SIM_SUBSTEPS);
+    fast = SIM_Leg_Read(TSB_PMD0);
+    slow = SIM_Slow_Leg();
+    vpk = SIM_Cfg.vac_rms * sqrt(2.0);
+    v_zc = vpk * sin(2.0 * M_PI * SIM_Cfg.f_line * SIM_ZC_WINDOW_S);
+    theta_mid = SIM_Theta + M_PI * SIM_Cfg.f_line / f_pwm;
+
+    for(uint32_t k = 0; k < SIM_SUBSTEPS; k++){
+        double vac = vpk * sin(SIM_Theta);
+        double il = SIM_St.il, vo = SIM_St.vo;
+        double carrier = 1.0 - fabs(2.0 * ((double)k + 0.5) / SIM_SUBSTEPS - 1.0);
+        bool fast_up = (carrier >= 1.0 - fast.duty), slow_up = (carrier >= 1.0 - slow.duty);
+        bool fast_float = fast_up ? !fast.upper : !fast.lower;
+        bool slow_float = slow_up ? !slow.upper : !slow.lower;
+        double v_sw = fast_up ? vo : 0.0;
+        double v_ret = slow_up ? vo : 0.0;
+
+        /* Switches off: the body diodes follow the current (fast leg upper / slow leg lower for a
+           positive current), at zero current a floating node takes the voltage that blocks */
+        if(slow_float){
+            v_ret = (il > 0.0) ? 0.0 : ((il < 0.0) ? vo : 0.0);
+        }
+        if(fast_float){
+            if(il > 0.0)      v_sw = vo;
+            else if(il < 0.0) v_sw = 0.0;
+            else{
+                v_sw = vac + v_ret;
+                v_sw = (v_sw < 0.0) ? 0.0 : ((v_sw > vo) ? vo : v_sw);
+            }
+        }
+        if(slow_float && il == 0.0){
+            v_ret = v_sw - vac;
+            v_ret = (v_ret < 0.0) ? 0.0 : ((v_ret > vo) ? vo : v_ret);
+        }
+
+        double il_next = il + (vac + v_ret - v_sw - SIM_Cfg.R_L * il) / SIM_Cfg.L * dt;
+        if((fast_float || slow_float) && ((il > 0.0 && il_next < 0.0) || (il < 0.0 && il_next > 0.0))){
+            il_next = 0.0;                              // Diode blocks the reversal
+        }
+        if(fast_float && slow_float && il == 0.0){
+            il_next = 0.0;                              // Both legs off, no path below the bus voltage
+        }
+        double il_mid = 0.5 * (il + il_next);            // Trapezoidal current keeps the energy balance
+        double i_bus = ((v_sw == vo) ? il_mid : 0.0) - ((v_ret == vo) ? il_mid : 0.0);
+        SIM_St.vo = vo + (i_bus - vo / SIM_Cfg.R_load) / SIM_Cfg.C * dt;
+        SIM_St.il = il_next;
+        SIM_St.vac = vac;
+        if(SIM_EMG_Input(il_next, dt)){
+            emg = true;                                 // Both legs off from the next substep
+            fast = SIM_Leg_Read(TSB_PMD0);
+            slow = SIM_Slow_Leg();
+        }
+
+        if(k == SIM_SUBSTEPS / 2){
+            SIM_ADC_Sample(vac, il, vo);                // Carrier peak sample
+            SIM_VacSampled = vac;
+        }
+
+        SIM_Acc.v2 += vac * vac;
+        SIM_Acc.i2 += il_mid * il_mid;
+        SIM_Acc.p += vac * il_mid;
+        SIM_Acc.po += vo * vo / SIM_Cfg.R_load;
+        SIM_Acc.vo += vo;
+        if(vo < SIM_Acc.vo_min) SIM_Acc.vo_min = vo;
+        if(vo > SIM_Acc.vo_max) SIM_Acc.vo_max = vo;
+        if(fabs(il) > SIM_Acc.i_pk) SIM_Acc.i_pk = fabs(il);
+        if(fabs(il_next) > SIM_St.il_peak) SIM_St.il_peak = fabs(il_next);
+        if(fabs(vac) < v_zc && fabs(il) > SIM_Acc.i_zc) SIM_Acc.i_zc = fabs(il);
+        SIM_Acc.n++;
+        i_avg += il_mid;
+        v_avg += vac;
+
+        SIM_Theta += 2.0 * M_PI * SIM_Cfg.f_line * dt;
+        if(SIM_Theta >= 2.0 * M_PI){
+            SIM_Theta -= 2.0 * M_PI;
+            wrapped = true;
+        }
+    }
+
+    /* Harmonic phasors from the period average current, cos/sin(k*theta) by recurrence */
+    i_avg /= SIM_SUBSTEPS;
+    v_avg /= SIM_SUBSTEPS;
+    SIM_Acc.ia2 += i_avg * i_avg;
+    SIM_Acc.pa += v_avg * i_avg;
+    SIM_Acc.periods++;
+    {
+        double c1 = cos(theta_mid), s1 = sin(theta_mid), ck = c1, sk = s1, t;
+        for(uint32_t k = 1; k <= SIM_HARMONICS; k++){
+            SIM_Acc.re[k] += i_avg * ck;
+            SIM_Acc.im[k] -= i_avg * sk;
+            t = ck * c1 - sk * s1;
+            sk = sk * c1 + ck * s1;
+            ck = t;
+        }
+    }
+
+    SIM_St.t += 1.0 / f_pwm;
+    SIM_St.duty = (fast.upper || fast.lower) ? fast.duty : -1.0;
+
+    if(SIM_Log != 0 && (SIM_LogCount++ % SIM_LogDecimation) == 0){
+        fprintf(SIM_Log, "%.7f,%.3f,%.4f,%.3f,%.4f\n", SIM_St.t, SIM_St.vac, SIM_St.il, SIM_St.vo, SIM_St.duty);
+    }
+
+    /* Conversions, then the carrier period interrupt */
+    SIM_ADC_Update_TSET(TSB_ADA);
+    SIM_ADC_Update_PMD(TSB_ADA, INTADAPDA_IRQn, INTADAPDB_IRQn);
+    SIM_ADC_Monitor(TSB_ADA);
+    if(emg) SIM_Raise(INTEMG0_IRQn);
+    if(SIM_Controller != 0){
+        SIM_Controller();
+    }
+    if((TSB_PMD0->MDEN & 0x01UL) != 0) SIM_Raise(INTPWM0_IRQn);
+    if((TSB_PMD1->MDEN & 0x01UL) != 0) SIM_Raise(INTPWM1_IRQn);
+    if((TSB_PMD2->MDEN & 0x01UL) != 0) SIM_Raise(INTPWM2_IRQn);
+
+    if(wrapped){
+        SIM_Line_Close();
+    }
+}
+
+void SIM_Run(double seconds, void (*onCycle)(const SIM_Line_Metrics * m)){
+    double end = SIM_St.t + seconds;
+    uint32_t cycle = SIM_Metrics.cycle;
+
+    while(SIM_St.t < end){
+        SIM_Step();
+        if(SIM_Metrics.cycle != cycle){
+            cycle = SIM_Metrics.cycle;
+            if(onCycle != 0){
+                onCycle(&SIM_Metrics);
+            }
+        }
+    }
+    SIM_BitBand_Sync();
+}
@@ -0,0 +1,129 @@
+/**
+ *******************************************************************************
+ * @file    DS_SIM.h
+ * @brief   Host register model and Totem-Pole PFC plant simulator
+ *          Runs APMD.c / DS_ADC.c / DS_UART.c on Linux against RAM-backed
+ *          TSB_PMDx, TSB_ADx and TSB_UARTx blocks at their real addresses.
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * Host build (the sim directory must come first on the include path):
+ *   gcc -O2 -Isim -Ilibraries sim/DS_SIM.c sim/sim_main.c \
+ *       libraries/APMD.c libraries/DS_ADC.c libraries/DS_PFC.c libraries/DS_PLL.c libraries/DS_PROT.c \
+ *       libraries/DS_DMA.c libraries/DS_METER.c libraries/DS_HARM.c libraries/DS_SCOPE.c libraries/DS_TLM.c \
+ *       libraries/DS_UART.c libraries/DS_CRC.c -lm -o pfc_sim
+ * sim/jsmn.h stands in for the jsmn tokenizer. Left out, DS_UART.c is replaced by a
+ * UART_TX_Queue() byte sink (SIM_UART_Take()).
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __DS_SIM_H__
+#define __DS_SIM_H__
+
+#include "TMPM4KyA.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Simulation Settings
+*===================================================================*/
+#define SIM_SUBSTEPS                            32          // Integration steps per PWM carrier period
+#define SIM_HARMONICS                           40          // Highest harmonic used for THD
+#define SIM_DEFAULT_PWM_HZ                      65000.0     // Carrier used while RATE is 0
+#define SIM_ZC_WINDOW_S                         0.0005      // Zero crossing current peak taken within +-0.5 ms of each crossing
+#define SIM_EMG_TRIP_A                          18.0        // External over-current comparator on the PMD0 EMG input
+#define SIM_EMG_HOLD_S                          0.0005      // Its output stays active this long after |il| falls back
+#define SIM_UART_RING_SIZE                      1024        // UART0 bytes kept between SIM_UART_Take() calls, as the driver ring
+#define SIM_UART_DR_IDLE                        0xFFFFFFFFUL    // DR marker while no character is written
+
+/* Analog inputs of ADA driven by the plant (same channels as ADC_Conversion_Setting) */
+#define SIM_AIN_IL                              0x05        // AINA05 - Inductor (line) current
+#define SIM_AIN_VRECT                           0x06        // AINA06 - Rectified line voltage
+#define SIM_AIN_VBUS                            0x07        // AINA07 - DC bus voltage
+#define SIM_AIN_VAC                             0x08        // AINA08 - Line voltage
+
+/* Sensor scaling seen by the 12-bit ADC */
+#define SIM_ADC_I_OFFSET                        2048.0      // Counts at 0 A
+#define SIM_ADC_I_GAIN                          100.0       // Counts per A (+/- 20.48 A full scale)
+#define SIM_ADC_VBUS_GAIN                       8.0         // Counts per V (512 V full scale)
+#define SIM_ADC_VAC_OFFSET                      2048.0      // Counts at 0 V
+#define SIM_ADC_VAC_GAIN                        4.0         // Counts per V (+/- 512 V full scale)
+
+/* PWM frequency register value for a carrier frequency (Freq = fsys*RATE/2^24) */
+#define SIM_RATE(hz)                            ((uint32_t)(((double)(hz) * 16777216.0) / (double)SystemCoreClock + 0.5))
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef struct
+{
+    double vac_rms;                 // Line voltage RMS (V)
+    double f_line;                  // Line frequency (Hz)
+    double L;                       // Boost inductance (H)
+    double R_L;                     // Inductor + switch resistance (Ohm)
+    double C;                       // Bulk capacitance (F)
+    double R_load;                  // Load resistance (Ohm)
+    double vo_init;                 // Bus voltage at start (V), 0 = line peak (pre-charged)
+    double i_trip;                  // EMG comparator level on |il| (A), 0 = no comparator
+} SIM_Plant_Config;
+
+typedef struct
+{
+    uint32_t cycle;                 // Line cycle number
+    double vrms;                    // Line voltage RMS (V)
+    double irms;                    // Line current RMS (A)
+    double p_in;                    // Real input power (W)
+    double s_in;                    // Apparent input power (VA)
+    double pf;                      // Power factor
+    double thd;                     // Current THD up to SIM_HARMONICS (ratio)
+    double p_out;                   // Load power (W)
+    double eff;                     // Efficiency (p_out / p_in)
+    double vbus_avg;                // Average bus voltage (V)
+    double vbus_ripple;             // Peak to peak bus voltage (V)
+    double i_peak;                  // Peak inductor current (A)
+    double i_zc;                    // Peak inductor current around the line zero crossings (A)
+    double irms_line;               // Line current RMS without the switching ripple (A), carrier period averages
+    double pf_line;                 // Power factor from those, as a meter behind the input filter reads it
+} SIM_Line_Metrics;
+
+typedef struct
+{
+    double t;                       // Simulated time (s)
+    double vac;                     // Line voltage (V)
+    double il;                      // Inductor current (A)
+    double vo;                      // Bus voltage (V)
+    double duty;                    // Fast leg upper duty (0..1, -1 = outputs off)
+    double il_peak;                 // Largest |il| within the last carrier period (A)
+} SIM_State;
+
+/*===================================================================*
+                  Functions declaration for SIM
+*===================================================================*/
+void SIM_Default_Config(SIM_Plant_Config * cfg);
+bool SIM_Init(const SIM_Plant_Config * cfg);
+void SIM_Step(void);
+void SIM_Run(double seconds, void (*onCycle)(const SIM_Line_Metrics * m));
+void SIM_Set_Controller(void (*controller)(void));
+void SIM_Set_Load(double R_load);
+void SIM_Set_Line(double vac_rms, double f_line);
+void SIM_Log_Open(const char * path, uint32_t decimation);
+void SIM_Log_Close(void);
+
+const SIM_State * SIM_Get_State(void);
+const SIM_Line_Metrics * SIM_Get_Metrics(void);
+void SIM_BitBand_Sync(void);
+const uint8_t * SIM_UART_Take(uint32_t * length);
+void SIM_UART_Receive(const uint8_t * data, uint32_t length);
+void SIM_UART_Overrun(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DS_SIM_H__ */
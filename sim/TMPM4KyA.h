@@ -0,0 +1,39 @@
+/**
+ *******************************************************************************
+ * @file    TMPM4KyA.h
+ * @brief   Host stand-in for the TMPM4KyA device header
+ *          The peripheral window at PERI_BASE is mapped onto RAM by SIM_Init()
+ *          so TSB_PMDx, TSB_ADx and TSB_UARTx keep their real addresses, and
+ *          the bit-band alias region is redirected to SIM_BitBand().
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __TMPM4KYA_SIM_H__
+#define __TMPM4KYA_SIM_H__
+
+#ifndef DS_HOST_SIM
+#define DS_HOST_SIM
+#endif
+
+#include <stdint.h>
+#include "../libraries/TMPM4KNA.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bit-band alias words are emulated by one RAM cell per (register, bit) */
+volatile uint32_t * SIM_BitBand(volatile void * addr, uint32_t bitnum);
+
+#undef  BITBAND_PERI
+#define BITBAND_PERI(addr, bitnum)              ((uintptr_t)SIM_BitBand((volatile void *)(addr), (bitnum)))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __TMPM4KYA_SIM_H__ */
@@ -0,0 +1,77 @@
+/**
+ *******************************************************************************
+ * @file    core_cm4.h
+ * @brief   Host stand-in for the CMSIS Cortex-M4 core header
+ *          Used only by the DS_HOST_SIM register-model build
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __CORE_CM4_SIM_H__
+#define __CORE_CM4_SIM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        IO Type Qualifiers
+*===================================================================*/
+#define __I                                     volatile const
+#define __O                                     volatile
+#define __IO                                    volatile
+
+/*===================================================================*
+            NVIC and Core Intrinsics (Implemented in DS_SIM.c)
+*===================================================================*/
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetEnableIRQ(IRQn_Type IRQn);
+
+static inline void __disable_irq(void){}
+static inline void __enable_irq(void){}
+static inline uint32_t __get_PRIMASK(void){ return 0; }
+static inline void __set_PRIMASK(uint32_t priMask){ (void)priMask; }
+static inline void __DMB(void){ __sync_synchronize(); }
+static inline void __DSB(void){ __sync_synchronize(); }
+static inline void __ISB(void){ __sync_synchronize(); }
+static inline void __NOP(void){}
+
+/* Saturate a signed value to a bit width (1..32) */
+#define __SSAT(val, sat)                        __sim_ssat((int32_t)(val), (sat))
+static inline int32_t __sim_ssat(int32_t val, uint32_t sat){
+    const int32_t max = (int32_t)((1UL << (sat - 1U)) - 1U);
+    const int32_t min = -1 - max;
+    return (val > max) ? max : ((val < min) ? min : val);
+}
+
+/* Saturate an unsigned value to a bit width (0..31) */
+#define __USAT(val, sat)                        __sim_usat((int32_t)(val), (sat))
+static inline uint32_t __sim_usat(int32_t val, uint32_t sat){
+    const uint32_t max = ((1UL << sat) - 1U);
+    return (val > (int32_t)max) ? max : ((val < 0) ? 0U : (uint32_t)val);
+}
+
+/* Count leading zeros */
+static inline uint8_t __CLZ(uint32_t value){
+    return (value == 0U) ? 32U : (uint8_t)__builtin_clz(value);
+}
+
+/* Dual 16 x 16 signed multiply accumulate long (SMLALD) */
+static inline int64_t __SMLALD(uint32_t op1, uint32_t op2, int64_t acc){
+    return acc + ((int64_t)(int16_t)op1 * (int16_t)op2) + ((int64_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __CORE_CM4_SIM_H__ */
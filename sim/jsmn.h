@@ -0,0 +1,247 @@
+/**
+ *******************************************************************************
+ * @file    jsmn.h
+ * @brief   Host stand-in for the jsmn tokenizer used by DS_UART.c
+ *          Same API and token layout (type, start, end, size) as jsmn in
+ *          its default non-strict mode, without parent links. Only the
+ *          DS_HOST_SIM build picks this file up (sim comes first on the
+ *          include path), the target keeps the real jsmn.
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __JSMN_SIM_H__
+#define __JSMN_SIM_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*===================================================================*
+                        Typedef Structures
+*===================================================================*/
+typedef enum
+{
+    JSMN_UNDEFINED = 0,
+    JSMN_OBJECT = 1,
+    JSMN_ARRAY = 2,
+    JSMN_STRING = 4,
+    JSMN_PRIMITIVE = 8
+} jsmntype_t;
+
+enum jsmnerr
+{
+    JSMN_ERROR_NOMEM = -1,          // Not enough tokens
+    JSMN_ERROR_INVAL = -2,          // Invalid character
+    JSMN_ERROR_PART = -3            // Not a full JSON packet
+};
+
+/* size = children: keys of an object, elements of an array, 1 for a key with its value */
+typedef struct
+{
+    jsmntype_t type;
+    int start;
+    int end;
+    int size;
+} jsmntok_t;
+
+typedef struct
+{
+    unsigned int pos;               // Offset in the JSON text
+    unsigned int toknext;           // Next token to allocate
+    int toksuper;                   // Parent of the next token, -1 = none
+} jsmn_parser;
+
+/*===================================================================*
+                        Tokenizer (Host Only)
+*===================================================================*/
+
+static jsmntok_t * jsmn_alloc_token(jsmn_parser *parser, jsmntok_t *tokens, const size_t num_tokens){
+    jsmntok_t *tok;
+
+    if(parser->toknext >= num_tokens){
+        return NULL;
+    }
+    tok = &tokens[parser->toknext++];
+    tok->start = tok->end = -1;
+    tok->size = 0;
+    return tok;
+}
+
+static int jsmn_parse_primitive(jsmn_parser *parser, const char *js, const size_t len, jsmntok_t *tokens, const size_t num_tokens){
+    jsmntok_t *token;
+    int start = (int)parser->pos;
+
+    for(; parser->pos < len && js[parser->pos] != '\0'; parser->pos++){
+        char c = js[parser->pos];
+        if(c == ':' || c == '\t' || c == '\r' || c == '\n' || c == ' ' || c == ',' || c == ']' || c == '}'){
+            break;
+        }
+        if(c < 32 || c >= 127){
+            parser->pos = (unsigned int)start;
+            return JSMN_ERROR_INVAL;
+        }
+    }
+    if(tokens == NULL){
+        parser->pos--;
+        return 0;
+    }
+    token = jsmn_alloc_token(parser, tokens, num_tokens);
+    if(token == NULL){
+        parser->pos = (unsigned int)start;
+        return JSMN_ERROR_NOMEM;
+    }
+    token->type = JSMN_PRIMITIVE;
+    token->start = start;
+    token->end = (int)parser->pos;
+    parser->pos--;
+    return 0;
+}
+
+static int jsmn_parse_string(jsmn_parser *parser, const char *js, const size_t len, jsmntok_t *tokens, const size_t num_tokens){
+    jsmntok_t *token;
+    int start = (int)parser->pos;
+
+    for(parser->pos++; parser->pos < len && js[parser->pos] != '\0'; parser->pos++){
+        char c = js[parser->pos];
+        if(c == '\"'){
+            if(tokens == NULL){
+                return 0;
+            }
+            token = jsmn_alloc_token(parser, tokens, num_tokens);
+            if(token == NULL){
+                parser->pos = (unsigned int)start;
+                return JSMN_ERROR_NOMEM;
+            }
+            token->type = JSMN_STRING;
+            token->start = start + 1;
+            token->end = (int)parser->pos;
+            return 0;
+        }
+        if(c == '\\' && parser->pos + 1 < len){
+            parser->pos++;                                          // Escaped character, \uXXXX digits are plain text
+        }
+    }
+    parser->pos = (unsigned int)start;
+    return JSMN_ERROR_PART;
+}
+
+static void jsmn_init(jsmn_parser *parser){
+    parser->pos = 0;
+    parser->toknext = 0;
+    parser->toksuper = -1;
+}
+
+/* Returns the number of tokens, or a JSMN_ERROR_ code */
+static int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len, jsmntok_t *tokens, const unsigned int num_tokens){
+    int r, i;
+    int count = (int)parser->toknext;
+    jsmntok_t *token;
+
+    for(; parser->pos < len && js[parser->pos] != '\0'; parser->pos++){
+        char c = js[parser->pos];
+        jsmntype_t type;
+
+        switch(c){
+            case '{': case '[':
+                count++;
+                if(tokens == NULL){
+                    break;
+                }
+                token = jsmn_alloc_token(parser, tokens, num_tokens);
+                if(token == NULL){
+                    return JSMN_ERROR_NOMEM;
+                }
+                if(parser->toksuper != -1){
+                    tokens[parser->toksuper].size++;
+                }
+                token->type = (c == '{') ? JSMN_OBJECT : JSMN_ARRAY;
+                token->start = (int)parser->pos;
+                parser->toksuper = (int)parser->toknext - 1;
+                break;
+            case '}': case ']':
+                if(tokens == NULL){
+                    break;
+                }
+                type = (c == '}') ? JSMN_OBJECT : JSMN_ARRAY;
+                for(i = (int)parser->toknext - 1; i >= 0; i--){
+                    token = &tokens[i];
+                    if(token->start != -1 && token->end == -1){
+                        if(token->type != type){
+                            return JSMN_ERROR_INVAL;
+                        }
+                        parser->toksuper = -1;
+                        token->end = (int)parser->pos + 1;
+                        break;
+                    }
+                }
+                if(i == -1){
+                    return JSMN_ERROR_INVAL;
+                }
+                for(; i >= 0; i--){
+                    token = &tokens[i];
+                    if(token->start != -1 && token->end == -1){
+                        parser->toksuper = i;                       // Innermost container still open
+                        break;
+                    }
+                }
+                break;
+            case '\"':
+                r = jsmn_parse_string(parser, js, len, tokens, num_tokens);
+                if(r < 0){
+                    return r;
+                }
+                count++;
+                if(parser->toksuper != -1 && tokens != NULL){
+                    tokens[parser->toksuper].size++;
+                }
+                break;
+            case '\t': case '\r': case '\n': case ' ':
+                break;
+            case ':':
+                parser->toksuper = (int)parser->toknext - 1;        // The key owns the value
+                break;
+            case ',':
+                if(tokens != NULL && parser->toksuper != -1 &&
+                   tokens[parser->toksuper].type != JSMN_ARRAY && tokens[parser->toksuper].type != JSMN_OBJECT){
+                    for(i = (int)parser->toknext - 1; i >= 0; i--){
+                        if((tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) &&
+                           tokens[i].start != -1 && tokens[i].end == -1){
+                            parser->toksuper = i;
+                            break;
+                        }
+                    }
+                }
+                break;
+            default:
+                r = jsmn_parse_primitive(parser, js, len, tokens, num_tokens);
+                if(r < 0){
+                    return r;
+                }
+                count++;
+                if(parser->toksuper != -1 && tokens != NULL){
+                    tokens[parser->toksuper].size++;
+                }
+                break;
+        }
+    }
+    if(tokens != NULL){
+        for(i = (int)parser->toknext - 1; i >= 0; i--){
+            if(tokens[i].start != -1 && tokens[i].end == -1){
+                return JSMN_ERROR_PART;                             // Unclosed object or array
+            }
+        }
+    }
+    return count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __JSMN_SIM_H__ */
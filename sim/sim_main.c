@@ -0,0 +1,1409 @@
+/**
+*******************************************************************************
+* @file    sim_main.c
+* @brief   Host run of the PFC drivers against the DS_SIM plant
+*          Usage: pfc_sim [seconds] [log.csv]
+*                 pfc_sim --bench      (bus voltage load step benchmark)
+*                 pfc_sim --zc         (zero crossing current spike vs duty ramp length)
+*                 pfc_sim --trip       (EMG / OVV hardware trip, fault snapshot and re-arm)
+*                 pfc_sim --meter      (firmware line cycle metering against the plant)
+*                 pfc_sim --harm       (Goertzel harmonic analyser against IEC 61000-3-2 limits)
+*                 pfc_sim --scope      (pre-trigger capture and its UART dump, decoded back)
+*                 pfc_sim --telemetry  (binary frame encode / decode checks and a live stream)
+*                 pfc_sim --uart       (UART0 receive framing: overruns, lost frames, text / binary mix)
+*                 pfc_sim --pinmux     (APMD_Config() port and clock images against the per-channel code)
+*                 pfc_sim --units      (Hz / ns / Q15 conversions: rounding and range limits)
+*                 pfc_sim --interleave (phase shedding: legs shed and restored, MDOUT and carrier phases)
+*                 pfc_sim --decim      (CIC / boxcar decimators: exact outputs, PMD triggered bus voltage)
+* @version V1.0.0.0
+* $Date:: 2026-10-17 #$
+*
+* @author Hugo Rodrigues
+*******************************************************************************
+*/
+
+#include "DS_SIM.h"
+#include "APMD.h"
+#include "DS_ADC.h"
+#include "DS_PFC.h"
+#include "DS_PROT.h"
+#include "DS_METER.h"
+#include "DS_HARM.h"
+#include "DS_SCOPE.h"
+#include "DS_TLM.h"
+#include "DS_CRC.h"
+#include "DS_UART.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_PWM_HZ                          65000.0     // Fast leg carrier
+#define SIM_DEAD_TIME_NS                    1000        // 1 us (DTR = 40 at 160 MHz)
+#define SIM_VBUS_REF                        400.0       // Bus voltage reference (V)
+#define SIM_ZC_DEFAULT                      true        // Slow leg on PMD1 with the zero crossing sequence
+
+/* Load step benchmark */
+#define SIM_BENCH_SETTLE_S                  0.6         // Start up at half load
+#define SIM_BENCH_STEP_S                    0.4         // Observation after each step
+#define SIM_BENCH_BAND                      0.01        // Settled within +-1% of the reference
+#define SIM_BENCH_AVG_S                     0.01        // Bus voltage averaged over one half line cycle
+
+/* Zero crossing sweep */
+#define SIM_ZC_SETTLE_S                     0.4         // Start up and PLL lock
+#define SIM_ZC_CYCLES                       20          // Line cycles measured per case
+
+/* Protection trips */
+#define SIM_TRIP_SETTLE_S                   0.4         // Start up at 1 kW
+#define SIM_TRIP_WAIT_S                     0.05        // Longest wait for the trip, then for the release
+#define SIM_TRIP_HOLD_S                     0.005       // Hold off after the fault is removed (bus sags ~15 V at 1 kW)
+#define SIM_TRIP_RUN_S                      0.3         // Restart after the re-arm
+#define SIM_TRIP_VBUS_V                     (PROT_VBUS_MAX_DEFAULT / SIM_ADC_VBUS_GAIN)
+
+/* Metering, loop samples are Q15 (DS_PFC.h scaling) */
+#define SIM_METER_SETTLE_S                  0.4
+#define SIM_METER_CYCLES                    4
+#define SIM_METER_V_LSB                     (SIM_ADC_VAC_GAIN * (1 << PFC_VAC_SHIFT))     // LSB per V
+#define SIM_METER_I_LSB                     (SIM_ADC_I_GAIN * (1 << PFC_IL_SHIFT))        // LSB per A
+#define SIM_METER_V_TOL                     0.005       // Vrms, relative
+#define SIM_METER_I_TOL                     0.02        // Irms, relative
+#define SIM_METER_P_TOL                     0.01        // Real power, relative
+#define SIM_METER_PF_TOL                    0.005       // Power factor, absolute
+#define SIM_METER_THD_TOL                   0.01        // THD h2-h40, absolute (1 point)
+#define SIM_METER_F_TOL                     0.05        // Line frequency (Hz)
+
+/* Harmonic analyser */
+#define SIM_HARM_SWEEPS                     2
+#define SIM_HARM_SHOW                       13          // Harmonics listed, all are checked
+
+/* Waveform capture */
+#define SIM_SCOPE_WAIT_S                    0.1         // Longest wait for the trigger and the post-trigger part
+#define SIM_SCOPE_SHOW                      4           // Samples listed each side of the trigger
+
+/* Telemetry */
+#define SIM_TLM_PATTERNS                    4           // Body patterns per length in the round trip
+#define SIM_TLM_FLIPS                       2000        // Single bit errors injected
+#define SIM_TLM_CYCLES                      10          // Line cycles streamed
+#define SIM_TLM_SAMPLES                     (TLM_MAX_BODY / 2)
+
+/* Engineering units */
+#define SIM_UNITS_SWEEP                     100000      // Random values per conversion and clock
+
+/* UART0 receive */
+#define SIM_UART_BAUD                       115200
+#define SIM_UART_VREF                       400         // Value carried by the JSON line of each case
+
+/* Application init: drivers, control loop and protection, then the monitoring modules */
+static void SIM_Firmware_Start(bool zc){
+    int32_t limit[HARM_MAX + 1];
+
+    APMD_Init();
+    setPWM_Form(TSB_PMD0);
+    setPWM_DeadTime_ns(TSB_PMD0, SIM_DEAD_TIME_NS);
+    setPWM_Frequency_Hz(TSB_PMD0, (uint32_t)SIM_PWM_HZ);
+    setPWM_DutyRatio(TSB_PMD0, 'U', 0x0000);
+    ADC_Init(&ADC_Handle_A);
+    PFC_Init();
+    PROT_Init();
+    HARM_Init(0);
+    HARM_Limits_Class_A(limit, PFC_IL_LSB_PER_A);
+    HARM_Set_Limits(limit);
+    SCOPE_Init();
+    PFC_ZC_Enable(zc);
+    PFC_Set_Vbus_Ref((int32_t)(SIM_VBUS_REF * SIM_ADC_VBUS_GAIN) << PFC_VBUS_SHIFT);
+    PFC_Start();
+    MDEN_PWMEN_ENABLE(TSB_PMD0);
+}
+
+static void SIM_Print_Metrics(const SIM_Line_Metrics * m){
+    printf("%5u  Vrms %6.1f  Irms %6.2f  Pin %7.1f  Pout %7.1f  PF %.4f  THD %5.2f%%  Eff %.4f  Vbus %6.1f (%5.1f pp)\n",
+           (unsigned)m->cycle, m->vrms, m->irms, m->p_in, m->p_out, m->pf, 100.0 * m->thd, m->eff,
+           m->vbus_avg, m->vbus_ripple);
+}
+
+/*===================================================================*
+                    Bus Voltage Load Step Benchmark
+*===================================================================*/
+typedef struct
+{
+    const char * name;
+    int32_t kp;
+    int32_t ki;
+    bool filter;
+} SIM_Bench_Case;
+
+typedef struct
+{
+    double v_min;                   // Half cycle averaged bus voltage extremes (V)
+    double v_max;
+    double settle;                  // Last time outside the band after the step (s)
+} SIM_Bench_Result;
+
+/* Runs 'seconds' and tracks the bus voltage averaged over the last half line cycle */
+static void SIM_Bench_Run(double seconds, SIM_Bench_Result * r){
+    static double ring[1024];
+    uint32_t n = (uint32_t)(SIM_BENCH_AVG_S * SIM_PWM_HZ), head = 0, steps = (uint32_t)(seconds * SIM_PWM_HZ);
+    double sum = 0.0, t0 = SIM_Get_State()->t;
+
+    for(uint32_t i = 0; i < n; i++){
+        ring[i] = SIM_Get_State()->vo;
+        sum += ring[i];
+    }
+    r->v_min = 1e9;
+    r->v_max = 0.0;
+    r->settle = 0.0;
+    for(uint32_t k = 0; k < steps; k++){
+        SIM_Step();
+        sum += SIM_Get_State()->vo - ring[head];
+        ring[head] = SIM_Get_State()->vo;
+        head = (head + 1) % n;
+
+        double avg = sum / n;
+        r->v_min = (avg < r->v_min) ? avg : r->v_min;
+        r->v_max = (avg > r->v_max) ? avg : r->v_max;
+        if(fabs(avg - SIM_VBUS_REF) > SIM_BENCH_BAND * SIM_VBUS_REF){
+            r->settle = SIM_Get_State()->t - t0;
+        }
+    }
+}
+
+static int SIM_Bench(void){
+    static const SIM_Bench_Case cases[] = {
+        { "raw Vbus, 10 Hz crossover", 7444, 60, false },     // 0.073 A/V, ripple limited
+        { "half cycle average",        PFC_KP_V_DEFAULT, PFC_KI_V_DEFAULT, true },
+    };
+    SIM_Plant_Config cfg;
+    SIM_Bench_Result up, down;
+
+    printf("Load step 500 W -> 1 kW -> 500 W at %.0f V (half cycle averaged bus voltage, +-%.0f%% band)\n",
+           SIM_VBUS_REF, 100.0 * SIM_BENCH_BAND);
+    printf("%-28s %10s %10s %10s %10s %8s %6s\n", "case", "droop V", "settle ms", "overshoot V", "settle ms", "PF", "THD %");
+    for(uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++){
+        SIM_Default_Config(&cfg);
+        cfg.R_load *= 2.0;
+        if(!SIM_Init(&cfg)){
+            fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+            return 1;
+        }
+        SIM_Firmware_Start(SIM_ZC_DEFAULT);
+        PFC_Set_Voltage_Gains(cases[c].kp, cases[c].ki);
+        PFC_Voltage_Filter_Enable(cases[c].filter);
+
+        SIM_Run(SIM_BENCH_SETTLE_S, 0);
+        SIM_Set_Load(cfg.R_load / 2.0);
+        SIM_Bench_Run(SIM_BENCH_STEP_S, &up);
+        const SIM_Line_Metrics m = *SIM_Get_Metrics();
+        SIM_Set_Load(cfg.R_load);
+        SIM_Bench_Run(SIM_BENCH_STEP_S, &down);
+
+        printf("%-28s %10.1f %10.1f %10.1f %10.1f %8.4f %6.2f\n", cases[c].name,
+               SIM_VBUS_REF - up.v_min, 1e3 * up.settle, down.v_max - SIM_VBUS_REF, 1e3 * down.settle,
+               m.pf, 100.0 * m.thd);
+    }
+    return 0;
+}
+
+/*===================================================================*
+                Zero Crossing Spike vs Duty Ramp Length
+*===================================================================*/
+static struct
+{
+    double i_zc_sum, i_zc_max, thd_sum, thd_max, pf_sum;
+    uint32_t n;
+} SIM_ZC_Acc;
+
+static void SIM_ZC_Cycle(const SIM_Line_Metrics * m){
+    SIM_ZC_Acc.i_zc_sum += m->i_zc;
+    SIM_ZC_Acc.i_zc_max = (m->i_zc > SIM_ZC_Acc.i_zc_max) ? m->i_zc : SIM_ZC_Acc.i_zc_max;
+    SIM_ZC_Acc.thd_sum += m->thd;
+    SIM_ZC_Acc.thd_max = (m->thd > SIM_ZC_Acc.thd_max) ? m->thd : SIM_ZC_Acc.thd_max;
+    SIM_ZC_Acc.pf_sum += m->pf;
+    SIM_ZC_Acc.n++;
+}
+
+static int SIM_ZC_Sweep(void){
+    static const int32_t ramps[] = { -1, 0, 2, 4, 8, 16, 32, 64, 128 };    // -1 = no sequence
+    SIM_Plant_Config cfg;
+    char name[32];
+
+    printf("Zero crossing sequence at 1 kW, blank %u / dead zone %u carrier periods, %u line cycles after %.1f s\n",
+           PFC_ZC_BLANK_DEFAULT, PFC_ZC_DEAD_DEFAULT, SIM_ZC_CYCLES, SIM_ZC_SETTLE_S);
+    printf("%-24s %12s %12s %8s %8s %8s\n", "duty ramp", "i_zc mean A", "i_zc max A", "THD %", "max %", "PF");
+    for(uint32_t c = 0; c < sizeof(ramps) / sizeof(ramps[0]); c++){
+        SIM_Default_Config(&cfg);
+        if(!SIM_Init(&cfg)){
+            fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+            return 1;
+        }
+        SIM_Firmware_Start(ramps[c] >= 0);
+        if(ramps[c] >= 0){
+            PFC_Set_ZC_Sequence(PFC_ZC_BLANK_DEFAULT, PFC_ZC_DEAD_DEFAULT, (uint16_t)ramps[c]);
+            snprintf(name, sizeof(name), "%d periods (%.0f us)", (int)ramps[c], 1e6 * ramps[c] / SIM_PWM_HZ);
+        }
+        else {
+            snprintf(name, sizeof(name), "no sequence");
+        }
+        SIM_Run(SIM_ZC_SETTLE_S, 0);
+        memset(&SIM_ZC_Acc, 0, sizeof(SIM_ZC_Acc));
+        SIM_Run(SIM_ZC_CYCLES / cfg.f_line, SIM_ZC_Cycle);
+
+        printf("%-24s %12.2f %12.2f %8.2f %8.2f %8.4f\n", name,
+               SIM_ZC_Acc.i_zc_sum / SIM_ZC_Acc.n, SIM_ZC_Acc.i_zc_max,
+               100.0 * SIM_ZC_Acc.thd_sum / SIM_ZC_Acc.n, 100.0 * SIM_ZC_Acc.thd_max, SIM_ZC_Acc.pf_sum / SIM_ZC_Acc.n);
+    }
+    return 0;
+}
+
+/*===================================================================*
+                    EMG / OVV Trip and Re-arm
+*===================================================================*/
+typedef struct
+{
+    const char * name;
+    bool emg;                       // Fault shows as over-current (EMG), else as bus over-voltage (OVV)
+    int8_t half;                    // Over-current injected in this half cycle (+1 / -1), 0 = where the line is
+    bool comparator;                // External EMG comparator fitted, else the ADC monitor 1 alone trips (OVV)
+} SIM_Trip_Case;
+
+/* Steps until the protection trips (time from the fault), worst value in the meantime */
+static bool SIM_Trip_Wait(bool emg, double * t_trip, double * peak){
+    double t0 = SIM_Get_State()->t;
+
+    *peak = 0.0;
+    while(SIM_Get_State()->t < t0 + SIM_TRIP_WAIT_S){
+        const SIM_State * st = SIM_Get_State();
+        double x;
+        SIM_Step();
+        x = emg ? st->il_peak : st->vo;
+        *peak = (x > *peak) ? x : *peak;
+        if(PROT_Get_State() == PROT_TRIPPED){
+            *t_trip = st->t - t0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int SIM_Trip(void){
+    static const SIM_Trip_Case cases[] = {
+        { "bus reference 480 V",        false,  0, true  },
+        { "loop stalled, master on",    true,   0, true  },
+        { "no comparator, +il",         true,   1, false },
+        { "no comparator, -il",         true,  -1, false },
+    };
+    SIM_Plant_Config cfg;
+    uint32_t fail = 0;
+
+    printf("Hardware trips at 1 kW: EMG comparator %.0f A, OVV bus monitor %.0f V, OVV current monitor +/-%.0f A\n",
+           SIM_EMG_TRIP_A, SIM_TRIP_VBUS_V, (PROT_IL_MAX_DEFAULT - SIM_ADC_I_OFFSET) / SIM_ADC_I_GAIN);
+    for(uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++){
+        double t_trip, peak;
+        uint8_t rearm;
+        uint32_t tries = 0;
+
+        SIM_Default_Config(&cfg);
+        cfg.i_trip = cases[c].comparator ? cfg.i_trip : 0.0;
+        if(!SIM_Init(&cfg)){
+            fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+            return 1;
+        }
+        SIM_Firmware_Start(SIM_ZC_DEFAULT);
+        SIM_Run(SIM_TRIP_SETTLE_S, 0);
+        while(cases[c].half * SIM_Get_State()->vac < 100.0 && cases[c].half != 0){
+            SIM_Step();                             // Into the half cycle, clear of the crossing
+        }
+
+        if(cases[c].emg){
+            PFC_Stop();                             // Boost switch of the half cycle held on
+            setPWM_DutyRatio(TSB_PMD0, 'U', (SIM_Get_State()->vac > 0.0) ? 0x0000 : 0x8000);
+        }
+        else {
+            PFC_Set_Vbus_Ref((int32_t)(480.0 * SIM_ADC_VBUS_GAIN) << PFC_VBUS_SHIFT);
+        }
+        if(!SIM_Trip_Wait(cases[c].emg, &t_trip, &peak)){
+            printf("%-26s no trip within %.0f ms\n", cases[c].name, 1e3 * SIM_TRIP_WAIT_S);
+            fail++;
+            continue;
+        }
+        const PROT_Fault * f = PROT_Get_Fault();
+        printf("%-26s source %s%s  fault -> trip %7.3f ms  peak %6.1f %s\n", cases[c].name,
+               (f->source & PROT_SRC_EMG) ? "EMG " : "", (f->source & PROT_SRC_OVV) ? "OVV " : "",
+               1e3 * t_trip, peak, cases[c].emg ? "A" : "V");
+        printf("%-26s snapshot il %4u vbus %4u vac %4u  cmpu 0x%04lX mdout 0x%03lX  zc %u  loop %lu\n", "",
+               f->il, f->vbus, f->vac, (unsigned long)f->cmpu, (unsigned long)f->mdout, f->zc_state,
+               (unsigned long)f->count);
+        if(!cases[c].comparator && (f->source != PROT_SRC_OVV ||
+           (cases[c].half > 0 ? f->il <= PROT_IL_MAX_DEFAULT : f->il >= 2 * PROT_IL_ZERO - PROT_IL_MAX_DEFAULT))){
+            printf("%-26s not the inductor current monitor of the half cycle\n", "");
+            fail++;
+        }
+
+        /* Fault removed: re-arm is refused until both inputs have cleared, restart after the hold off */
+        PFC_Set_Vbus_Ref((int32_t)(SIM_VBUS_REF * SIM_ADC_VBUS_GAIN) << PFC_VBUS_SHIFT);
+        while((rearm = PROT_Rearm()) == PROT_REARM_ERR_INPUT && tries < (uint32_t)(SIM_TRIP_WAIT_S * SIM_PWM_HZ)){
+            SIM_Step();
+            tries++;
+        }
+        SIM_Step();                                 // Release lands at the next carrier period
+        if(rearm != PROT_REARM_OK || PROT_Get_State() != PROT_ARMED){
+            printf("%-26s re-arm failed (%u)\n", "", rearm);
+            fail++;
+            continue;
+        }
+        if(tries < (uint32_t)(SIM_TRIP_HOLD_S * SIM_PWM_HZ)){
+            SIM_Run(SIM_TRIP_HOLD_S - (double)tries / SIM_PWM_HZ, 0);
+        }
+        PFC_Start();
+        SIM_Run(SIM_TRIP_RUN_S, 0);
+        const SIM_Line_Metrics * m = SIM_Get_Metrics();
+        printf("%-26s re-arm refused %lu times, accepted %5.2f ms after the fault was removed\n", "",
+               (unsigned long)tries, 1e3 * tries / SIM_PWM_HZ);
+        printf("%-26s restart after the %.0f ms hold off: Vbus %6.1f  PF %.4f  THD %5.2f%%  trips %lu\n", "",
+               1e3 * SIM_TRIP_HOLD_S, m->vbus_avg, m->pf, 100.0 * m->thd, (unsigned long)PROT_Get_Trips());
+    }
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                    Line Cycle Metering Check
+*===================================================================*/
+/* Firmware against the plant on the line side of the input filter (carrier period averages),
+   the switching ripple in the plant's Irms and PF never reaches a meter there */
+static bool SIM_Meter_Within(double got, double want, double tol){
+    return fabs(got - want) <= tol;
+}
+
+static uint32_t SIM_Meter_Check(const SIM_Line_Metrics * m, const METER_Result * r, double f_line){
+    double vrms = r->vrms / SIM_METER_V_LSB, irms = r->irms / SIM_METER_I_LSB;
+    double p = r->p * 32768.0 / (SIM_METER_V_LSB * SIM_METER_I_LSB);
+    double pf = r->pf / 32768.0, thd = r->thd / 32768.0, f = r->freq / 256.0;
+    bool pass = SIM_Meter_Within(vrms, m->vrms, SIM_METER_V_TOL * m->vrms) &&
+                SIM_Meter_Within(irms, m->irms_line, SIM_METER_I_TOL * m->irms_line) &&
+                SIM_Meter_Within(p, m->p_in, SIM_METER_P_TOL * m->p_in) &&
+                SIM_Meter_Within(pf, m->pf_line, SIM_METER_PF_TOL) &&
+                SIM_Meter_Within(thd, m->thd, SIM_METER_THD_TOL) &&
+                SIM_Meter_Within(f, f_line, SIM_METER_F_TOL);
+
+    printf("  plant     Vrms %6.1f  Irms %5.2f  P %7.1f  PF %.4f  THD %5.2f%%  (ripple included: Irms %5.2f  PF %.4f)\n",
+           m->vrms, m->irms_line, m->p_in, m->pf_line, 100.0 * m->thd, m->irms, m->pf);
+    printf("  firmware  Vrms %6.1f  Irms %5.2f  P %7.1f  PF %.4f  THD %5.2f%%  f %6.2f Hz  (%lu samples, all but h1 %5.2f%%)  %s\n",
+           vrms, irms, p, pf, 100.0 * thd, f, (unsigned long)r->samples, 100.0 * r->dist / 32768.0, pass ? "ok" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+/* THD needs a whole harmonic sweep first, the background loop is polled four times per line cycle */
+static int SIM_Meter(void){
+    static const double lines[][2] = { { 230.0, 50.0 }, { 115.0, 60.0 } };
+    SIM_Plant_Config cfg;
+    uint32_t fail = 0;
+
+    for(uint32_t c = 0; c < sizeof(lines) / sizeof(lines[0]); c++){
+        uint32_t shown = 0;
+
+        SIM_Default_Config(&cfg);
+        cfg.vac_rms = lines[c][0];
+        cfg.f_line = lines[c][1];
+        cfg.R_load *= 2.0;                          // Half load, within the current limit at low line
+        if(!SIM_Init(&cfg)){
+            fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+            return 1;
+        }
+        printf("%.0f V %.0f Hz\n", lines[c][0], lines[c][1]);
+        SIM_Firmware_Start(SIM_ZC_DEFAULT);
+        SIM_Run(SIM_METER_SETTLE_S, 0);
+        METER_Process();                            // Drop the window closed during the settling
+        HARM_Init(0);                               // Its groups were not read meanwhile, limits stay
+        for(uint32_t k = 0; shown < SIM_METER_CYCLES && k < 4 * (HARM_CYCLES + 2 + 2 * SIM_METER_CYCLES); k++){
+            SIM_Run(0.25 / cfg.f_line, 0);
+            HARM_Process();
+            if(METER_Process() && HARM_Get()->sweeps > 0){
+                fail += SIM_Meter_Check(SIM_Get_Metrics(), METER_Get(), cfg.f_line);
+                shown++;
+            }
+        }
+        fail += (shown < SIM_METER_CYCLES) ? SIM_METER_CYCLES - shown : 0;
+    }
+    printf("%lu failed\n", (unsigned long)fail);
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                    Harmonic Analyser Check
+*===================================================================*/
+static uint32_t SIM_Harm_Events;
+
+static void SIM_Harm_Event(uint8_t h, int32_t rms, int32_t limit){
+    SIM_Harm_Events++;
+    printf("  event     h%-2u %6.3f A over %6.3f A\n", h, rms / SIM_METER_I_LSB, limit / SIM_METER_I_LSB);
+}
+
+/* Background loop stand in, polled four times per line cycle so that no group window is replaced unread */
+static void SIM_Harm_Run(double cycles, double f_line){
+    for(uint32_t k = 0; k < (uint32_t)(cycles * 4.0); k++){
+        SIM_Run(0.25 / f_line, 0);
+        HARM_Process();
+    }
+}
+
+/* Class A, then class D at the measured input power with the third harmonic pushed above it */
+static void SIM_Harm_Report(const char * name, const SIM_Line_Metrics * m){
+    const HARM_Result * r = HARM_Get();
+    double worst = 0.0;
+    uint8_t h_worst = 0;
+
+    printf("  %s (%lu sweeps)\n   h    rms A  limit A\n", name, (unsigned long)r->sweeps);
+    for(uint8_t h = 1; h <= HARM_MAX; h++){
+        if(r->limit[h] != HARM_NO_LIMIT && (double)r->rms[h] / r->limit[h] > worst){
+            worst = (double)r->rms[h] / r->limit[h];
+            h_worst = h;
+        }
+        if(h <= SIM_HARM_SHOW){
+            printf("  %2u  %7.3f  %7.3f\n", h, r->rms[h] / SIM_METER_I_LSB, r->limit[h] / SIM_METER_I_LSB);
+        }
+    }
+    printf("  worst h%u at %.0f%% of its limit, over mask 0x%016llX, events %lu\n",
+           h_worst, 100.0 * worst, (unsigned long long)r->over, (unsigned long)SIM_Harm_Events);
+    printf("  THD (h2-h%u)  plant %5.2f%%  firmware %5.2f%%\n", HARM_MAX, 100.0 * m->thd, 100.0 * r->thd / 32768.0);
+}
+
+static int SIM_Harm(void){
+    SIM_Plant_Config cfg;
+    int32_t limit[HARM_MAX + 1];
+    const SIM_Line_Metrics * m;
+    double cycles = (double)SIM_HARM_SWEEPS * HARM_CYCLES + 2.0;   // Plus the crossing that opens the first window
+
+    SIM_Default_Config(&cfg);
+    cfg.R_load *= 2.0;
+    if(!SIM_Init(&cfg)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    printf("%.0f V %.0f Hz, half load\n", cfg.vac_rms, cfg.f_line);
+    SIM_Firmware_Start(SIM_ZC_DEFAULT);
+    SIM_Run(SIM_METER_SETTLE_S, 0);
+
+    HARM_Init(SIM_Harm_Event);                      // Class A limits from SIM_Firmware_Start() stay
+    SIM_Harm_Run(cycles, cfg.f_line);
+    m = SIM_Get_Metrics();
+    SIM_Harm_Report("class A", m);
+
+    HARM_Limits_Class_D(limit, (uint32_t)SIM_METER_I_LSB, (uint32_t)m->p_in);
+    limit[3] = HARM_Get()->rms[3] / 2;
+    HARM_Set_Limits(limit);
+    HARM_Init(SIM_Harm_Event);
+    SIM_Harm_Run(cycles, cfg.f_line);
+    SIM_Harm_Report("class D, h3 limit at half its level", m);
+    return 0;
+}
+
+/*===================================================================*
+                    Waveform Capture Check
+*===================================================================*/
+static uint16_t SIM_LE16(const uint8_t * p){
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* Dump through the UART stand in, decoded and checked as a host tool would */
+static void SIM_Scope_Dump(void){
+    static uint8_t block[SCOPE_HEADER_SIZE + SCOPE_DEPTH * SCOPE_CHANNELS * 2 + 2];
+    uint32_t length = 0, calls = 0, n;
+    uint8_t sum1 = 0, sum2 = 0;
+    const uint8_t * out;
+    bool done;
+
+    do {
+        done = SCOPE_Send(TSB_UART0);
+        out = SIM_UART_Take(&n);                    // The ring drains between calls
+        if(length + n <= sizeof(block)){
+            memcpy(&block[length], out, n);
+        }
+        length += n;
+        calls++;
+    } while(!done && calls < 1000);
+
+    for(uint32_t k = 0; k + 2 < length; k++){
+        sum1 = (uint8_t)((sum1 + block[k]) % 255);
+        sum2 = (uint8_t)((sum2 + sum1) % 255);
+    }
+    uint16_t count = SIM_LE16(&block[6]);
+    uint16_t trigger = SIM_LE16(&block[8]);
+    uint16_t decim = SIM_LE16(&block[10]);
+    printf("  dump %lu bytes in %lu calls, %.4s, %u samples, trigger at %u, decim %u, checksum %s\n",
+           (unsigned long)length, (unsigned long)calls, (const char *)block, count, trigger, decim,
+           (length >= 2 && sum1 == block[length - 2] && sum2 == block[length - 1]) ? "ok" : "BAD");
+    for(int32_t k = (int32_t)trigger - SIM_SCOPE_SHOW; k <= (int32_t)trigger + SIM_SCOPE_SHOW; k++){
+        const uint8_t * p = &block[SCOPE_HEADER_SIZE + (uint32_t)k * SCOPE_CHANNELS * 2];
+
+        if(k < 0 || k >= count){
+            continue;
+        }
+        printf("  %+8.1f us  IL %6.2f A  VAC %7.1f V  VBUS %6.1f V  duty %5.1f%%%s\n",
+               1e6 * (k - (int32_t)trigger) * decim / SIM_PWM_HZ,
+               (SIM_LE16(p) - SIM_ADC_I_OFFSET) / SIM_ADC_I_GAIN, (SIM_LE16(p + 2) - SIM_ADC_VAC_OFFSET) / SIM_ADC_VAC_GAIN,
+               SIM_LE16(p + 4) / SIM_ADC_VBUS_GAIN, 100.0 * SIM_LE16(p + 6) / 32768.0, (k == trigger) ? "  <- trigger" : "");
+    }
+}
+
+static void SIM_Scope_Case(const char * name, const SCOPE_Config * sc, bool trip){
+    double waited = 0.0;
+
+    printf("%s\n", name);
+    SCOPE_Arm(sc);
+    if(trip){
+        PFC_Set_Vbus_Ref((int32_t)(480.0 * SIM_ADC_VBUS_GAIN) << PFC_VBUS_SHIFT);   // OVV as in --trip
+    }
+    while(SCOPE_Get_State() != SCOPE_FROZEN && waited < SIM_SCOPE_WAIT_S){
+        SIM_Run(0.001, 0);
+        waited += 0.001;
+    }
+    if(SCOPE_Get_State() != SCOPE_FROZEN){
+        printf("  no trigger within %.0f ms\n", 1e3 * SIM_SCOPE_WAIT_S);
+        return;
+    }
+    SIM_Scope_Dump();
+}
+
+static int SIM_Scope(void){
+    SIM_Plant_Config cfg;
+    SCOPE_Config zc = { SCOPE_TRIG_ZC, SCOPE_RISING, 0, false, 0, SCOPE_DEPTH / 2, 1 };
+    SCOPE_Config level = { SCOPE_TRIG_LEVEL, SCOPE_RISING, 0, false,
+                           (int32_t)(SIM_ADC_I_OFFSET + 5.0 * SIM_ADC_I_GAIN), SCOPE_DEPTH / 4, 4 };
+    SCOPE_Config fault = { SCOPE_TRIG_FAULT, SCOPE_EITHER, 0, false, 0, 0, 8 };
+
+    SIM_Default_Config(&cfg);
+    if(!SIM_Init(&cfg)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    SIM_Firmware_Start(SIM_ZC_DEFAULT);
+    SIM_Run(SIM_ZC_SETTLE_S, 0);
+    SIM_Scope_Case("rising zero crossing, half pre-trigger", &zc, false);
+    SIM_Scope_Case("inductor current through 5 A, one sample in 4", &level, false);
+    SIM_Scope_Case("bus reference 480 V until the OVV trip, one sample in 8", &fault, true);
+    return 0;
+}
+
+/*===================================================================*
+                    Telemetry Frame Check
+*===================================================================*/
+static uint32_t SIM_Rand = 1;
+
+static uint8_t SIM_Rand_Byte(void){
+    SIM_Rand = SIM_Rand * 1103515245UL + 12345UL;
+    return (uint8_t)(SIM_Rand >> 16);
+}
+
+/* Body bytes of a pattern: zeros, no zero at all, alternating, random */
+static void SIM_TLM_Fill(uint8_t * body, uint8_t length, uint32_t pattern){
+    for(uint8_t k = 0; k < length; k++){
+        body[k] = (pattern == 0) ? 0x00 : (pattern == 1) ? 0xA5 : (pattern == 2) ? (uint8_t)((k & 1) ? 0 : k) : SIM_Rand_Byte();
+    }
+}
+
+/* Host side decoder: frames between delimiters, text outside them is skipped */
+static uint32_t SIM_TLM_Parse(const uint8_t * bytes, uint32_t length, TLM_Message * last, uint32_t * errors, uint32_t * gaps){
+    static int32_t seq = -1;
+    uint32_t frames = 0, start = 0;
+    TLM_Message msg;
+
+    for(uint32_t k = 0; k < length; k++){
+        if(bytes[k] != TLM_DELIMITER){
+            continue;
+        }
+        if(k > start + 1 || (k == start + 1 && bytes[start] != TLM_DELIMITER)){
+            uint32_t from = (bytes[start] == TLM_DELIMITER) ? start + 1 : start;
+
+            if(TLM_Decode(&bytes[from], (uint16_t)(k - from), &msg) == TLM_OK){
+                *gaps += (seq >= 0 && msg.seq != (uint8_t)(seq + 1)) ? 1 : 0;
+                seq = msg.seq;
+                *last = msg;
+                frames++;
+            }
+            else {
+                (*errors)++;
+            }
+        }
+        start = k;
+    }
+    return frames;
+}
+
+static int SIM_Telemetry(void){
+    static const uint8_t check[] = "123456789";
+    uint8_t body[TLM_MAX_BODY], frame[TLM_FRAME_MAX];
+    uint32_t ok = 0, total = 0, caught = 0;
+    TLM_Message msg;
+
+    /* Table against the polynomial bit by bit, every leading byte, and the catalogue check value */
+    uint32_t rows = 0;
+    for(uint32_t b = 0; b < 256; b++){
+        uint8_t byte = (uint8_t)b;
+        uint16_t crc = (uint16_t)(b << 8);
+
+        for(uint8_t k = 0; k < 8; k++){
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        rows += (CRC16_Calc(&byte, 1, 0) == crc) ? 1 : 0;
+    }
+    bool crc_ok = (rows == 256 && CRC16_Calc(check, 9, CRC16_INIT) == 0x29B1);
+    printf("CRC-16/CCITT-FALSE of \"123456789\": 0x%04X (0x29B1 expected), table %lu/256 rows  %s\n",
+           CRC16_Calc(check, 9, CRC16_INIT), (unsigned long)rows, crc_ok ? "ok" : "FAIL");
+
+    /* Round trip over every body length */
+    for(uint32_t len = 0; len <= TLM_MAX_BODY; len++){
+        for(uint32_t pat = 0; pat < SIM_TLM_PATTERNS; pat++){
+            SIM_TLM_Fill(body, (uint8_t)len, pat);
+            uint16_t n = TLM_Encode(TLM_ID_SAMPLES, (uint8_t)len, body, (uint8_t)len, frame);
+            bool clean = (memchr(&frame[1], TLM_DELIMITER, n - 2) == 0);
+
+            total++;
+            if(clean && TLM_Decode(&frame[1], n - 2, &msg) == TLM_OK && msg.id == TLM_ID_SAMPLES &&
+               msg.seq == (uint8_t)len && msg.length == len && memcmp(msg.body, body, len) == 0){
+                ok++;
+            }
+        }
+    }
+    printf("round trip: %lu / %lu frames (body 0 - %u bytes, %u patterns)\n",
+           (unsigned long)ok, (unsigned long)total, TLM_MAX_BODY, SIM_TLM_PATTERNS);
+
+    /* Single bit errors inside the frame */
+    for(uint32_t k = 0; k < SIM_TLM_FLIPS; k++){
+        uint8_t len = (uint8_t)(SIM_Rand_Byte() % (TLM_MAX_BODY + 1));
+        SIM_TLM_Fill(body, len, 3);
+        uint16_t n = TLM_Encode(TLM_ID_SAMPLES, 0, body, len, frame);
+        uint16_t at = 1 + (uint16_t)(SIM_Rand_Byte() * (uint32_t)(n - 2) / 256);
+
+        frame[at] ^= (uint8_t)(1 << (SIM_Rand_Byte() & 7));
+        if(frame[at] == TLM_DELIMITER || TLM_Decode(&frame[1], n - 2, &msg) != TLM_OK){
+            caught++;                               // A new 0x00 splits the frame, neither half decodes
+        }
+    }
+    printf("single bit errors: %lu / %u rejected\n", (unsigned long)caught, SIM_TLM_FLIPS);
+
+    /* Live stream, one status, meter and harmonic frame per line cycle and a sample block per period */
+    SIM_Plant_Config cfg;
+    uint32_t frames = 0, errors = 0, gaps = 0, bytes = 0, length;
+    int16_t samples[SIM_TLM_SAMPLES];
+    char json[320];
+    const uint8_t * out;
+
+    SIM_Default_Config(&cfg);
+    if(!SIM_Init(&cfg)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    SIM_Firmware_Start(SIM_ZC_DEFAULT);
+    TLM_Init();
+    SIM_Run(SIM_METER_SETTLE_S, 0);
+    SIM_UART_Take(&length);
+    for(uint32_t c = 0; c < SIM_TLM_CYCLES; c++){
+        for(uint32_t k = 0; k < SIM_TLM_SAMPLES; k++){
+            SIM_Step();
+            samples[k] = PFC_Get_Status()->il;
+        }
+        SIM_Run(1.0 / cfg.f_line - SIM_TLM_SAMPLES / SIM_PWM_HZ, 0);
+        METER_Process();
+        HARM_Process();
+        TLM_Send_Status(TSB_UART0);
+        TLM_Send_Meter(TSB_UART0);
+        TLM_Send_Harm(TSB_UART0);
+        TLM_Send_Samples(TSB_UART0, samples, SIM_TLM_SAMPLES);
+        out = SIM_UART_Take(&length);
+        bytes += length;
+        frames += SIM_TLM_Parse(out, length, &msg, &errors, &gaps);
+    }
+    printf("live: %lu frames, %lu bytes, %lu bad, %lu sequence gaps\n",
+           (unsigned long)frames, (unsigned long)bytes, (unsigned long)errors, (unsigned long)gaps);
+
+    /* Size against the same content as JSON text */
+    const volatile PFC_Status * st = PFC_Get_Status();
+    int status_json = snprintf(json, sizeof(json),
+        "{\"il\":%d,\"iref\":%d,\"vac\":%d,\"vbus\":%d,\"vl\":%d,\"duty\":%u,\"count\":%lu,\"saturated\":%lu,"
+        "\"vbus_avg\":%d,\"iamp\":%d,\"vpk\":%d,\"window\":%u,\"zc_state\":%u,\"zc_count\":%lu}\n",
+        st->il, st->iref, st->vac, st->vbus, st->vl, st->duty, (unsigned long)st->count, (unsigned long)st->saturated,
+        st->vbus_avg, st->iamp, st->vpk, st->window, st->zc_state, (unsigned long)st->zc_count);
+    int sample_json = 0;
+    for(uint32_t k = 0; k < SIM_TLM_SAMPLES; k++){
+        sample_json += snprintf(json, sizeof(json), "%d,", samples[k]);
+    }
+    sample_json += (int)strlen("{\"il\":[]}\n") - 1;
+    uint16_t status_bin = TLM_Encode(TLM_ID_STATUS, 0, body, 33, frame);
+    uint16_t sample_bin = TLM_Encode(TLM_ID_SAMPLES, 0, body, 2 * SIM_TLM_SAMPLES, frame);
+    printf("status: %u bytes binary, %d as JSON;  %u samples: %u bytes binary, %d as JSON (%.1f x)\n",
+           status_bin, status_json, SIM_TLM_SAMPLES, sample_bin, sample_json, (double)sample_json / sample_bin);
+    return crc_ok ? 0 : 1;
+}
+
+/*===================================================================*
+                    UART0 Receive Framing Check
+*===================================================================*/
+typedef struct
+{
+    uint32_t json;                  // "vref" values decoded
+    int32_t vref;
+    uint32_t objects;               // Outermost objects closed
+    uint32_t binary;                // COBS frames handed over
+    uint32_t binary_ok;             // ... that decode as telemetry
+} SIM_UART_Count;
+
+static SIM_UART_Count SIM_UART_Got;
+
+static void SIM_UART_Vref(const JSON_Field * field){
+    SIM_UART_Got.json++;
+    SIM_UART_Got.vref = field->value.i;
+}
+
+static void SIM_UART_Object(void){
+    SIM_UART_Got.objects++;
+}
+
+static void SIM_UART_Binary(const uint8_t * data, uint16_t length){
+    TLM_Message msg;
+
+    SIM_UART_Got.binary++;
+    SIM_UART_Got.binary_ok += (TLM_Decode(data, length, &msg) == TLM_OK) ? 1 : 0;
+}
+
+static char SIM_UART_Name[JSON_VALUE_MAX + 1];
+
+static void SIM_UART_Text_Value(const JSON_Field * field){
+    memcpy(SIM_UART_Name, field->value.s.ptr, field->value.s.len);
+    SIM_UART_Name[field->value.s.len] = '\0';
+}
+
+static const JSON_Handler SIM_UART_Handlers[] = {
+    { "vref", JSON_INT, 0, SIM_UART_Vref },
+    { "name", JSON_STR, 0, SIM_UART_Text_Value },
+};
+
+static void SIM_UART_Text(const char * text){
+    SIM_UART_Receive((const uint8_t *)text, (uint32_t)strlen(text));
+}
+
+static void SIM_UART_Frame(uint8_t seq){
+    uint8_t body[8] = { 1, 0, 2, 0, 3, 0, 4, 0 }, frame[TLM_FRAME_MAX];
+    uint16_t n = TLM_Encode(TLM_ID_SAMPLES, seq, body, sizeof(body), frame);
+
+    SIM_UART_Receive(frame, n);
+}
+
+/* Half a telemetry frame (opening delimiter included), the rest is lost in an overrun */
+static void SIM_UART_Frame_Head(uint8_t seq){
+    uint8_t body[8] = { 1, 0, 2, 0, 3, 0, 4, 0 }, frame[TLM_FRAME_MAX];
+    uint16_t n = TLM_Encode(TLM_ID_SAMPLES, seq, body, sizeof(body), frame);
+
+    SIM_UART_Receive(frame, n / 2);
+}
+
+static bool SIM_UART_Check(const char * name, uint32_t json, uint32_t binary, uint32_t overrun){
+    uint32_t lost = UART_RX_Overrun;
+    bool pass;
+
+    UART_RX_Process();
+    pass = (SIM_UART_Got.json == json && SIM_UART_Got.objects == json && SIM_UART_Got.binary == binary &&
+            SIM_UART_Got.binary_ok == binary && lost == overrun && (json == 0 || SIM_UART_Got.vref == SIM_UART_VREF));
+    printf("  %-44s json %lu/%lu  binary %lu/%lu  lost %lu/%lu  %s\n", name,
+           (unsigned long)SIM_UART_Got.json, (unsigned long)json, (unsigned long)SIM_UART_Got.binary_ok,
+           (unsigned long)binary, (unsigned long)lost, (unsigned long)overrun, pass ? "ok" : "FAIL");
+    memset(&SIM_UART_Got, 0, sizeof(SIM_UART_Got));
+    UART_RX_Overrun = 0;
+    return pass;
+}
+
+static int SIM_Uart(void){
+    static const char line[] = "{\"vref\":400}\n";
+    char longline[UART_RX_FRAME_MAX + 16];
+    uint32_t fail = 0, length;
+    const uint8_t * out;
+
+    if(!SIM_Init(0)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    UART_Init(TSB_UART0, SIM_UART_BAUD);
+    JSON_Stream_Init(SIM_UART_Handlers, sizeof(SIM_UART_Handlers) / sizeof(SIM_UART_Handlers[0]), SIM_UART_Object);
+    UART_RX_Set_Binary_Handler(SIM_UART_Binary);
+    memset(&SIM_UART_Got, 0, sizeof(SIM_UART_Got));
+
+    printf("UART0 receive, one character per INTSC0RX:\n");
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("JSON line", 1, 0, 0);
+
+    SIM_UART_Text("{\"vref\":1");
+    SIM_UART_Overrun();
+    SIM_UART_Text("23}\n");
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("overrun in a JSON line, then a JSON line", 1, 0, 1);
+
+    SIM_UART_Frame_Head(1);
+    SIM_UART_Overrun();
+    SIM_UART_Text("\x05\x06");
+    SIM_UART_Receive((const uint8_t *)"", 1);
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("overrun in a COBS frame, then a JSON line", 1, 0, 1);
+
+    memset(longline, 'x', sizeof(longline));
+    longline[sizeof(longline) - 1] = '\0';
+    SIM_UART_Frame(2);
+    SIM_UART_Receive((const uint8_t *)"", 1);                       // Binary frame ...
+    SIM_UART_Text(longline);                                        // ... that runs past UART_RX_FRAME_MAX
+    SIM_UART_Receive((const uint8_t *)"", 1);
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("frame too long, then a JSON line", 1, 1, 1);
+
+    for(uint32_t k = 0; k <= UART_RX_FRAME_SLOTS; k++){
+        SIM_UART_Text(line);                                        // No UART_RX_Process() meanwhile
+    }
+    fail += !SIM_UART_Check("one line more than the slots", UART_RX_FRAME_SLOTS, 0, 1);
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("next JSON line", 1, 0, 0);
+
+    SIM_UART_Frame(3);
+    SIM_UART_Text(line);
+    SIM_UART_Frame(4);
+    SIM_UART_Frame(5);
+    fail += !SIM_UART_Check("COBS, JSON, COBS, COBS", 1, 3, 0);
+
+    /* A cut line is dropped at its delimiter (one decoder error), the next line starts clean */
+    uint32_t errors = JSON_Stream_Errors;
+    SIM_UART_Text("{\"vref\":39\n");
+    SIM_UART_Text(line);
+    fail += !SIM_UART_Check("cut JSON line, then a JSON line", 1, 0, 0);
+    bool counted = (JSON_Stream_Errors - errors == 1);
+    printf("  %-44s %lu error  %s\n", "cut JSON line counted", (unsigned long)(JSON_Stream_Errors - errors),
+           counted ? "ok" : "FAIL");
+    fail += !counted;
+
+    /* Keys of nested objects do not reach the handlers, the outer object still completes */
+    SIM_UART_Text("{\"cfg\":{\"vref\":999},\"list\":[1,{\"vref\":998}]}\n");
+    UART_RX_Process();
+    bool inner = (SIM_UART_Got.json == 0 && SIM_UART_Got.objects == 1);
+    printf("  %-44s json %lu/0  objects %lu/1  %s\n", "nested vref keys", (unsigned long)SIM_UART_Got.json,
+           (unsigned long)SIM_UART_Got.objects, inner ? "ok" : "FAIL");
+    fail += !inner;
+    memset(&SIM_UART_Got, 0, sizeof(SIM_UART_Got));
+
+    /* String escapes of the streaming decoder */
+    static const struct { const char * line; const char * text; } esc[] = {
+        { "{\"name\":\"a\\nb\\tc\"}\n",                  "a\nb\tc" },
+        { "{\"name\":\"q\\\"\\\\\\/e\"}\n",              "q\"\\/e" },
+        { "{\"name\":\"\\u0041\\u00e9\\r\"}\n",           "A?\r" },
+    };
+    for(uint32_t k = 0; k < sizeof(esc) / sizeof(esc[0]); k++){
+        SIM_UART_Name[0] = '\0';
+        SIM_UART_Text(esc[k].line);
+        UART_RX_Process();
+        bool same = (strcmp(SIM_UART_Name, esc[k].text) == 0);
+        printf("  string escapes %-29.*s %s\n", (int)strlen(esc[k].line) - 12, esc[k].line + 9, same ? "ok" : "FAIL");
+        fail += !same;
+    }
+    memset(&SIM_UART_Got, 0, sizeof(SIM_UART_Got));
+
+    /* One pass field read: keys of nested values do not match, integers are strict */
+    static const char nested[] = "{\"cfg\":{\"vref\":1,\"kp\":2},\"list\":[{\"vref\":3},4],\"vref\":400,\"kp\":5}";
+    JSON_Field pair[2] = { { "vref", JSON_INT, 0, false, { 0 } }, { "kp", JSON_INT, 0, false, { 0 } } };
+    JSON_Frame_Parse(nested, (uint16_t)strlen(nested));
+    bool outer = (JSON_Frame_Get(pair, 2) == 2 && pair[0].value.i == SIM_UART_VREF && pair[1].value.i == 5);
+    printf("  %-44s %s\n", "JSON_Frame_Get outer keys only", outer ? "ok" : "FAIL");
+    fail += !outer;
+
+    static const struct { const char * text; bool valid; int32_t value; } ints[] = {
+        { "2147483647", true, 2147483647 },  { "2147483648", false, 0 },
+        { "-2147483648", true, (-2147483647 - 1) }, { "-2147483649", false, 0 },
+        { "99999999999", false, 0 },         { "true", true, 1 },
+        { "false", true, 0 },                { "trux", false, 0 },
+        { "fals3", false, 0 },               { "-", false, 0 },
+    };
+    uint32_t strict = 0;
+    for(uint32_t k = 0; k < sizeof(ints) / sizeof(ints[0]); k++){
+        char text[48];
+        int len = sprintf(text, "{\"vref\":%s}", ints[k].text);
+        JSON_Field field = { "vref", JSON_INT, 0, false, { 0 } };
+
+        JSON_Frame_Parse(text, (uint16_t)len);
+        JSON_Frame_Get(&field, 1);
+        strict += (field.found == ints[k].valid && (!field.found || field.value.i == ints[k].value)) ? 1 : 0;
+    }
+    printf("  %-44s %lu/%lu %s\n", "JSON_INT range and literals", (unsigned long)strict,
+           (unsigned long)(sizeof(ints) / sizeof(ints[0])), (strict == sizeof(ints) / sizeof(ints[0])) ? "ok" : "FAIL");
+    fail += (strict != sizeof(ints) / sizeof(ints[0]));
+
+    /* Legacy read_json_parse(): whole values or an error, never a cut value */
+    char frame[bufferSize], * value;
+    int at = sprintf(frame, "{\"mode\":\"");
+    for(uint32_t k = 0; k < 100; k++){
+        frame[at++] = (char)('a' + k % 26);
+    }
+    sprintf(&frame[at], "\",\"vref\":400}");
+    value = read_json_parse(frame, "mode");
+    bool whole = (value != 0 && strlen(value) == 101 && value[100] == '\n');
+    printf("  %-44s %s\n", "read_json_parse 100 character value", whole ? "ok" : "FAIL");
+    fail += !whole;
+
+    at = sprintf(frame, "{");
+    for(uint32_t k = 0; k < 20; k++){
+        at += sprintf(&frame[at], "%s\"k%lu\":%lu", (k == 0) ? "" : ",", (unsigned long)k, (unsigned long)k);
+    }
+    sprintf(&frame[at], "}");
+    value = read_json_parse(frame, "k19");
+    printf("  %-44s %s\n", "read_json_parse 20 pairs refused", (value == 0) ? "ok" : "FAIL");
+    fail += (value != 0);
+    value = read_json_parse("{\"vref\":400}", "none");
+    printf("  %-44s %s\n", "read_json_parse missing key", (value != 0 && value[0] == '\0') ? "ok" : "FAIL");
+    fail += (value == 0 || value[0] != '\0');
+
+    /* Transmit side: a reply through the ring and INTSC0TX */
+    bool sent = sendUART(TSB_UART0, (char *)line);
+    out = SIM_UART_Take(&length);
+    bool echo = (sent && length == strlen(line) && memcmp(out, line, length) == 0);
+    printf("  %-44s %lu bytes  %s\n", "reply through INTSC0TX", (unsigned long)length, echo ? "ok" : "FAIL");
+    fail += !echo;
+
+    /* A full ring refuses the reply whole and says so */
+    uint32_t queued = 0, dropped = UART_TX_Dropped;
+    while(sendUART(TSB_UART0, longline)){
+        queued++;
+    }
+    out = SIM_UART_Take(&length);
+    bool refused = (UART_TX_Dropped == dropped + 1 && length == queued * strlen(longline) && sendUART(TSB_UART0, (char *)line));
+    printf("  %-44s %lu queued  %s\n", "reply refused on a full ring", (unsigned long)queued, refused ? "ok" : "FAIL");
+    fail += !refused;
+    SIM_UART_Take(&length);
+
+    printf("%lu failed\n", (unsigned long)fail);
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                    A-PMD Pin-Mux Register Images
+*===================================================================*/
+/* Port pins 0..5 (CR, FR4, FR6), PORTMD and the clock gates after APMD_Config() from
+   a cleared or a set port, as the per-channel branches wrote them before the pin-mux
+   tables. PMD0 has no FR6 on port B (a spare word stands in) */
+typedef struct
+{
+    uint8_t cr;
+    uint8_t fr4;
+    uint8_t fr6;
+    uint32_t portmd;
+    uint32_t fsysmena;
+    uint32_t fsysmenb;
+    uint32_t fsysena;
+} SIM_PinMux_Image;
+
+static const SIM_PinMux_Image SIM_PinMux_Golden[APMD_CHANNELS * 4 * 2 * 2] = {
+    { 0x00, 0x00, 0x00, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 0 phase, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 0 phase, pins set
+    { 0x00, 0x00, 0x00, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 0 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 0 phase + comp, pins set
+    { 0x01, 0x01, 0x00, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 1 phase, pins clear
+    { 0x3D, 0x3D, 0x3F, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 1 phase, pins set
+    { 0x03, 0x03, 0x00, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 1 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 1 phase + comp, pins set
+    { 0x05, 0x05, 0x00, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 2 phase, pins clear
+    { 0x35, 0x35, 0x3F, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 2 phase, pins set
+    { 0x0F, 0x0F, 0x00, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 2 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 2 phase + comp, pins set
+    { 0x15, 0x15, 0x00, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 3 phase, pins clear
+    { 0x15, 0x15, 0x3F, 0x2, 0x00002, 0x0200, 0x2 },   // PMD0 3 phase, pins set
+    { 0x3F, 0x3F, 0x00, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 3 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00002, 0x0200, 0x2 },   // PMD0 3 phase + comp, pins set
+    { 0x00, 0x00, 0x00, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 0 phase, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 0 phase, pins set
+    { 0x00, 0x00, 0x00, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 0 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 0 phase + comp, pins set
+    { 0x01, 0x00, 0x01, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 1 phase, pins clear
+    { 0x3D, 0x3F, 0x3D, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 1 phase, pins set
+    { 0x03, 0x00, 0x03, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 1 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 1 phase + comp, pins set
+    { 0x05, 0x00, 0x05, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 2 phase, pins clear
+    { 0x35, 0x3F, 0x35, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 2 phase, pins set
+    { 0x0F, 0x00, 0x0F, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 2 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 2 phase + comp, pins set
+    { 0x15, 0x00, 0x15, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 3 phase, pins clear
+    { 0x15, 0x1F, 0x35, 0x2, 0x00010, 0x0400, 0x0 },   // PMD1 3 phase, pins set
+    { 0x3F, 0x20, 0x1F, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 3 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x00010, 0x0400, 0x0 },   // PMD1 3 phase + comp, pins set
+    { 0x00, 0x00, 0x00, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 0 phase, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 0 phase, pins set
+    { 0x00, 0x00, 0x00, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 0 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 0 phase + comp, pins set
+    { 0x01, 0x00, 0x01, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 1 phase, pins clear
+    { 0x3D, 0x3F, 0x3D, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 1 phase, pins set
+    { 0x03, 0x00, 0x03, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 1 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 1 phase + comp, pins set
+    { 0x05, 0x00, 0x05, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 2 phase, pins clear
+    { 0x35, 0x3F, 0x35, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 2 phase, pins set
+    { 0x0F, 0x00, 0x0F, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 2 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 2 phase + comp, pins set
+    { 0x15, 0x00, 0x15, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 3 phase, pins clear
+    { 0x15, 0x3F, 0x15, 0x2, 0x10000, 0x0800, 0x0 },   // PMD2 3 phase, pins set
+    { 0x3F, 0x00, 0x3F, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 3 phase + comp, pins clear
+    { 0x3F, 0x3F, 0x3F, 0x3, 0x10000, 0x0800, 0x0 },   // PMD2 3 phase + comp, pins set
+};
+
+static int SIM_PinMux(void){
+    static uint32_t spare;
+    TSB_PMD_TypeDef * const pmd[APMD_CHANNELS] = { TSB_PMD0, TSB_PMD1, TSB_PMD2 };
+    volatile uint32_t * const cr[APMD_CHANNELS] = { &TSB_PB->CR, &TSB_PE->CR, &TSB_PU->CR };
+    volatile uint32_t * const fr4[APMD_CHANNELS] = { &TSB_PB->FR4, &TSB_PE->FR4, &TSB_PU->FR4 };
+    volatile uint32_t * const fr6[APMD_CHANNELS] = { &spare, &TSB_PE->FR6, &TSB_PU->FR6 };
+    uint32_t n = 0, fail = 0;
+
+    if(!SIM_Init(0)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    for(uint32_t c = 0; c < APMD_CHANNELS; c++){
+        uint32_t bad = 0;
+
+        for(uint8_t phase = 0; phase <= APMD_PHASES_MAX; phase++){
+            for(uint32_t comp = 0; comp < 2; comp++){
+                for(uint32_t set = 0; set < 2; set++, n++){
+                    uint32_t start = set ? 0x3F : 0x00;
+                    const SIM_PinMux_Image * g = &SIM_PinMux_Golden[n];
+                    SIM_PinMux_Image got;
+
+                    SIM_BitBand_Sync();
+                    TSB_CG->FSYSMENA = 0;
+                    TSB_CG->FSYSMENB = 0;
+                    TSB_CG->FSYSENA = 0;
+                    pmd[c]->PORTMD = 0;
+                    *cr[c] = start;
+                    *fr4[c] = start;
+                    *fr6[c] = start;
+                    APMD_Config(pmd[c], phase, comp != 0);
+                    SIM_BitBand_Sync();
+
+                    got.cr = (uint8_t)(*cr[c] & 0x3F);
+                    got.fr4 = (uint8_t)(*fr4[c] & 0x3F);
+                    got.fr6 = (uint8_t)(*fr6[c] & 0x3F);
+                    got.portmd = pmd[c]->PORTMD;
+                    got.fsysmena = TSB_CG->FSYSMENA;
+                    got.fsysmenb = TSB_CG->FSYSMENB;
+                    got.fsysena = TSB_CG->FSYSENA;
+                    if(got.cr != g->cr || got.fr4 != g->fr4 || got.fr6 != g->fr6 || got.portmd != g->portmd ||
+                       got.fsysmena != g->fsysmena || got.fsysmenb != g->fsysmenb || got.fsysena != g->fsysena){
+                        printf("  PMD%lu %u phase%s, pins %s: CR %02X FR4 %02X FR6 %02X PORTMD %lX  expected CR %02X FR4 %02X FR6 %02X PORTMD %lX\n",
+                               (unsigned long)c, phase, comp ? " + comp" : "", set ? "set" : "clear",
+                               got.cr, got.fr4, got.fr6, (unsigned long)got.portmd, g->cr, g->fr4, g->fr6, (unsigned long)g->portmd);
+                        bad++;
+                    }
+                }
+            }
+        }
+        printf("PMD%lu: %lu / 16 register images match\n", (unsigned long)c, (unsigned long)(16 - bad));
+        fail += bad;
+    }
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                Engineering Unit Conversions (APMD.c)
+*===================================================================*/
+typedef struct
+{
+    const char * name;
+    int64_t input;
+    uint32_t expected;
+} SIM_Units_Case;
+
+/* Exact RATE = Hz * 2^24 / fsys and DTR = ns * fsys / 4e9, rounded and limited as the registers take them */
+static double SIM_Units_Rate(uint32_t hz){
+    return ((double)hz * 16777216.0) / (double)SystemCoreClock;
+}
+
+static double SIM_Units_DTR(uint32_t ns){
+    return ((double)ns * (double)SystemCoreClock) / 4.0e9;
+}
+
+/* The 32.32 scale factors are rounded to 1/2^32, off by input / 2^33 LSB at most: near x.5 either neighbour is right */
+static bool SIM_Units_Match(uint32_t got, double exact, uint32_t input, uint32_t min, uint32_t max){
+    double lo = floor(exact + 0.5), hi = lo;
+    double tie = (double)input / 8589934592.0 + 1e-9;
+
+    if(fabs(exact - floor(exact) - 0.5) <= tie){
+        lo = floor(exact);
+        hi = lo + 1.0;
+    }
+    lo = (lo < min) ? min : ((lo > max) ? max : lo);
+    hi = (hi < min) ? min : ((hi > max) ? max : hi);
+    return (got == (uint32_t)lo || got == (uint32_t)hi);
+}
+
+static uint32_t SIM_Units_Table(const char * what, const SIM_Units_Case * cases, uint32_t count, uint32_t (*convert)(int64_t)){
+    uint32_t fail = 0;
+
+    for(uint32_t k = 0; k < count; k++){
+        uint32_t got = convert(cases[k].input);
+        bool pass = (got == cases[k].expected);
+
+        printf("  %-5s %-30s %11lld -> 0x%06lX  (0x%06lX)  %s\n", what, cases[k].name, (long long)cases[k].input,
+               (unsigned long)got, (unsigned long)cases[k].expected, pass ? "ok" : "FAIL");
+        fail += !pass;
+    }
+    return fail;
+}
+
+static uint32_t SIM_Units_Hz(int64_t v){ return APMD_Hz_To_RATE((uint32_t)v); }
+static uint32_t SIM_Units_ns(int64_t v){ return APMD_ns_To_DTR((uint32_t)v); }
+static uint32_t SIM_Units_Q15(int64_t v){ return APMD_Q15_To_Duty((int32_t)v); }
+
+static int SIM_Units(void){
+    /* Expected at 160 MHz: RATE LSB 9.537 Hz, DTR LSB 25 ns */
+    static const SIM_Units_Case hz[] = {
+        { "0 Hz, counter kept running", 0, 0x000001 },
+        { "1 Hz, below one LSB", 1, 0x000001 },
+        { "14 Hz, 1.47 LSB rounds down", 14, 0x000001 },
+        { "15 Hz, 1.57 LSB rounds up", 15, 0x000002 },
+        { "65 kHz carrier", 65000, 6816 },
+        { "last value below RATE_MAX", 159999980, 0xFFFFFE },
+        { "rounds up onto RATE_MAX", 159999990, 0xFFFFFF },
+        { "fsys, clamped", 160000000, 0xFFFFFF },
+        { "above fsys, clamped", 4294967295LL, 0xFFFFFF },
+    };
+    static const SIM_Units_Case ns[] = {
+        { "0 ns", 0, 0 },
+        { "12 ns, 0.48 LSB rounds down", 12, 0 },
+        { "13 ns, 0.52 LSB rounds up", 13, 1 },
+        { "1 us", 1000, 40 },
+        { "DTR_MAX exactly", 25575, 0x3FF },
+        { "1023.48 LSB rounds down", 25587, 0x3FF },
+        { "1023.52 LSB, clamped", 25588, 0x3FF },
+        { "30 us, clamped", 30000, 0x3FF },
+        { "UINT32_MAX, clamped", 4294967295LL, 0x3FF },
+    };
+    static const SIM_Units_Case q15[] = {
+        { "INT32_MIN, clamped to 0%", -2147483647LL - 1, 0 },
+        { "-1, clamped to 0%", -1, 0 },
+        { "0%", 0, 0 },
+        { "one LSB", 1, 1 },
+        { "50%", 0x4000, 0x4000 },
+        { "one LSB below 100%", 0x7FFF, 0x7FFF },
+        { "100%", 0x8000, 0x8000 },
+        { "above 100%, clamped", 0x8001, 0x8000 },
+        { "INT32_MAX, clamped", 2147483647LL, 0x8000 },
+    };
+    static const uint32_t clocks[] = { 160000000UL, 80000000UL, 120000000UL };
+    uint32_t fail = 0;
+
+    if(!SIM_Init(0)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    APMD_Units_Init();
+    printf("fsys %lu Hz:\n", (unsigned long)SystemCoreClock);
+    fail += SIM_Units_Table("RATE", hz, sizeof(hz) / sizeof(hz[0]), SIM_Units_Hz);
+    fail += SIM_Units_Table("DTR", ns, sizeof(ns) / sizeof(ns[0]), SIM_Units_ns);
+    fail += SIM_Units_Table("duty", q15, sizeof(q15) / sizeof(q15[0]), SIM_Units_Q15);
+
+    /* The setters write the converted value, dead time leaves the PWM stopped */
+    MDEN_PWMEN_ENABLE(TSB_PMD0);
+    setPWM_Frequency_Hz(TSB_PMD0, 65000);
+    setPWM_DeadTime_ns(TSB_PMD0, 1000);
+    setPWM_DutyRatio_Q15(TSB_PMD0, 'U', 0x8001);
+    bool regs = (TSB_PMD0->RATE == 6816 && TSB_PMD0->DTR == 40 && TSB_PMD0->CMPU == 0x8000 && (TSB_PMD0->MDEN & 0x01) == 0);
+    printf("  setters: RATE %lu  DTR %lu  CMPU 0x%04lX  MDEN %lu  %s\n", (unsigned long)TSB_PMD0->RATE,
+           (unsigned long)TSB_PMD0->DTR, (unsigned long)TSB_PMD0->CMPU, (unsigned long)TSB_PMD0->MDEN, regs ? "ok" : "FAIL");
+    fail += !regs;
+
+    /* Random inputs against the exact conversion, every clock */
+    for(uint32_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++){
+        uint32_t bad_rate = 0, bad_dtr = 0;
+
+        SystemCoreClock = clocks[c];
+        APMD_Units_Init();
+        for(uint32_t k = 0; k < SIM_UNITS_SWEEP; k++){
+            uint32_t r = ((uint32_t)SIM_Rand_Byte() << 24) | ((uint32_t)SIM_Rand_Byte() << 16) |
+                         ((uint32_t)SIM_Rand_Byte() << 8) | SIM_Rand_Byte();
+            uint32_t f = r % (SystemCoreClock + 1);
+            uint32_t t = r % 40000;
+
+            bad_rate += !SIM_Units_Match(APMD_Hz_To_RATE(f), SIM_Units_Rate(f), f, 1, APMD_RATE_MAX);
+            bad_dtr += !SIM_Units_Match(APMD_ns_To_DTR(t), SIM_Units_DTR(t), t, 0, APMD_DTR_MAX);
+        }
+        printf("fsys %9lu Hz: %u random Hz and ns values, RATE %lu off, DTR %lu off  %s\n",
+               (unsigned long)SystemCoreClock, SIM_UNITS_SWEEP, (unsigned long)bad_rate, (unsigned long)bad_dtr,
+               (bad_rate + bad_dtr == 0) ? "ok" : "FAIL");
+        fail += bad_rate + bad_dtr;
+    }
+    SystemCoreClock = clocks[0];
+    APMD_Units_Init();
+    printf("%lu failed\n", (unsigned long)fail);
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                    Interleaved Leg Shedding
+*===================================================================*/
+typedef struct
+{
+    uint32_t load;                  // Per mille of one leg (APMD_LOAD_LEG)
+    uint8_t active;
+    uint32_t mdout;                 // Output control of U, V, W (xPWM | xOC)
+    uint32_t vph;
+    uint32_t wph;
+} SIM_Interleave_Case;
+
+/* PMD2 with three legs: shed to one through the hysteresis band and back, the restored legs
+   must switch again (xPWM and both outputs) on the spread carriers */
+static int SIM_Interleave(void){
+    static const SIM_Interleave_Case cases[] = {
+        { 2500, 3, 0x73F, APMD_PHASE_PERIOD / 3, 2 * (APMD_PHASE_PERIOD / 3) },
+        { 1000, 2, 0x30F, APMD_PHASE_PERIOD / 2, 0 },
+        {  500, 1, 0x103, 0, 0 },
+        {  700, 1, 0x103, 0, 0 },                   // Inside the band, no change
+        {  900, 2, 0x30F, APMD_PHASE_PERIOD / 2, 0 },
+        { 2000, 3, 0x73F, APMD_PHASE_PERIOD / 3, 2 * (APMD_PHASE_PERIOD / 3) },
+        {  100, 2, 0x30F, APMD_PHASE_PERIOD / 2, 0 },   // One leg per call
+        {  100, 1, 0x103, 0, 0 },
+        { 3000, 2, 0x30F, APMD_PHASE_PERIOD / 2, 0 },
+        { 3000, 3, 0x73F, APMD_PHASE_PERIOD / 3, 2 * (APMD_PHASE_PERIOD / 3) },
+    };
+    const uint32_t mask = MDOUT_UOC_MASK | MDOUT_VOC_MASK | MDOUT_WOC_MASK | MDOUT_UPWM_MASK | MDOUT_VPWM_MASK | MDOUT_WPWM_MASK;
+    APMD_Interleave il;
+    uint32_t fail = 0;
+
+    if(!SIM_Init(0)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    APMD_Interleave_Init(&il, TSB_PMD2, 3);
+    printf("PMD2, 3 legs: active %u  MDOUT 0x%03lX\n", il.active, (unsigned long)(TSB_PMD2->MDOUT & mask));
+    fail += (il.active != 3 || (TSB_PMD2->MDOUT & mask) != 0x73F);
+    for(uint32_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++){
+        uint8_t n = APMD_Interleave_Update(&il, cases[k].load * APMD_LOAD_LEG / 1000);
+        uint32_t mdout = TSB_PMD2->MDOUT & mask;
+        bool pass = (n == cases[k].active && mdout == cases[k].mdout &&
+                     TSB_PMD2->VPWMPH == cases[k].vph && TSB_PMD2->WPWMPH == cases[k].wph);
+
+        printf("  load %4.2f legs -> %u active  MDOUT 0x%03lX  VPWMPH %5lu  WPWMPH %5lu  %s\n", cases[k].load / 1000.0, n,
+               (unsigned long)mdout, (unsigned long)TSB_PMD2->VPWMPH, (unsigned long)TSB_PMD2->WPWMPH, pass ? "ok" : "FAIL");
+        fail += !pass;
+    }
+    printf("%lu failed\n", (unsigned long)fail);
+    return (fail == 0) ? 0 : 1;
+}
+
+/*===================================================================*
+                    Oversampling and Decimation
+*===================================================================*/
+typedef struct
+{
+    uint8_t rate_log2;
+    uint8_t order;
+    uint8_t extra_bits;
+} SIM_Decim_Case;
+
+/* Input repeating every 16 samples, 11 x 1000 and 5 x 1001 (mean 1000.3125): every CIC stage
+   spans whole periods, so each settled output is exactly floor(1000.3125 * 2^extra_bits) */
+static uint16_t SIM_Decim_Input(uint32_t k){
+    return (uint16_t)(((k * 5) % 16 < 5) ? 1001 : 1000);
+}
+
+static int SIM_Decim(void){
+    static const SIM_Decim_Case cases[] = {
+        { 4, 1, 2 }, { 8, 1, 4 }, { 6, 2, 4 }, { 5, 3, 4 }, { 16, 1, 4 }, { 20, 1, 4 }, { 10, 2, 0 },
+    };
+    ADC_Decimator dec, vbus;
+    SIM_Plant_Config cfg;
+    uint32_t fail = 0;
+
+    for(uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++){
+        uint32_t outputs = cases[c].order + 2, expected = (uint32_t)(1000.3125 * (1 << cases[c].extra_bits));
+        uint32_t count = 0;
+        bool pass = ADC_Decim_Init(&dec, 0, cases[c].rate_log2, cases[c].order, cases[c].extra_bits);
+
+        for(uint32_t k = 0; pass && k < (outputs << cases[c].rate_log2); k++){
+            count += ADC_Decim_Push(&dec, SIM_Decim_Input(k));
+        }
+        pass = pass && (count == outputs) && (dec.count == outputs) && (dec.out == expected);
+        printf("  order %u  ratio 2^%-2u  +%u bits: %lu outputs, last %6lu (%6lu)  %s\n", cases[c].order, cases[c].rate_log2,
+               cases[c].extra_bits, (unsigned long)count, (unsigned long)dec.out, (unsigned long)expected, pass ? "ok" : "FAIL");
+        fail += !pass;
+    }
+    bool refused = !ADC_Decim_Init(&dec, 0, 11, 2, 0) && !ADC_Decim_Init(&dec, 0, 4, 1, 5) && !ADC_Decim_Init(&dec, 0, 1, 1, 2);
+    printf("  growth over 20 bits, 5 extra bits, more extra bits than growth: %s\n", refused ? "refused, ok" : "accepted, FAIL");
+    fail += !refused;
+
+    /* Bus voltage slot at the carrier rate, 2^12 periods (63 ms, ~6 ripple periods) to 16 bit */
+    SIM_Default_Config(&cfg);
+    if(!SIM_Init(&cfg)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    SIM_Firmware_Start(SIM_ZC_DEFAULT);
+    SIM_Run(SIM_METER_SETTLE_S, 0);
+    bool scan = ADC_Oversample_Start(&ADC_Handle_A, &dec, 1) || ADC_Oversample_Start(&ADC_Handle_B, &dec, 1);
+    ADC_Decim_Init(&vbus, PFC_SLOT_VBUS, 12, 1, 4);
+    bool attached = ADC_Oversample_PMD(&vbus, 1);
+    uint32_t pmd0 = ADC_PMD_Count;
+    SIM_Run(4.0 * 4096.0 / SIM_PWM_HZ, 0);
+    uint32_t periods = ADC_PMD_Count - pmd0;
+    double volts = vbus.out / 16.0 / SIM_ADC_VBUS_GAIN;
+    ADC_Oversample_PMD(0, 0);
+    bool pass = !scan && attached && vbus.count == (periods >> 12) && fabs(volts - SIM_Get_Metrics()->vbus_avg) < 1.0;
+    printf("  PMD slot %u: %lu outputs from %lu periods, %.2f V (plant %.2f V), ADA / ADB scan %s  %s\n", PFC_SLOT_VBUS,
+           (unsigned long)vbus.count, (unsigned long)periods, volts, SIM_Get_Metrics()->vbus_avg,
+           scan ? "taken" : "refused", pass ? "ok" : "FAIL");
+    fail += !pass;
+    printf("%lu failed\n", (unsigned long)fail);
+    return (fail == 0) ? 0 : 1;
+}
+
+int main(int argc, char ** argv){
+    double seconds;
+    SIM_Plant_Config cfg;
+
+    if(argc > 1 && strcmp(argv[1], "--bench") == 0){
+        return SIM_Bench();
+    }
+    if(argc > 1 && strcmp(argv[1], "--zc") == 0){
+        return SIM_ZC_Sweep();
+    }
+    if(argc > 1 && strcmp(argv[1], "--trip") == 0){
+        return SIM_Trip();
+    }
+    if(argc > 1 && strcmp(argv[1], "--meter") == 0){
+        return SIM_Meter();
+    }
+    if(argc > 1 && strcmp(argv[1], "--harm") == 0){
+        return SIM_Harm();
+    }
+    if(argc > 1 && strcmp(argv[1], "--scope") == 0){
+        return SIM_Scope();
+    }
+    if(argc > 1 && strcmp(argv[1], "--telemetry") == 0){
+        return SIM_Telemetry();
+    }
+    if(argc > 1 && strcmp(argv[1], "--uart") == 0){
+        return SIM_Uart();
+    }
+    if(argc > 1 && strcmp(argv[1], "--pinmux") == 0){
+        return SIM_PinMux();
+    }
+    if(argc > 1 && strcmp(argv[1], "--units") == 0){
+        return SIM_Units();
+    }
+    if(argc > 1 && strcmp(argv[1], "--interleave") == 0){
+        return SIM_Interleave();
+    }
+    if(argc > 1 && strcmp(argv[1], "--decim") == 0){
+        return SIM_Decim();
+    }
+    seconds = (argc > 1) ? atof(argv[1]) : 0.5;
+
+    SIM_Default_Config(&cfg);
+    if(!SIM_Init(&cfg)){
+        fprintf(stderr, "pfc_sim: cannot map the peripheral window at 0x%08lX\n", (unsigned long)PERI_BASE);
+        return 1;
+    }
+    if(argc > 2){
+        SIM_Log_Open(argv[2], 16);
+    }
+
+    SIM_Firmware_Start(SIM_ZC_DEFAULT);
+    SIM_Run(seconds, SIM_Print_Metrics);
+    SIM_Log_Close();
+    return 0;
+}
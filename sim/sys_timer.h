@@ -0,0 +1,28 @@
+/**
+ *******************************************************************************
+ * @file    sys_timer.h
+ * @brief   Host stand-in for the board delay timer
+ *          Used only by the DS_HOST_SIM register-model build
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __SYS_TIMER_SIM_H__
+#define __SYS_TIMER_SIM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wait(uint32_t us);                     // Busy wait in us (no-op in the simulator)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SYS_TIMER_SIM_H__ */
@@ -0,0 +1,31 @@
+/**
+ *******************************************************************************
+ * @file    system.h
+ * @brief   Host stand-in for the TMPM4KNA system header
+ *          Used only by the DS_HOST_SIM register-model build
+ * @version V1.0.0.0
+ * $Date:: 2026-10-17 #$
+ *
+ * @author Hugo Rodrigues
+ *******************************************************************************
+ */
+
+#ifndef __SYSTEM_SIM_H__
+#define __SYSTEM_SIM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t SystemCoreClock;            // System Clock Frequency (Core Clock)
+
+void SystemInit(void);
+void SystemCoreClockUpdate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SYSTEM_SIM_H__ */